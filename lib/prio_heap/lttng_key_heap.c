@@ -0,0 +1,243 @@
+/*
+ * lttng_key_heap.c
+ *
+ * Priority heap containing pointers ordered by a 64-bit key. Based on CLRS,
+ * chapter 6.
+ *
+ * Copyright 2026 - agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <linux/slab.h>
+#include "lttng_key_heap.h"
+
+#ifdef DEBUG_HEAP
+void lttng_key_heap_check(const struct lttng_key_heap *heap)
+{
+	size_t i;
+
+	for (i = 1; i < heap->len; i++)
+		WARN_ON_ONCE(heap->entries[i].key
+			     < heap->entries[(i - 1) >> 1].key);
+}
+#endif
+
+/*
+ * Copy of heap->entries pointer is invalid after heap_grow.
+ */
+static
+int heap_grow(struct lttng_key_heap *heap, size_t new_len)
+{
+	struct lttng_key_heap_entry *new_entries;
+
+	if (heap->alloc_len >= new_len)
+		return 0;
+
+	heap->alloc_len = max_t(size_t, new_len, heap->alloc_len << 1);
+	new_entries = kmalloc(heap->alloc_len * sizeof(*new_entries),
+			      heap->gfpmask);
+	if (!new_entries)
+		return -ENOMEM;
+	if (heap->entries)
+		memcpy(new_entries, heap->entries,
+		       heap->len * sizeof(*new_entries));
+	kfree(heap->entries);
+	heap->entries = new_entries;
+	return 0;
+}
+
+static
+int heap_set_len(struct lttng_key_heap *heap, size_t new_len)
+{
+	int ret;
+
+	ret = heap_grow(heap, new_len);
+	if (ret)
+		return ret;
+	heap->len = new_len;
+	return 0;
+}
+
+int lttng_key_heap_init(struct lttng_key_heap *heap, size_t alloc_len,
+		gfp_t gfpmask)
+{
+	heap->entries = NULL;
+	heap->len = 0;
+	heap->alloc_len = 0;
+	heap->gfpmask = gfpmask;
+	/*
+	 * Minimum size allocated is 1 entry to ensure memory allocation
+	 * never fails within heap_replace_min.
+	 */
+	return heap_grow(heap, max_t(size_t, 1, alloc_len));
+}
+
+void lttng_key_heap_free(struct lttng_key_heap *heap)
+{
+	kfree(heap->entries);
+}
+
+/*
+ * Sift the entry down from position i. Instead of swapping entries at each
+ * level, the smallest child is moved up into the hole, and the entry is
+ * written once at its final position.
+ */
+static
+void heap_sift_down(struct lttng_key_heap *heap, size_t i,
+		    struct lttng_key_heap_entry entry)
+{
+	struct lttng_key_heap_entry *entries = heap->entries;
+	size_t len = heap->len, child;
+
+	for (;;) {
+		child = (i << 1) + 1;
+		if (child >= len)
+			break;
+		if (child + 1 < len
+		    && entries[child + 1].key < entries[child].key)
+			child++;
+		if (entries[child].key >= entry.key)
+			break;
+		entries[i] = entries[child];
+		i = child;
+	}
+	entries[i] = entry;
+}
+
+/*
+ * Sift the entry up from position i.
+ */
+static
+void heap_sift_up(struct lttng_key_heap *heap, size_t i,
+		  struct lttng_key_heap_entry entry)
+{
+	struct lttng_key_heap_entry *entries = heap->entries;
+	size_t parent;
+
+	while (i > 0) {
+		parent = (i - 1) >> 1;
+		if (entries[parent].key <= entry.key)
+			break;
+		/* Move parent down until we find the right spot */
+		entries[i] = entries[parent];
+		i = parent;
+	}
+	entries[i] = entry;
+}
+
+void *lttng_key_heap_replace_min(struct lttng_key_heap *heap, u64 key, void *p)
+{
+	struct lttng_key_heap_entry entry = { .key = key, .ptr = p };
+	void *res;
+
+	if (!heap->len) {
+		(void) heap_set_len(heap, 1);
+		heap->entries[0] = entry;
+		lttng_key_heap_check(heap);
+		return NULL;
+	}
+
+	/* Replace the current min and sift down */
+	res = heap->entries[0].ptr;
+	heap_sift_down(heap, 0, entry);
+	lttng_key_heap_check(heap);
+	return res;
+}
+
+int lttng_key_heap_insert(struct lttng_key_heap *heap, u64 key, void *p)
+{
+	struct lttng_key_heap_entry entry = { .key = key, .ptr = p };
+	int ret;
+
+	ret = heap_set_len(heap, heap->len + 1);
+	if (ret)
+		return ret;
+	heap_sift_up(heap, heap->len - 1, entry);
+	lttng_key_heap_check(heap);
+	return 0;
+}
+
+int lttng_key_heap_append(struct lttng_key_heap *heap, u64 key, void *p)
+{
+	int ret;
+
+	ret = heap_set_len(heap, heap->len + 1);
+	if (ret)
+		return ret;
+	heap->entries[heap->len - 1].key = key;
+	heap->entries[heap->len - 1].ptr = p;
+	return 0;
+}
+
+void lttng_key_heap_build(struct lttng_key_heap *heap)
+{
+	size_t i;
+
+	/* Sift down each parent, from the last one up to the root. */
+	for (i = heap->len >> 1; i > 0; i--)
+		heap_sift_down(heap, i - 1, heap->entries[i - 1]);
+	lttng_key_heap_check(heap);
+}
+
+void *lttng_key_heap_remove(struct lttng_key_heap *heap)
+{
+	switch (heap->len) {
+	case 0:
+		return NULL;
+	case 1:
+		(void) heap_set_len(heap, 0);
+		return heap->entries[0].ptr;
+	}
+	/* Shrink, replace the current min by previous last entry and sift */
+	heap_set_len(heap, heap->len - 1);
+	/* len changed. previous last entry is at heap->len */
+	return lttng_key_heap_replace_min(heap, heap->entries[heap->len].key,
+					  heap->entries[heap->len].ptr);
+}
+
+void *lttng_key_heap_cherrypick(struct lttng_key_heap *heap, void *p)
+{
+	struct lttng_key_heap_entry last;
+	size_t pos, len = heap->len;
+
+	for (pos = 0; pos < len; pos++)
+		if (heap->entries[pos].ptr == p)
+			goto found;
+	return NULL;
+found:
+	if (heap->len == 1) {
+		(void) heap_set_len(heap, 0);
+		lttng_key_heap_check(heap);
+		return p;
+	}
+	/* Replace p with previous last entry and rebalance. */
+	heap_set_len(heap, heap->len - 1);
+	/* len changed. previous last entry is at heap->len */
+	if (pos == heap->len)
+		goto end;
+	last = heap->entries[heap->len];
+	if (pos > 0 && last.key < heap->entries[(pos - 1) >> 1].key)
+		heap_sift_up(heap, pos, last);
+	else
+		heap_sift_down(heap, pos, last);
+end:
+	lttng_key_heap_check(heap);
+	return p;
+}
@@ -0,0 +1,171 @@
+#ifndef _LTTNG_KEY_HEAP_H
+#define _LTTNG_KEY_HEAP_H
+
+/*
+ * lttng_key_heap.h
+ *
+ * Priority heap containing pointers ordered by a 64-bit key. Based on CLRS,
+ * chapter 6.
+ *
+ * The key of each element is stored in the heap array next to its pointer,
+ * and compared inline: rebalancing the heap never dereferences the
+ * elements. The element with the lowest key is at the top.
+ *
+ * Copyright 2026 - agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <linux/types.h>
+#include <linux/gfp.h>
+
+struct lttng_key_heap_entry {
+	u64 key;
+	void *ptr;
+};
+
+struct lttng_key_heap {
+	size_t len, alloc_len;
+	struct lttng_key_heap_entry *entries;
+	gfp_t gfpmask;
+};
+
+#ifdef DEBUG_HEAP
+void lttng_key_heap_check(const struct lttng_key_heap *heap);
+#else
+static inline
+void lttng_key_heap_check(const struct lttng_key_heap *heap)
+{
+}
+#endif
+
+/**
+ * lttng_key_heap_minimum - return the element with the lowest key
+ * @heap: the heap to be operated on
+ *
+ * Returns the element at the top of the heap, without performing any
+ * modification to the heap structure. Returns NULL if the heap is empty.
+ */
+static inline void *lttng_key_heap_minimum(const struct lttng_key_heap *heap)
+{
+	lttng_key_heap_check(heap);
+	return heap->len ? heap->entries[0].ptr : NULL;
+}
+
+/**
+ * lttng_key_heap_update_min_key - change the key of the topmost element
+ * @heap: the heap to be operated on
+ * @key: the new key
+ *
+ * Typically used to raise the key of the topmost element as it advances,
+ * without rebalancing the heap. The new key must not be higher than the keys
+ * of its children, so the heap structure is preserved. The heap must not be
+ * empty.
+ */
+static inline void lttng_key_heap_update_min_key(struct lttng_key_heap *heap,
+						 u64 key)
+{
+	heap->entries[0].key = key;
+	lttng_key_heap_check(heap);
+}
+
+/**
+ * lttng_key_heap_init - initialize the heap
+ * @heap: the heap to initialize
+ * @alloc_len: number of elements initially allocated
+ * @gfp: allocation flags
+ *
+ * Returns -ENOMEM if out of memory.
+ */
+extern int lttng_key_heap_init(struct lttng_key_heap *heap,
+		size_t alloc_len, gfp_t gfpmask);
+
+/**
+ * lttng_key_heap_free - free the heap
+ * @heap: the heap to free
+ */
+extern void lttng_key_heap_free(struct lttng_key_heap *heap);
+
+/**
+ * lttng_key_heap_insert - insert an element into the heap
+ * @heap: the heap to be operated on
+ * @key: the key of the element
+ * @p: the element to add
+ *
+ * Returns -ENOMEM if out of memory.
+ */
+extern int lttng_key_heap_insert(struct lttng_key_heap *heap, u64 key, void *p);
+
+/**
+ * lttng_key_heap_append - add an element without rebalancing the heap
+ * @heap: the heap to be operated on
+ * @key: the key of the element
+ * @p: the element to add
+ *
+ * Add an element at the end of the heap array. The heap structure is broken
+ * until lttng_key_heap_build() is called: no other operation is allowed in
+ * between. Adding n elements this way costs O(n) instead of O(n log(n)).
+ *
+ * Returns -ENOMEM if out of memory.
+ */
+extern int lttng_key_heap_append(struct lttng_key_heap *heap, u64 key, void *p);
+
+/**
+ * lttng_key_heap_build - restore the heap structure after appends
+ * @heap: the heap to be operated on
+ */
+extern void lttng_key_heap_build(struct lttng_key_heap *heap);
+
+/**
+ * lttng_key_heap_remove - remove the topmost element from the heap
+ * @heap: the heap to be operated on
+ *
+ * Returns the element with the lowest key. It removes this element from the
+ * heap. Returns NULL if the heap is empty.
+ */
+extern void *lttng_key_heap_remove(struct lttng_key_heap *heap);
+
+/**
+ * lttng_key_heap_cherrypick - remove a given element from the heap
+ * @heap: the heap to be operated on
+ * @p: the element
+ *
+ * Remove the given element from the heap. Return the element if present, else
+ * return NULL. This algorithm has a complexity of O(n), which is higher than
+ * O(log(n)) provided by the rest of this API.
+ */
+extern void *lttng_key_heap_cherrypick(struct lttng_key_heap *heap, void *p);
+
+/**
+ * lttng_key_heap_replace_min - replace the topmost element of the heap
+ * @heap: the heap to be operated on
+ * @key: the key of the replacement element
+ * @p: the pointer to be inserted as topmost element replacement
+ *
+ * Returns the element with the lowest key. It removes this element from the
+ * heap. The heap is rebalanced only once after the insertion. Returns NULL if
+ * the heap is empty.
+ *
+ * This is the equivalent of calling heap_remove() and then heap_insert(), but
+ * it only rebalances the heap once. It never allocates memory.
+ */
+extern void *lttng_key_heap_replace_min(struct lttng_key_heap *heap,
+		u64 key, void *p);
+
+#endif /* _LTTNG_KEY_HEAP_H */
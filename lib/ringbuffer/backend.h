@@ -81,7 +81,8 @@ lib_ring_buffer_read_offset_address(struct lib_ring_buffer_backend *bufb,
  * This function copies "len" bytes of data from a source pointer to a buffer
  * backend, at the current context offset. This is more or less a buffer
  * backend-specific memcpy() operation. Calls the slow path (_ring_buffer_write)
- * if copy is crossing a page boundary.
+ * if copy is crossing a page boundary, unless the sub-buffer is virtually
+ * contiguous (RING_BUFFER_VMAP, RING_BUFFER_STATIC).
  */
 static inline
 void lib_ring_buffer_write(const struct lib_ring_buffer_config *config,
@@ -113,6 +114,11 @@ void lib_ring_buffer_write(const struct lib_ring_buffer_config *config,
 					rpages->p[index].virt
 					    + (offset & ~PAGE_MASK),
 					src, len);
+	else if (config->backend != RING_BUFFER_PAGE && rpages->virt)
+		lib_ring_buffer_do_copy(config,
+					rpages->virt
+					    + (offset & (chanb->subbuf_size - 1)),
+					src, len);
 	else
 		_lib_ring_buffer_write(bufb, offset, src, len, 0);
 	ctx->buf_offset += len;
@@ -160,6 +166,10 @@ void lib_ring_buffer_memset(const struct lib_ring_buffer_config *config,
 		lib_ring_buffer_do_memset(rpages->p[index].virt
 					  + (offset & ~PAGE_MASK),
 					  c, len);
+	else if (config->backend != RING_BUFFER_PAGE && rpages->virt)
+		lib_ring_buffer_do_memset(rpages->virt
+					  + (offset & (chanb->subbuf_size - 1)),
+					  c, len);
 	else
 		_lib_ring_buffer_memset(bufb, offset, c, len, 0);
 	ctx->buf_offset += len;
@@ -220,6 +230,15 @@ void lib_ring_buffer_copy_from_user_inatomic(const struct lib_ring_buffer_config
 			offset += (pagecpy - ret);
 			goto fill_buffer;
 		}
+	} else if (config->backend != RING_BUFFER_PAGE && rpages->virt) {
+		ret = lib_ring_buffer_do_copy_from_user_inatomic(
+			rpages->virt + (offset & (chanb->subbuf_size - 1)),
+			src, len);
+		if (unlikely(ret > 0)) {
+			offset += (len - ret);
+			len = ret;
+			goto fill_buffer;
+		}
 	} else {
 		_lib_ring_buffer_copy_from_user_inatomic(bufb, offset, src, len, 0);
 	}
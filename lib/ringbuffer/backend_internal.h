@@ -40,10 +40,18 @@ void lib_ring_buffer_backend_free(struct lib_ring_buffer_backend *bufb);
 int channel_backend_init(struct channel_backend *chanb,
 			 const char *name,
 			 const struct lib_ring_buffer_config *config,
-			 void *priv, size_t subbuf_size,
-			 size_t num_subbuf);
+			 void *priv, void *buf_addr, size_t subbuf_size,
+			 size_t num_subbuf, size_t max_memory);
 void channel_backend_free(struct channel_backend *chanb);
 
+/* Page sets of adaptively populated buffers */
+struct lib_ring_buffer_backend_pages *
+	lib_ring_buffer_backend_pages_alloc(struct lib_ring_buffer_backend *bufb);
+void lib_ring_buffer_backend_pages_free(struct lib_ring_buffer_backend *bufb,
+				struct lib_ring_buffer_backend_pages *pages);
+
+void *lib_ring_buffer_backend_static_counters(struct lib_ring_buffer_backend *bufb);
+
 void lib_ring_buffer_backend_reset(struct lib_ring_buffer_backend *bufb);
 void channel_backend_reset(struct channel_backend *chanb);
 
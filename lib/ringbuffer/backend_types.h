@@ -25,6 +25,7 @@
 
 #include <linux/cpumask.h>
 #include <linux/types.h>
+#include <asm/atomic.h>
 
 struct lib_ring_buffer_backend_page {
 	void *virt;			/* page virtual address (cached) */
@@ -36,6 +37,12 @@ struct lib_ring_buffer_backend_pages {
 	union v_atomic records_commit;	/* current records committed count */
 	union v_atomic records_unread;	/* records to read */
 	unsigned long data_size;	/* Amount of data to read from subbuf */
+	void *virt;			/*
+					 * Sub-buffer address if virtually
+					 * contiguous (RING_BUFFER_VMAP,
+					 * RING_BUFFER_STATIC), else NULL.
+					 */
+	unsigned int vmapped:1;		/* Mapped in the vmalloc area ? */
 	struct lib_ring_buffer_backend_page p[];
 };
 
@@ -58,9 +65,12 @@ struct lib_ring_buffer_backend {
 	/*
 	 * Pointer array of backend pages, for whole buffer.
 	 * Indexed by ring_buffer_backend_subbuffer identifier (id) index.
+	 * With adaptive population, only the nr_populated entries starting
+	 * at the consumed position are non-NULL.
 	 */
 	struct lib_ring_buffer_backend_pages **array;
 	unsigned int num_pages_per_subbuf;
+	unsigned long nr_populated;	/* Sub-buffers backed by pages */
 
 	struct channel *chan;		/* Associated channel */
 	int cpu;			/* This buffer's cpu. -1 if global. */
@@ -68,6 +78,12 @@ struct lib_ring_buffer_backend {
 	unsigned int allocated:1;	/* is buffer allocated ? */
 };
 
+/*
+ * Adaptively populated buffers keep at least the sub-buffer being written and
+ * the one being read.
+ */
+#define RING_BUFFER_ADAPT_MIN_SUBBUF	2
+
 struct channel_backend {
 	unsigned long buf_size;		/* Size of the buffer */
 	unsigned long subbuf_size;	/* Sub-buffer size */
@@ -78,9 +94,21 @@ struct channel_backend {
 					 */
 	unsigned int buf_size_order;	/* Order of buffer size */
 	unsigned int extra_reader_sb:1;	/* has extra reader subbuffer ? */
+	unsigned int static_recovered:1;/*
+					 * Content recovered from static
+					 * memory left by a previous kernel ?
+					 */
 	struct lib_ring_buffer *buf;	/* Channel per-cpu buffers */
 
 	unsigned long num_subbuf;	/* Number of sub-buffers for writer */
+	unsigned long max_populated;	/*
+					 * Adaptive population ceiling, in
+					 * sub-buffers, for all buffers of
+					 * the channel. 0: fully populated.
+					 */
+	atomic_long_t nr_populated;	/* Populated sub-buffers (adaptive) */
+	void *static_mem;		/* RING_BUFFER_STATIC memory */
+	size_t static_slot_size;	/* Static memory of each buffer */
 	u64 start_tsc;			/* Channel creation TSC value */
 	void *priv;			/* Client-specific information */
 	struct notifier_block cpu_hp_notifier;	 /* CPU hotplug notifier */
@@ -0,0 +1,420 @@
+/*
+ * lib/ringbuffer/bench/ring_buffer_bench.c
+ *
+ * Ring buffer library microbenchmark.
+ *
+ * Creates a channel for each ring buffer configuration (per-cpu/global,
+ * discard/overwrite, splice/mmap), writes records into it from one kthread
+ * pinned on each online CPU, and reports the average cost per event, the
+ * lost record counters and the sub-buffer switch rate through debugfs:
+ *
+ *   echo 1 > /sys/kernel/debug/lttng-ring-buffer-bench/run
+ *   cat /sys/kernel/debug/lttng-ring-buffer-bench/results
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/mutex.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/cpu.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include "ring_buffer_bench.h"
+
+#define BENCH_MAX_PAYLOAD_SIZES	8
+
+static unsigned int payload_size[BENCH_MAX_PAYLOAD_SIZES] = { 8, 64, 256 };
+static int nr_payload_size = 3;
+module_param_array(payload_size, uint, &nr_payload_size, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(payload_size, "Record payload sizes to benchmark, in bytes");
+
+static unsigned long nr_events = 1000000;
+module_param(nr_events, ulong, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(nr_events, "Records written by each per-cpu writer thread");
+
+static unsigned long subbuf_size = 262144;
+module_param(subbuf_size, ulong, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(subbuf_size, "Sub-buffer size, in bytes (power of 2)");
+
+static unsigned long num_subbuf = 4;
+module_param(num_subbuf, ulong, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(num_subbuf, "Number of sub-buffers per buffer (power of 2)");
+
+static unsigned int switch_timer_interval;
+module_param(switch_timer_interval, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(switch_timer_interval, "Switch timer interval, in us (0: off)");
+
+static bool consume = 1;
+module_param(consume, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(consume, "Drain buffers from a consumer kthread during the run");
+
+static const struct lib_ring_buffer_bench_client *bench_clients[] = {
+	&lib_ring_buffer_bench_percpu_discard_splice,
+	&lib_ring_buffer_bench_percpu_discard_splice_vmap,
+	&lib_ring_buffer_bench_percpu_discard_mmap,
+	&lib_ring_buffer_bench_percpu_overwrite_splice,
+	&lib_ring_buffer_bench_percpu_overwrite_mmap,
+	&lib_ring_buffer_bench_global_discard_splice,
+	&lib_ring_buffer_bench_global_discard_mmap,
+	&lib_ring_buffer_bench_global_overwrite_splice,
+	&lib_ring_buffer_bench_global_overwrite_mmap,
+};
+
+struct bench_result {
+	const char *client;
+	unsigned int payload_size;
+	unsigned int nr_writers;
+	int error;			/* Negative errno if the run failed */
+	unsigned long written;		/* Records successfully committed */
+	unsigned long failed;		/* Reservations that failed */
+	u64 cpu_ns;			/* Sum of writer thread run times */
+	u64 wall_ns;			/* Wall time of the whole run */
+	unsigned long switches;		/* Sub-buffer switches */
+	struct lib_ring_buffer_bench_stats stats;
+};
+
+struct bench_writer {
+	struct task_struct *task;
+	const struct lib_ring_buffer_bench_client *client;
+	struct channel *chan;
+	const void *payload;
+	size_t len;
+	struct completion *start;
+	struct completion done;
+	unsigned long written, failed;
+	u64 elapsed_ns;
+};
+
+struct bench_consumer {
+	const struct lib_ring_buffer_bench_client *client;
+	struct channel *chan;
+};
+
+static DEFINE_MUTEX(bench_mutex);	/* Protects runs and results */
+static struct bench_result *bench_results;
+static unsigned int bench_nr_results;
+static struct dentry *bench_dentry;
+
+static
+int bench_writer_thread(void *data)
+{
+	struct bench_writer *w = data;
+	unsigned long i;
+	ktime_t begin;
+
+	wait_for_completion(w->start);
+	begin = ktime_get();
+	for (i = 0; i < nr_events; i++) {
+		if (w->client->event_write(w->chan, w->payload, w->len))
+			w->failed++;
+		else
+			w->written++;
+	}
+	w->elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), begin));
+	complete(&w->done);
+
+	/* Stay around until kthread_stop() so the task can be reaped. */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
+
+static
+int bench_consumer_thread(void *data)
+{
+	struct bench_consumer *c = data;
+
+	while (!kthread_should_stop()) {
+		if (!c->client->drain(c->chan))
+			schedule_timeout_interruptible(1);
+	}
+	return 0;
+}
+
+/*
+ * Run one client with one payload size. Called with bench_mutex and the cpu
+ * hotplug read lock held.
+ */
+static
+int bench_run_one(const struct lib_ring_buffer_bench_client *client,
+		  size_t len, const void *payload,
+		  struct bench_writer *writers, struct bench_result *result)
+{
+	struct lib_ring_buffer_bench_chan *bench_chan;
+	struct bench_consumer consumer;
+	struct task_struct *consumer_task = NULL;
+	struct completion start;
+	struct channel *chan;
+	ktime_t begin;
+	int cpu, ret = 0;
+
+	result->client = client->name;
+	result->payload_size = len;
+
+	bench_chan = kzalloc(sizeof(*bench_chan), GFP_KERNEL);
+	if (!bench_chan)
+		return -ENOMEM;
+	atomic_long_set(&bench_chan->switches, 0);
+	chan = client->channel_create("lttng-ring-buffer-bench", bench_chan,
+				      subbuf_size, num_subbuf,
+				      switch_timer_interval, 0);
+	if (!chan) {
+		ret = -EINVAL;
+		goto chan_error;
+	}
+	if (consume) {
+		ret = client->buffers_open_read(chan);
+		if (ret)
+			goto open_error;
+		consumer.client = client;
+		consumer.chan = chan;
+		consumer_task = kthread_run(bench_consumer_thread, &consumer,
+					    "lttng_rb_bench_consumer");
+		if (IS_ERR(consumer_task)) {
+			ret = PTR_ERR(consumer_task);
+			goto consumer_error;
+		}
+	}
+
+	init_completion(&start);
+	memset(writers, 0, nr_cpu_ids * sizeof(*writers));
+	for_each_online_cpu(cpu) {
+		struct bench_writer *w = &writers[cpu];
+
+		w->client = client;
+		w->chan = chan;
+		w->payload = payload;
+		w->len = len;
+		w->start = &start;
+		init_completion(&w->done);
+		w->task = kthread_create(bench_writer_thread, w,
+					 "lttng_rb_bench/%d", cpu);
+		if (IS_ERR(w->task)) {
+			ret = PTR_ERR(w->task);
+			w->task = NULL;
+			goto writer_error;
+		}
+		kthread_bind(w->task, cpu);
+		result->nr_writers++;
+	}
+	for_each_online_cpu(cpu)
+		wake_up_process(writers[cpu].task);
+
+	begin = ktime_get();
+	complete_all(&start);
+	for_each_online_cpu(cpu)
+		wait_for_completion(&writers[cpu].done);
+	result->wall_ns = ktime_to_ns(ktime_sub(ktime_get(), begin));
+
+	for_each_online_cpu(cpu) {
+		struct bench_writer *w = &writers[cpu];
+
+		result->written += w->written;
+		result->failed += w->failed;
+		result->cpu_ns += w->elapsed_ns;
+	}
+
+writer_error:
+	/* Writers not yet woken up exit without running their function. */
+	for_each_online_cpu(cpu) {
+		if (writers[cpu].task)
+			kthread_stop(writers[cpu].task);
+	}
+	if (consumer_task)
+		kthread_stop(consumer_task);
+	client->get_stats(chan, &result->stats);
+	result->switches = atomic_long_read(&bench_chan->switches);
+consumer_error:
+	if (consume)
+		client->buffers_release_read(chan);
+open_error:
+	client->channel_destroy(chan);
+chan_error:
+	kfree(bench_chan);
+	return ret;
+}
+
+static
+int bench_run(void)
+{
+	struct bench_writer *writers;
+	struct bench_result *results;
+	unsigned int nr_results, i, j, max_len = 0;
+	void *payload;
+	int ret = 0;
+
+	for (j = 0; j < nr_payload_size; j++) {
+		if (!payload_size[j])
+			return -EINVAL;
+		max_len = max(max_len, payload_size[j]);
+	}
+	nr_results = ARRAY_SIZE(bench_clients) * nr_payload_size;
+	results = kcalloc(nr_results, sizeof(*results), GFP_KERNEL);
+	if (!results)
+		return -ENOMEM;
+	writers = kcalloc(nr_cpu_ids, sizeof(*writers), GFP_KERNEL);
+	if (!writers) {
+		ret = -ENOMEM;
+		goto writers_error;
+	}
+	payload = kzalloc(max_len, GFP_KERNEL);
+	if (!payload) {
+		ret = -ENOMEM;
+		goto payload_error;
+	}
+
+	get_online_cpus();
+	for (i = 0; i < ARRAY_SIZE(bench_clients); i++) {
+		for (j = 0; j < nr_payload_size; j++) {
+			struct bench_result *result =
+				&results[i * nr_payload_size + j];
+
+			result->error = bench_run_one(bench_clients[i],
+						      payload_size[j], payload,
+						      writers, result);
+		}
+	}
+	put_online_cpus();
+
+	kfree(bench_results);
+	bench_results = results;
+	bench_nr_results = nr_results;
+	results = NULL;
+
+	kfree(payload);
+payload_error:
+	kfree(writers);
+writers_error:
+	kfree(results);
+	return ret;
+}
+
+static
+ssize_t bench_run_write(struct file *file, const char __user *user_buf,
+			size_t count, loff_t *ppos)
+{
+	int ret;
+
+	mutex_lock(&bench_mutex);
+	ret = bench_run();
+	mutex_unlock(&bench_mutex);
+	if (ret)
+		return ret;
+	return count;
+}
+
+static const struct file_operations bench_run_fops = {
+	.owner = THIS_MODULE,
+	.write = bench_run_write,
+};
+
+static
+int bench_results_show(struct seq_file *m, void *v)
+{
+	unsigned int i;
+
+	mutex_lock(&bench_mutex);
+	seq_printf(m, "%-24s %8s %7s %12s %12s %10s %10s %10s %10s %12s\n",
+		   "config", "payload", "writers", "ns/event", "written",
+		   "lost_full", "lost_wrap", "lost_big", "overrun",
+		   "switches/s");
+	for (i = 0; i < bench_nr_results; i++) {
+		struct bench_result *r = &bench_results[i];
+		unsigned long attempts = r->written + r->failed;
+
+		if (r->error) {
+			seq_printf(m, "%-24s %8u error %d\n",
+				   r->client, r->payload_size, r->error);
+			continue;
+		}
+		seq_printf(m, "%-24s %8u %7u %12llu %12lu %10lu %10lu %10lu %10lu %12llu\n",
+			   r->client, r->payload_size, r->nr_writers,
+			   attempts ? div64_u64(r->cpu_ns, attempts) : 0ULL,
+			   r->written,
+			   r->stats.records_lost_full,
+			   r->stats.records_lost_wrap,
+			   r->stats.records_lost_big,
+			   r->stats.records_overrun,
+			   r->wall_ns ? div64_u64((u64) r->switches * NSEC_PER_SEC,
+						  r->wall_ns) : 0ULL);
+	}
+	mutex_unlock(&bench_mutex);
+	return 0;
+}
+
+static
+int bench_results_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_results_show, NULL);
+}
+
+static const struct file_operations bench_results_fops = {
+	.owner = THIS_MODULE,
+	.open = bench_results_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init lib_ring_buffer_bench_init(void)
+{
+	struct dentry *dentry;
+
+	bench_dentry = debugfs_create_dir("lttng-ring-buffer-bench", NULL);
+	if (IS_ERR_OR_NULL(bench_dentry)) {
+		printk(KERN_ERR "Error creating ring buffer bench debugfs directory\n");
+		return -ENOMEM;
+	}
+	dentry = debugfs_create_file("run", S_IWUSR, bench_dentry, NULL,
+				     &bench_run_fops);
+	if (!dentry)
+		goto error;
+	dentry = debugfs_create_file("results", S_IRUSR, bench_dentry, NULL,
+				     &bench_results_fops);
+	if (!dentry)
+		goto error;
+	return 0;
+
+error:
+	debugfs_remove_recursive(bench_dentry);
+	return -ENOMEM;
+}
+
+module_init(lib_ring_buffer_bench_init);
+
+static void __exit lib_ring_buffer_bench_exit(void)
+{
+	debugfs_remove_recursive(bench_dentry);
+	kfree(bench_results);
+}
+
+module_exit(lib_ring_buffer_bench_exit);
+
+MODULE_LICENSE("GPL and additional rights");
+MODULE_AUTHOR("agent");
+MODULE_DESCRIPTION("LTTng ring buffer library microbenchmark");
@@ -0,0 +1,81 @@
+#ifndef _LIB_RING_BUFFER_BENCH_H
+#define _LIB_RING_BUFFER_BENCH_H
+
+/*
+ * lib/ringbuffer/bench/ring_buffer_bench.h
+ *
+ * Ring buffer library microbenchmark: interface between the benchmark core
+ * and the client instances (one per ring buffer configuration).
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/types.h>
+#include <asm/atomic.h>
+
+struct channel;
+
+/* Channel private data, shared by all buffers of a benchmark channel. */
+struct lib_ring_buffer_bench_chan {
+	atomic_long_t switches;		/* Sub-buffer switches (buffer_begin) */
+};
+
+/* Counters summed over all buffers of a channel. */
+struct lib_ring_buffer_bench_stats {
+	unsigned long records_count;
+	unsigned long records_overrun;
+	unsigned long records_lost_full;
+	unsigned long records_lost_wrap;
+	unsigned long records_lost_big;
+};
+
+/*
+ * Each client is compiled from ring_buffer_bench_client.h with its own
+ * constant struct lib_ring_buffer_config, so the fast path is measured with
+ * the same compile-time specialization as a real tracer client.
+ */
+struct lib_ring_buffer_bench_client {
+	const char *name;
+	struct channel *(*channel_create)(const char *name,
+				struct lib_ring_buffer_bench_chan *bench_chan,
+				size_t subbuf_size, size_t num_subbuf,
+				unsigned int switch_timer_interval,
+				unsigned int read_timer_interval);
+	void (*channel_destroy)(struct channel *chan);
+	int (*buffers_open_read)(struct channel *chan);
+	void (*buffers_release_read)(struct channel *chan);
+	/* Reserve, write and commit one record. Returns 0 on success. */
+	int (*event_write)(struct channel *chan, const void *payload,
+			   size_t len);
+	/* Consume all readable sub-buffers. Returns the number consumed. */
+	unsigned long (*drain)(struct channel *chan);
+	void (*get_stats)(struct channel *chan,
+			  struct lib_ring_buffer_bench_stats *stats);
+};
+
+extern const struct lib_ring_buffer_bench_client
+	lib_ring_buffer_bench_percpu_discard_splice,
+	lib_ring_buffer_bench_percpu_discard_splice_vmap,
+	lib_ring_buffer_bench_percpu_discard_mmap,
+	lib_ring_buffer_bench_percpu_overwrite_splice,
+	lib_ring_buffer_bench_percpu_overwrite_mmap,
+	lib_ring_buffer_bench_global_discard_splice,
+	lib_ring_buffer_bench_global_discard_mmap,
+	lib_ring_buffer_bench_global_overwrite_splice,
+	lib_ring_buffer_bench_global_overwrite_mmap;
+
+#endif /* _LIB_RING_BUFFER_BENCH_H */
@@ -0,0 +1,276 @@
+/*
+ * lib/ringbuffer/bench/ring_buffer_bench_client.h
+ *
+ * Ring buffer library microbenchmark client template.
+ *
+ * Included by each ring_buffer_bench_client_*.c file after defining:
+ *   RING_BUFFER_ALLOC_TEMPLATE, RING_BUFFER_SYNC_TEMPLATE,
+ *   RING_BUFFER_MODE_TEMPLATE, RING_BUFFER_OUTPUT_TEMPLATE,
+ *   RING_BUFFER_BENCH_CLIENT (exported client symbol) and
+ *   RING_BUFFER_BENCH_CLIENT_STRING (client name).
+ * RING_BUFFER_BACKEND_TEMPLATE is optional, and defaults to RING_BUFFER_PAGE.
+ *
+ * Records have no header: the payload is written as-is, so the measured cost
+ * is the one of the ring buffer library itself (clock read, space
+ * reservation, copy and commit).
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/module.h>
+#include <linux/types.h>
+#include "../../../wrapper/trace-clock.h"
+#include "../../../wrapper/ringbuffer/frontend_types.h"
+#include "ring_buffer_bench.h"
+
+#ifndef RING_BUFFER_BACKEND_TEMPLATE
+#define RING_BUFFER_BACKEND_TEMPLATE		RING_BUFFER_PAGE
+#endif
+
+static const struct lib_ring_buffer_config client_config;
+
+static inline notrace u64 lib_ring_buffer_clock_read(struct channel *chan)
+{
+	return trace_clock_read64();
+}
+
+static inline
+unsigned char record_header_size(const struct lib_ring_buffer_config *config,
+				 struct channel *chan, size_t offset,
+				 size_t *pre_header_padding,
+				 struct lib_ring_buffer_ctx *ctx)
+{
+	*pre_header_padding = 0;
+	return 0;
+}
+
+#include "../../../wrapper/ringbuffer/api.h"
+
+static u64 client_ring_buffer_clock_read(struct channel *chan)
+{
+	return lib_ring_buffer_clock_read(chan);
+}
+
+static
+size_t client_record_header_size(const struct lib_ring_buffer_config *config,
+				 struct channel *chan, size_t offset,
+				 size_t *pre_header_padding,
+				 struct lib_ring_buffer_ctx *ctx)
+{
+	return record_header_size(config, chan, offset,
+				  pre_header_padding, ctx);
+}
+
+static size_t client_packet_header_size(void)
+{
+	return 0;
+}
+
+/*
+ * Called on each switch to a new sub-buffer, which makes it a convenient
+ * place to count switches without touching the library fast path.
+ */
+static void client_buffer_begin(struct lib_ring_buffer *buf, u64 tsc,
+				unsigned int subbuf_idx)
+{
+	struct lib_ring_buffer_bench_chan *bench_chan =
+		channel_get_private(buf->backend.chan);
+
+	atomic_long_inc(&bench_chan->switches);
+}
+
+static void client_buffer_end(struct lib_ring_buffer *buf, u64 tsc,
+			      unsigned int subbuf_idx, unsigned long data_size)
+{
+}
+
+static int client_buffer_create(struct lib_ring_buffer *buf, void *priv,
+				int cpu, const char *name)
+{
+	return 0;
+}
+
+static void client_buffer_finalize(struct lib_ring_buffer *buf, void *priv, int cpu)
+{
+}
+
+static const struct lib_ring_buffer_config client_config = {
+	.cb.ring_buffer_clock_read = client_ring_buffer_clock_read,
+	.cb.record_header_size = client_record_header_size,
+	.cb.subbuffer_header_size = client_packet_header_size,
+	.cb.buffer_begin = client_buffer_begin,
+	.cb.buffer_end = client_buffer_end,
+	.cb.buffer_create = client_buffer_create,
+	.cb.buffer_finalize = client_buffer_finalize,
+
+	.tsc_bits = 0,
+	.alloc = RING_BUFFER_ALLOC_TEMPLATE,
+	.sync = RING_BUFFER_SYNC_TEMPLATE,
+	.mode = RING_BUFFER_MODE_TEMPLATE,
+	.backend = RING_BUFFER_BACKEND_TEMPLATE,
+	.output = RING_BUFFER_OUTPUT_TEMPLATE,
+	.oops = RING_BUFFER_OOPS_CONSISTENCY,
+	.ipi = RING_BUFFER_IPI_BARRIER,
+	.wakeup = RING_BUFFER_WAKEUP_BY_TIMER,
+};
+
+/*
+ * Iterate on the buffers of a channel: each per-cpu buffer, or the single
+ * global buffer. Returns the buffer cpu (0 for global buffers), or -1 at
+ * the end of the iteration.
+ */
+static
+int client_next_buffer(struct channel *chan, int cpu,
+		       struct lib_ring_buffer **bufp)
+{
+	if (client_config.alloc == RING_BUFFER_ALLOC_GLOBAL) {
+		if (cpu >= 0)
+			return -1;
+		*bufp = channel_get_ring_buffer(&client_config, chan, 0);
+		return 0;
+	}
+	cpu = cpumask_next(cpu, chan->backend.cpumask);
+	smp_read_barrier_depends();
+	if (cpu >= nr_cpu_ids)
+		return -1;
+	*bufp = channel_get_ring_buffer(&client_config, chan, cpu);
+	return cpu;
+}
+
+#define for_each_client_buffer(buf, cpu, chan)				\
+	for ((cpu) = -1;						\
+	     ((cpu) = client_next_buffer(chan, cpu, &(buf))) >= 0;)
+
+static
+struct channel *client_channel_create(const char *name,
+				struct lib_ring_buffer_bench_chan *bench_chan,
+				size_t subbuf_size, size_t num_subbuf,
+				unsigned int switch_timer_interval,
+				unsigned int read_timer_interval)
+{
+	return channel_create(&client_config, name, bench_chan, NULL,
+			      subbuf_size, num_subbuf, switch_timer_interval,
+			      read_timer_interval, 0);
+}
+
+static
+void client_channel_destroy(struct channel *chan)
+{
+	channel_destroy(chan);
+}
+
+static
+void client_buffers_release_read(struct channel *chan)
+{
+	struct lib_ring_buffer *buf;
+	int cpu;
+
+	for_each_client_buffer(buf, cpu, chan)
+		lib_ring_buffer_release_read(buf);
+}
+
+static
+int client_buffers_open_read(struct channel *chan)
+{
+	struct lib_ring_buffer *buf;
+	int cpu, err_cpu, ret;
+
+	for_each_client_buffer(buf, cpu, chan) {
+		ret = lib_ring_buffer_open_read(buf);
+		if (ret)
+			goto error;
+	}
+	return 0;
+
+error:
+	err_cpu = cpu;
+	for_each_client_buffer(buf, cpu, chan) {
+		if (cpu == err_cpu)
+			break;
+		lib_ring_buffer_release_read(buf);
+	}
+	return ret;
+}
+
+static
+int client_event_write(struct channel *chan, const void *payload, size_t len)
+{
+	struct lib_ring_buffer_ctx ctx;
+	int ret, cpu;
+
+	cpu = lib_ring_buffer_get_cpu(&client_config);
+	if (cpu < 0)
+		return -EPERM;
+	lib_ring_buffer_ctx_init(&ctx, chan, NULL, len, sizeof(char), cpu);
+	ret = lib_ring_buffer_reserve(&client_config, &ctx);
+	if (ret)
+		goto put;
+	lib_ring_buffer_write(&client_config, &ctx, payload, len);
+	lib_ring_buffer_commit(&client_config, &ctx);
+put:
+	lib_ring_buffer_put_cpu(&client_config);
+	return ret;
+}
+
+static
+unsigned long client_drain(struct channel *chan)
+{
+	struct lib_ring_buffer *buf;
+	unsigned long consumed = 0;
+	int cpu;
+
+	for_each_client_buffer(buf, cpu, chan) {
+		while (!lib_ring_buffer_get_next_subbuf(buf)) {
+			lib_ring_buffer_put_next_subbuf(buf);
+			consumed++;
+		}
+	}
+	return consumed;
+}
+
+static
+void client_get_stats(struct channel *chan,
+		      struct lib_ring_buffer_bench_stats *stats)
+{
+	struct lib_ring_buffer *buf;
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+	for_each_client_buffer(buf, cpu, chan) {
+		stats->records_count +=
+			lib_ring_buffer_get_records_count(&client_config, buf);
+		stats->records_overrun +=
+			lib_ring_buffer_get_records_overrun(&client_config, buf);
+		stats->records_lost_full +=
+			lib_ring_buffer_get_records_lost_full(&client_config, buf);
+		stats->records_lost_wrap +=
+			lib_ring_buffer_get_records_lost_wrap(&client_config, buf);
+		stats->records_lost_big +=
+			lib_ring_buffer_get_records_lost_big(&client_config, buf);
+	}
+}
+
+const struct lib_ring_buffer_bench_client RING_BUFFER_BENCH_CLIENT = {
+	.name = RING_BUFFER_BENCH_CLIENT_STRING,
+	.channel_create = client_channel_create,
+	.channel_destroy = client_channel_destroy,
+	.buffers_open_read = client_buffers_open_read,
+	.buffers_release_read = client_buffers_release_read,
+	.event_write = client_event_write,
+	.drain = client_drain,
+	.get_stats = client_get_stats,
+};
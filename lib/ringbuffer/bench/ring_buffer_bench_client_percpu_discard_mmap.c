@@ -0,0 +1,29 @@
+/*
+ * lib/ringbuffer/bench/ring_buffer_bench_client_percpu_discard_mmap.c
+ *
+ * Ring buffer library microbenchmark client (per-cpu, discard, mmap).
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define RING_BUFFER_ALLOC_TEMPLATE		RING_BUFFER_ALLOC_PER_CPU
+#define RING_BUFFER_SYNC_TEMPLATE		RING_BUFFER_SYNC_PER_CPU
+#define RING_BUFFER_MODE_TEMPLATE		RING_BUFFER_DISCARD
+#define RING_BUFFER_OUTPUT_TEMPLATE		RING_BUFFER_MMAP
+#define RING_BUFFER_BENCH_CLIENT		lib_ring_buffer_bench_percpu_discard_mmap
+#define RING_BUFFER_BENCH_CLIENT_STRING		"percpu-discard-mmap"
+#include "ring_buffer_bench_client.h"
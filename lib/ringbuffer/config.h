@@ -115,8 +115,32 @@ struct lib_ring_buffer_client_cb {
  * ready to read. Lower latencies before the reader is woken up. Mainly suitable
  * for drivers.
  *
+ * RING_BUFFER_WAKEUP_BY_WORK keeps the writer lock-free: it marks the buffer
+ * deliverable when a subbuffer is ready to read, and a per-channel irq_work
+ * wakes up the readers of all marked buffers at once. No timer polls idle
+ * buffers. Needs CONFIG_IRQ_WORK.
+ *
  * RING_BUFFER_WAKEUP_NONE does not perform any wakeup whatsoever. The client
  * has the responsibility to perform wakeups.
+ *
+ * backend:
+ *
+ * RING_BUFFER_PAGE allocates each sub-buffer as independent pages. Writes
+ * crossing a page boundary are split.
+ *
+ * RING_BUFFER_VMAP makes each sub-buffer virtually contiguous, preferably
+ * with a physically contiguous allocation addressed through the kernel linear
+ * mapping, else by mapping its pages in the vmalloc area. Writes are then a
+ * single copy. splice() hands copies of the pages to the pipe, since the
+ * sub-buffer pages cannot be replaced.
+ *
+ * RING_BUFFER_STATIC places the buffers, along with the state needed to
+ * recover their content, in preallocated memory passed to channel_create(),
+ * e.g. a physical memory region reserved at boot and mapped by the client.
+ * Sub-buffers are contiguous. A channel created in memory which holds the
+ * content of a channel of the same layout, left by a previous kernel across
+ * kexec, recovers it read-only. Not available with mmap() output, since the
+ * memory may have no struct page; splice() hands copies to the pipe.
  */
 struct lib_ring_buffer_config {
 	enum {
@@ -140,8 +164,8 @@ struct lib_ring_buffer_config {
 	} output;
 	enum {
 		RING_BUFFER_PAGE,
-		RING_BUFFER_VMAP,		/* TODO */
-		RING_BUFFER_STATIC,		/* TODO */
+		RING_BUFFER_VMAP,		/* Contiguous sub-buffers */
+		RING_BUFFER_STATIC,		/* Preallocated memory */
 	} backend;
 	enum {
 		RING_BUFFER_NO_OOPS_CONSISTENCY,
@@ -158,6 +182,10 @@ struct lib_ring_buffer_config {
 						 * not lock-free
 						 * (takes spinlock).
 						 */
+		RING_BUFFER_WAKEUP_BY_WORK,	/*
+						 * writer defers wake up to
+						 * a per-channel irq_work
+						 */
 	} wakeup;
 	/*
 	 * tsc_bits: timestamp bits saved at each record.
@@ -301,12 +329,27 @@ void lib_ring_buffer_align_ctx(struct lib_ring_buffer_ctx *ctx,
 static inline
 int lib_ring_buffer_check_config(const struct lib_ring_buffer_config *config,
 			     unsigned int switch_timer_interval,
-			     unsigned int read_timer_interval)
+			     unsigned int read_timer_interval,
+			     size_t max_memory)
 {
 	if (config->alloc == RING_BUFFER_ALLOC_GLOBAL
 	    && config->sync == RING_BUFFER_SYNC_PER_CPU
 	    && switch_timer_interval)
 		return -EINVAL;
+	/* Adaptive population needs per-cpu discard mode splice buffers. */
+	if (max_memory
+	    && (config->alloc != RING_BUFFER_ALLOC_PER_CPU
+		|| config->mode != RING_BUFFER_DISCARD
+		|| config->output != RING_BUFFER_SPLICE
+		|| config->backend == RING_BUFFER_STATIC))
+		return -EINVAL;
+	if (config->backend == RING_BUFFER_STATIC
+	    && config->output == RING_BUFFER_MMAP)
+		return -EINVAL;
+#ifndef CONFIG_IRQ_WORK
+	if (config->wakeup == RING_BUFFER_WAKEUP_BY_WORK)
+		return -EINVAL;
+#endif
 	return 0;
 }
 
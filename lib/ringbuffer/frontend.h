@@ -61,7 +61,20 @@
  *
  * buf_addr is a pointer the the beginning of the preallocated buffer contiguous
  * address mapping. It is used only by RING_BUFFER_STATIC configuration. It can
- * be set to NULL for other backends.
+ * be set to NULL for other backends. The mapping must be page aligned, and at
+ * least channel_static_size() bytes long. If it holds the content left by a
+ * channel of the same layout, the channel recovers this content: its buffers
+ * are flushed, finalized and record-disabled, so readers get the recovered
+ * sub-buffers, then -ENODATA. channel_static_clear() discards the content:
+ * clients call it once the channel is destroyed, so that only the content
+ * left by an unclean shutdown (crash, kexec) is recovered.
+ *
+ * max_memory, when non-zero, makes the channel adaptively populated: each
+ * per-cpu buffer starts with two sub-buffers backed by pages and is grown up
+ * to num_subbuf sub-buffers as its throughput requires, with at most
+ * max_memory bytes populated for the whole channel. max_memory must hold the
+ * two initial sub-buffers of every possible CPU, or channel creation fails.
+ * Only available to per-cpu discard mode channels using splice output.
  */
 
 extern
@@ -70,7 +83,14 @@ struct channel *channel_create(const struct lib_ring_buffer_config *config,
 			       void *buf_addr,
 			       size_t subbuf_size, size_t num_subbuf,
 			       unsigned int switch_timer_interval,
-			       unsigned int read_timer_interval);
+			       unsigned int read_timer_interval,
+			       size_t max_memory);
+
+extern
+size_t channel_static_size(const struct lib_ring_buffer_config *config,
+			   size_t subbuf_size, size_t num_subbuf);
+extern
+void channel_static_clear(void *buf_addr);
 
 /*
  * channel_destroy returns the private data pointer. It finalizes all channel's
@@ -111,6 +131,10 @@ extern void lib_ring_buffer_move_consumer(struct lib_ring_buffer *buf,
 
 extern int lib_ring_buffer_get_subbuf(struct lib_ring_buffer *buf,
 				      unsigned long consumed);
+extern int lib_ring_buffer_get_subbufs(struct lib_ring_buffer *buf,
+				       unsigned long consumed, unsigned int nr);
+extern void lib_ring_buffer_select_subbuf(struct lib_ring_buffer *buf,
+					  unsigned int k);
 extern void lib_ring_buffer_put_subbuf(struct lib_ring_buffer *buf);
 
 /*
@@ -129,16 +153,58 @@ static inline int lib_ring_buffer_get_next_subbuf(struct lib_ring_buffer *buf)
 	return ret;
 }
 
+/*
+ * Get a run of up to nr consecutive sub-buffers. Returns the number of
+ * sub-buffers got, or a negative error value.
+ */
+static inline int lib_ring_buffer_get_next_subbufs(struct lib_ring_buffer *buf,
+						   unsigned int nr)
+{
+	int ret;
+
+	ret = lib_ring_buffer_snapshot(buf, &buf->cons_snapshot,
+				       &buf->prod_snapshot);
+	if (ret)
+		return ret;
+	return lib_ring_buffer_get_subbufs(buf, buf->cons_snapshot, nr);
+}
+
 static inline void lib_ring_buffer_put_next_subbuf(struct lib_ring_buffer *buf)
 {
+	struct channel *chan = buf->backend.chan;
+	unsigned long count = buf->get_subbuf_count;
+
 	lib_ring_buffer_put_subbuf(buf);
-	lib_ring_buffer_move_consumer(buf, subbuf_align(buf->cons_snapshot,
-						    buf->backend.chan));
+	lib_ring_buffer_move_consumer(buf, subbuf_align(buf->cons_snapshot, chan)
+			+ ((count - 1) << chan->backend.subbuf_size_order));
 }
 
 extern void channel_reset(struct channel *chan);
 extern void lib_ring_buffer_reset(struct lib_ring_buffer *buf);
 
+/*
+ * Buffer counters, sampled without synchronizing with the writers.
+ * bytes_produced and bytes_consumed are the free-running write and read
+ * positions, in bytes (including sub-buffer headers and padding).
+ * LIB_RING_BUFFER_STATS_INCONSISTENT is set in flags if writers kept
+ * changing the counters while they were sampled.
+ */
+#define LIB_RING_BUFFER_STATS_INCONSISTENT	(1U << 0)
+
+struct lib_ring_buffer_stats {
+	uint64_t records_count;		/* Records in delivered sub-buffers */
+	uint64_t records_overrun;	/* Records overwritten (overwrite mode) */
+	uint64_t records_lost_full;	/* Records lost: buffer full */
+	uint64_t records_lost_wrap;	/* Records lost: nested wrap-around */
+	uint64_t records_lost_big;	/* Records lost: too big for sub-buffer */
+	uint64_t bytes_produced;
+	uint64_t bytes_consumed;
+	uint64_t flags;			/* LIB_RING_BUFFER_STATS_* */
+} __attribute__((packed));
+
+extern void lib_ring_buffer_get_stats(struct lib_ring_buffer *buf,
+				     struct lib_ring_buffer_stats *stats);
+
 static inline
 unsigned long lib_ring_buffer_get_offset(const struct lib_ring_buffer_config *config,
 					 struct lib_ring_buffer *buf)
@@ -181,6 +247,12 @@ int lib_ring_buffer_channel_is_disabled(const struct channel *chan)
 	return atomic_read(&chan->record_disabled);
 }
 
+static inline
+int lib_ring_buffer_channel_is_recovered(const struct channel *chan)
+{
+	return chan->backend.static_recovered;
+}
+
 static inline
 unsigned long lib_ring_buffer_get_read_data_size(
 				const struct lib_ring_buffer_config *config,
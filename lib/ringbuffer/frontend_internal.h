@@ -31,7 +31,8 @@
 #include "../../wrapper/ringbuffer/config.h"
 #include "../../wrapper/ringbuffer/backend_types.h"
 #include "../../wrapper/ringbuffer/frontend_types.h"
-#include "../../lib/prio_heap/lttng_prio_heap.h"	/* For per-CPU read-side iterator */
+#include "../../wrapper/ringbuffer/vfs.h"		/* For the control pages */
+#include "../../lib/prio_heap/lttng_key_heap.h"	/* For per-CPU read-side iterator */
 
 /* Buffer offset macros */
 
@@ -86,6 +87,144 @@ unsigned long subbuf_index(unsigned long offset, struct channel *chan)
 	return buf_offset(offset, chan) >> chan->backend.subbuf_size_order;
 }
 
+/*
+ * The control pages of a buffer follow the buffer pages in its file mapping.
+ */
+static inline
+unsigned long lib_ring_buffer_ctrl_offset(struct channel *chan)
+{
+	unsigned long offset = chan->backend.buf_size;
+
+	if (chan->backend.extra_reader_sb)
+		offset += chan->backend.subbuf_size;
+	return offset;
+}
+
+static inline
+unsigned long lib_ring_buffer_ctrl_len(struct channel *chan)
+{
+	return PAGE_ALIGN(sizeof(struct lib_ring_buffer_ctrl_page)
+			  + chan->backend.num_subbuf * sizeof(uint64_t));
+}
+
+/*
+ * The control page fields are 64-bit wide for all kernels, but hold values of
+ * unsigned long size: each value is stored in the low-order word of its field,
+ * whose high-order word stays zero, so readers never see a torn value.
+ */
+static inline
+unsigned long *lib_ring_buffer_ctrl_word(uint64_t *field)
+{
+#if (BITS_PER_LONG == 32) && defined(__BIG_ENDIAN)
+	return (unsigned long *) field + 1;
+#else
+	return (unsigned long *) field;
+#endif
+}
+
+/*
+ * Fields with a single publisher (the reader) are stored as is.
+ */
+static inline
+void lib_ring_buffer_ctrl_set(uint64_t *field, unsigned long val)
+{
+	ACCESS_ONCE(*lib_ring_buffer_ctrl_word(field)) = val;
+}
+
+/*
+ * Positions and commit counts are published by concurrent writers, and by the
+ * reader, from values read at different times: only move them forward, so an
+ * older value never overwrites a more recent one. cmpxchg() orders the
+ * updates of a publisher: a reader seeing the write position of a delivery
+ * also sees its commit count. The fields are hints, which the get ioctls
+ * validate.
+ */
+static inline
+void lib_ring_buffer_ctrl_push(uint64_t *field, unsigned long val)
+{
+	unsigned long *word = lib_ring_buffer_ctrl_word(field);
+	unsigned long old, prev;
+
+	old = ACCESS_ONCE(*word);
+	while ((long) (val - old) > 0) {
+		prev = cmpxchg(word, old, val);
+		if (prev == old)
+			break;
+		old = prev;
+	}
+}
+
+/*
+ * Publish the buffer positions and the reader-visible commit count of
+ * sub-buffer idx in the control pages, for readers polling them. Skipped
+ * while the control pages are not mapped: lib_ring_buffer_ctrl_refresh()
+ * catches up when they are.
+ */
+static inline
+void lib_ring_buffer_ctrl_update(const struct lib_ring_buffer_config *config,
+				 struct lib_ring_buffer *buf,
+				 unsigned long idx, unsigned long commit_count)
+{
+	struct lib_ring_buffer_ctrl_page *ctrl = buf->ctrl;
+
+	if (!ctrl || !atomic_read(&buf->ctrl_mapped))
+		return;
+	lib_ring_buffer_ctrl_push(&ctrl->commit_count[idx], commit_count);
+	lib_ring_buffer_ctrl_push(&ctrl->offset, v_read(config, &buf->offset));
+	lib_ring_buffer_ctrl_push(&ctrl->consumed,
+				  atomic_long_read(&buf->consumed));
+}
+
+extern void lib_ring_buffer_ctrl_refresh(struct lib_ring_buffer *buf);
+
+/*
+ * Adaptive population is only available to per-cpu discard mode buffers read
+ * with splice(): in overwrite mode the reader exchanges sub-buffers with the
+ * writer, and mmap() readers rely on a fixed offset for each page set.
+ */
+static inline
+int lib_ring_buffer_adaptive(const struct lib_ring_buffer_config *config,
+			     struct channel *chan)
+{
+	return config->alloc == RING_BUFFER_ALLOC_PER_CPU
+	       && config->mode == RING_BUFFER_DISCARD
+	       && config->output == RING_BUFFER_SPLICE
+	       && config->backend != RING_BUFFER_STATIC
+	       && chan->backend.max_populated;
+}
+
+/*
+ * lib_ring_buffer_window_full - check if the sub-buffer containing offset is
+ * beyond the writable window, which starts at the consumed position. The
+ * window covers the whole buffer, or only the populated sub-buffers of an
+ * adaptive buffer. Discard mode only.
+ */
+static inline
+int lib_ring_buffer_window_full(const struct lib_ring_buffer_config *config,
+				struct lib_ring_buffer *buf,
+				struct channel *chan,
+				unsigned long offset)
+{
+	unsigned long consumed, window;
+
+	consumed = atomic_long_read(&buf->consumed);
+	window = chan->backend.buf_size;
+	if (lib_ring_buffer_adaptive(config, chan)) {
+		/*
+		 * Read consumed before nr_populated, and nr_populated before
+		 * the page set array. Matches the smp_wmb() in
+		 * lib_ring_buffer_adapt_consume() and
+		 * lib_ring_buffer_adapt_grow().
+		 */
+		smp_rmb();
+		window = ACCESS_ONCE(buf->backend.nr_populated)
+			 << chan->backend.subbuf_size_order;
+		smp_rmb();
+	}
+	return subbuf_trunc(offset, chan) - subbuf_trunc(consumed, chan)
+	       >= window;
+}
+
 /*
  * Last TSC comparison functions. Check if the current TSC overflows tsc_bits
  * bits from the last TSC read. When overflows are detected, the full 64-bit
@@ -290,6 +429,23 @@ int lib_ring_buffer_reserve_committed(const struct lib_ring_buffer_config *confi
 		     - (commit_count & chan->commit_count_mask) == 0);
 }
 
+/*
+ * Mark the buffer deliverable, and queue the channel wakeup work unless the
+ * buffer was already marked. The work clears the mark before waking up the
+ * buffer readers, so a delivery racing with it queues it again. Lock-free
+ * and NMI-safe.
+ */
+static inline
+void lib_ring_buffer_wakeup_deferred(struct lib_ring_buffer *buf,
+				     struct channel *chan)
+{
+#ifdef CONFIG_IRQ_WORK
+	if (!test_bit(0, &buf->wakeup_pending)
+	    && !test_and_set_bit(0, &buf->wakeup_pending))
+		irq_work_queue(&chan->wakeup_work);
+#endif
+}
+
 static inline
 void lib_ring_buffer_check_deliver(const struct lib_ring_buffer_config *config,
 				   struct lib_ring_buffer *buf,
@@ -386,6 +542,8 @@ void lib_ring_buffer_check_deliver(const struct lib_ring_buffer_config *config,
 			smp_wmb();
 			lib_ring_buffer_vmcore_check_deliver(config, buf,
 							 commit_count, idx);
+			lib_ring_buffer_ctrl_update(config, buf, idx,
+						    commit_count);
 
 			/*
 			 * RING_BUFFER_WAKEUP_BY_WRITER wakeup is not lock-free.
@@ -397,6 +555,10 @@ void lib_ring_buffer_check_deliver(const struct lib_ring_buffer_config *config,
 				wake_up_interruptible(&chan->read_wait);
 			}
 
+			if (config->wakeup == RING_BUFFER_WAKEUP_BY_WORK
+			    && atomic_long_read(&buf->active_readers))
+				lib_ring_buffer_wakeup_deferred(buf, chan);
+
 		}
 	}
 }
@@ -444,6 +606,11 @@ extern int lib_ring_buffer_create(struct lib_ring_buffer *buf,
 				  struct channel_backend *chanb, int cpu);
 extern void lib_ring_buffer_free(struct lib_ring_buffer *buf);
 
+extern struct lib_ring_buffer_page_pool *
+	lib_ring_buffer_page_pool_create(const struct lib_ring_buffer_config *config,
+					 size_t subbuf_size);
+extern void lib_ring_buffer_page_pool_destroy(struct lib_ring_buffer_page_pool *pool);
+
 /* Keep track of trap nesting inside ring buffer code */
 DECLARE_PER_CPU(unsigned int, lib_ring_buffer_nesting);
 
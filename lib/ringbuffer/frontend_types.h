@@ -29,10 +29,14 @@
  */
 
 #include <linux/kref.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <linux/irq_work.h>
 #include "../../wrapper/ringbuffer/config.h"
 #include "../../wrapper/ringbuffer/backend_types.h"
 #include "../../wrapper/spinlock.h"
-#include "../../lib/prio_heap/lttng_prio_heap.h"	/* For per-CPU read-side iterator */
+#include "../../lib/prio_heap/lttng_key_heap.h"	/* For per-CPU read-side iterator */
 
 /*
  * A switch is done during tracing or as a final flush after tracing (so it
@@ -42,11 +46,20 @@ enum switch_mode { SWITCH_ACTIVE, SWITCH_FLUSH };
 
 /* channel-level read-side iterator */
 struct channel_iter {
-	/* Prio heap of buffers. Lowest timestamps at the top. */
-	struct lttng_ptr_heap heap;	/* Heap of struct lib_ring_buffer ptrs */
+	/*
+	 * Prio heap of buffers, keyed by timestamp. Lowest timestamps at the
+	 * top.
+	 */
+	struct lttng_key_heap heap;	/* Heap of struct lib_ring_buffer ptrs */
 	struct list_head empty_head;	/* Empty buffers linked-list head */
 	int read_open;			/* Opened for reading ? */
 	u64 last_qs;			/* Last quiescent state timestamp */
+	/*
+	 * Records of the buffer at the top of the heap up to batch_limit can
+	 * be read without updating the heap. Valid if batch_valid is set.
+	 */
+	u64 batch_limit;
+	int batch_valid;
 	u64 last_timestamp;		/* Last timestamp (for WARN_ON) */
 	int last_cpu;			/* Last timestamp cpu */
 	/*
@@ -55,6 +68,8 @@ struct channel_iter {
 	unsigned long len_left;
 };
 
+struct lib_ring_buffer_page_pool;
+
 /* channel: collection of per-cpu ring buffers. */
 struct channel {
 	atomic_t record_disabled;
@@ -69,6 +84,11 @@ struct channel {
 
 	unsigned long switch_timer_interval;	/* Buffer flush (jiffies) */
 	unsigned long read_timer_interval;	/* Reader wakeup (jiffies) */
+	struct delayed_work adapt_work;		/* Adaptive population sampling */
+	struct lib_ring_buffer_page_pool *splice_pool;	/* Spliced pages */
+#ifdef CONFIG_IRQ_WORK
+	struct irq_work wakeup_work;		/* Deferred reader wakeup */
+#endif
 	struct notifier_block cpu_hp_notifier;	/* CPU hotplug notifier */
 	struct notifier_block tick_nohz_notifier; /* CPU nohz notifier */
 	struct notifier_block hp_iter_notifier;	/* hotplug iterator notifier */
@@ -110,6 +130,8 @@ struct lib_ring_buffer_iter {
 	unsigned int read_open:1;	/* Opened for reading ? */
 };
 
+struct lib_ring_buffer_output;
+
 /* ring buffer state */
 struct lib_ring_buffer {
 	/* First 32 bytes cache-hot cacheline */
@@ -142,17 +164,33 @@ struct lib_ring_buffer {
 	union v_atomic records_overrun;	/* Number of overwritten records */
 	wait_queue_head_t read_wait;	/* reader buffer-level wait queue */
 	wait_queue_head_t write_wait;	/* writer buffer-level wait queue (for metadata only) */
+	unsigned long wakeup_pending;	/* Deferred wakeup (bit 0) */
 	int finalized;			/* buffer has been finalized */
 	struct timer_list switch_timer;	/* timer for periodical switch */
 	struct timer_list read_timer;	/* timer for read poll */
+	/* Per-cpu buffers timers, serviced by the timer of their CPU */
+	struct list_head timer_node;	/* Node in the CPU timer list */
+	unsigned long switch_deadline;	/* Next periodical switch (jiffies) */
+	unsigned long read_deadline;	/* Next read poll (jiffies) */
 	raw_spinlock_t raw_tick_nohz_spinlock;	/* nohz entry lock/trylock */
 	struct lib_ring_buffer_iter iter;	/* read-side iterator */
 	unsigned long get_subbuf_consumed;	/* Read-side consumed */
+	unsigned int get_subbuf_count;	/* Sub-buffers held by reader */
+	struct page *ctrl_page;		/* Read-only control pages (mmap) */
+	struct lib_ring_buffer_ctrl_page *ctrl;	/* Control pages address */
+	atomic_t ctrl_mapped;		/* Mappings of the control pages */
+	struct lib_ring_buffer_output *output;	/* Output to file, if any */
+	struct mutex output_mutex;	/* Output attach/detach vs reads */
 	unsigned long prod_snapshot;	/* Producer count snapshot */
 	unsigned long cons_snapshot;	/* Consumer count snapshot */
+	/* Adaptive population, see lib_ring_buffer_adapt_buffer() */
+	spinlock_t adapt_lock;		/* Page set moves vs window growth */
+	unsigned long adapt_target;	/* Populated sub-buffers wanted */
+	unsigned long adapt_offset;	/* Write offset at last sample */
+	unsigned long adapt_lost_full;	/* records_lost_full at last sample */
 	unsigned int get_subbuf:1,	/* Sub-buffer being held by reader */
 		switch_timer_enabled:1,	/* Protected by ring_buffer_nohz_lock */
-		read_timer_enabled:1;	/* Protected by ring_buffer_nohz_lock */
+		read_timer_enabled:1;	/* and the CPU timer lock (per-cpu) */
 };
 
 static inline
@@ -71,6 +71,22 @@ extern void channel_iterator_release(struct channel *chan);
 extern const struct file_operations channel_payload_file_operations;
 extern const struct file_operations lib_ring_buffer_payload_file_operations;
 
+/*
+ * Packed reads return the sub-buffers content, records headers included, in
+ * chunks of at most one page, each preceded by this header. Chunks are
+ * returned whole: read() should be given at least a page and a header.
+ * Parsing the records is left to user space.
+ */
+struct lib_ring_buffer_chunk_header {
+	int32_t cpu;		/* Buffer cpu, -1 for global buffers */
+	uint32_t len;		/* Chunk length following the header */
+	uint32_t offset;	/* Chunk offset within the sub-buffer */
+	uint32_t data_size;	/* Sub-buffer data size */
+} __attribute__((packed));
+
+extern const struct file_operations channel_packed_file_operations;
+extern const struct file_operations lib_ring_buffer_packed_file_operations;
+
 /*
  * Used internally.
  */
@@ -27,12 +27,272 @@
 #include <linux/slab.h>
 #include <linux/cpu.h>
 #include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 #include "../../wrapper/vmalloc.h"	/* for wrapper_vmalloc_sync_all() */
 #include "../../wrapper/ringbuffer/config.h"
 #include "../../wrapper/ringbuffer/backend.h"
 #include "../../wrapper/ringbuffer/frontend.h"
 
+/*
+ * RING_BUFFER_STATIC memory starts with a header page, followed by one slot
+ * per buffer: nr_cpu_ids slots for per-cpu channels, a single one for global
+ * channels. Each slot holds the commit counters, the write-side sub-buffer
+ * table and the page set descriptors of its buffer, padded to a page,
+ * followed by the sub-buffers. This is all the state needed to recover the
+ * buffer content after a kexec, see lib_ring_buffer_static_recover().
+ */
+#define LIB_RING_BUFFER_STATIC_MAGIC	0x4c54544e47524230ULL	/* LTTNGRB0 */
+
+struct lib_ring_buffer_static_header {
+	uint64_t magic;
+	uint64_t subbuf_size;
+	uint64_t num_subbuf;
+	uint64_t nr_slots;
+	uint64_t slot_size;
+};
+
+static
+size_t lib_ring_buffer_static_pages_size(size_t subbuf_size)
+{
+	return ALIGN(sizeof(struct lib_ring_buffer_backend_pages)
+		     + sizeof(struct lib_ring_buffer_backend_page)
+		       * (subbuf_size >> PAGE_SHIFT),
+		     sizeof(long));
+}
+
+static
+size_t lib_ring_buffer_static_num_subbuf_alloc(const struct lib_ring_buffer_config *config,
+					       size_t num_subbuf)
+{
+	if (config->mode == RING_BUFFER_OVERWRITE)
+		return num_subbuf + 1;	/* Extra reader sub-buffer */
+	return num_subbuf;
+}
+
+static
+size_t lib_ring_buffer_static_meta_size(const struct lib_ring_buffer_config *config,
+					size_t subbuf_size, size_t num_subbuf)
+{
+	return PAGE_ALIGN((sizeof(struct commit_counters_hot)
+			   + sizeof(struct commit_counters_cold)
+			   + sizeof(struct lib_ring_buffer_backend_subbuffer))
+			  * num_subbuf
+			  + lib_ring_buffer_static_pages_size(subbuf_size)
+			    * lib_ring_buffer_static_num_subbuf_alloc(config,
+								      num_subbuf));
+}
+
+static
+size_t lib_ring_buffer_static_slot_size(const struct lib_ring_buffer_config *config,
+					size_t subbuf_size, size_t num_subbuf)
+{
+	return lib_ring_buffer_static_meta_size(config, subbuf_size, num_subbuf)
+	       + lib_ring_buffer_static_num_subbuf_alloc(config, num_subbuf)
+		 * subbuf_size;
+}
+
+static
+unsigned int lib_ring_buffer_static_nr_slots(const struct lib_ring_buffer_config *config)
+{
+	return config->alloc == RING_BUFFER_ALLOC_PER_CPU ? nr_cpu_ids : 1;
+}
+
+/**
+ * channel_static_size - size of the memory of a RING_BUFFER_STATIC channel
+ * @config: ring buffer instance configuration
+ * @subbuf_size: size of sub-buffers
+ * @num_subbuf: number of sub-buffers
+ *
+ * The buf_addr mapping passed to channel_create() must be at least this large.
+ */
+size_t channel_static_size(const struct lib_ring_buffer_config *config,
+			   size_t subbuf_size, size_t num_subbuf)
+{
+	return PAGE_SIZE + lib_ring_buffer_static_nr_slots(config)
+		* lib_ring_buffer_static_slot_size(config, subbuf_size,
+						   num_subbuf);
+}
+EXPORT_SYMBOL_GPL(channel_static_size);
+
+/**
+ * channel_static_clear - discard the content of RING_BUFFER_STATIC memory
+ * @buf_addr: static memory mapping
+ *
+ * The next channel created in this memory starts empty instead of recovering
+ * the content left by the previous one. Must not be called while a channel
+ * uses the memory.
+ */
+void channel_static_clear(void *buf_addr)
+{
+	struct lib_ring_buffer_static_header *header = buf_addr;
+
+	ACCESS_ONCE(header->magic) = 0;
+}
+EXPORT_SYMBOL_GPL(channel_static_clear);
+
+/*
+ * Attach the channel to the content left in static memory by a channel of the
+ * same layout, or initialize the memory for an empty channel.
+ */
+static
+int channel_backend_static_init(struct channel_backend *chanb, void *buf_addr)
+{
+	const struct lib_ring_buffer_config *config = &chanb->config;
+	struct lib_ring_buffer_static_header *header = buf_addr;
+	unsigned int nr_slots, i;
+
+	if (!buf_addr || offset_in_page(buf_addr))
+		return -EINVAL;
+	nr_slots = lib_ring_buffer_static_nr_slots(config);
+	chanb->static_mem = buf_addr;
+	chanb->static_slot_size =
+		lib_ring_buffer_static_slot_size(config, chanb->subbuf_size,
+						 chanb->num_subbuf);
+
+	if (header->magic == LIB_RING_BUFFER_STATIC_MAGIC) {
+		if (header->subbuf_size != chanb->subbuf_size
+		    || header->num_subbuf != chanb->num_subbuf
+		    || header->nr_slots != nr_slots
+		    || header->slot_size != chanb->static_slot_size) {
+			printk(KERN_ERR "ring_buffer: static memory holds a "
+			       "channel with a different layout\n");
+			return -EBUSY;
+		}
+		chanb->static_recovered = 1;
+		return 0;
+	}
+
+	/* Clear the state of all slots before validating the header. */
+	for (i = 0; i < nr_slots; i++)
+		memset(buf_addr + PAGE_SIZE + i * chanb->static_slot_size, 0,
+		       lib_ring_buffer_static_meta_size(config,
+						chanb->subbuf_size,
+						chanb->num_subbuf));
+	header->subbuf_size = chanb->subbuf_size;
+	header->num_subbuf = chanb->num_subbuf;
+	header->nr_slots = nr_slots;
+	header->slot_size = chanb->static_slot_size;
+	wmb();
+	header->magic = LIB_RING_BUFFER_STATIC_MAGIC;
+	return 0;
+}
+
+/**
+ * lib_ring_buffer_backend_static_counters - commit counters in static memory
+ * @bufb: buffer backend
+ *
+ * Returns the commit_hot array of a RING_BUFFER_STATIC buffer, followed by its
+ * commit_cold array.
+ */
+void *lib_ring_buffer_backend_static_counters(struct lib_ring_buffer_backend *bufb)
+{
+	struct channel_backend *chanb = &bufb->chan->backend;
+
+	return chanb->static_mem + PAGE_SIZE
+		+ max(bufb->cpu, 0) * chanb->static_slot_size;
+}
+
+/*
+ * Page sets of RING_BUFFER_STATIC buffers map the buffer slot, which has no
+ * struct page: they are only accessed through their virtual address. Their
+ * descriptors, which keep the record counts and data size of each sub-buffer,
+ * and the write-side sub-buffer table live in the slot. When the channel
+ * content is recovered, the table left by the previous kernel is checked, and
+ * the reader gets the sub-buffer the table does not reference.
+ */
+static
+int lib_ring_buffer_backend_allocate_static(const struct lib_ring_buffer_config *config,
+				     struct lib_ring_buffer_backend *bufb,
+				     size_t num_subbuf, int extra_reader_sb)
+{
+	struct channel_backend *chanb = &bufb->chan->backend;
+	int node = cpu_to_node(max(bufb->cpu, 0));
+	unsigned long num_subbuf_alloc, i, j;
+	unsigned long *referenced;
+	void *counters, *descs, *data;
+	size_t pages_size;
+	int ret = -ENOMEM;
+
+	num_subbuf_alloc = num_subbuf;
+	if (extra_reader_sb)
+		num_subbuf_alloc++;	/* Add pages for reader */
+	counters = lib_ring_buffer_backend_static_counters(bufb);
+	bufb->buf_wsb = counters + (sizeof(struct commit_counters_hot)
+				    + sizeof(struct commit_counters_cold))
+				   * num_subbuf;
+	descs = bufb->buf_wsb + num_subbuf;
+	pages_size = lib_ring_buffer_static_pages_size(chanb->subbuf_size);
+	data = counters + lib_ring_buffer_static_meta_size(config,
+							    chanb->subbuf_size,
+							    num_subbuf);
+
+	bufb->array = kzalloc_node(ALIGN(sizeof(*bufb->array)
+					 * num_subbuf_alloc,
+				  1 << INTERNODE_CACHE_SHIFT),
+			GFP_KERNEL, node);
+	if (unlikely(!bufb->array))
+		goto array_error;
+
+	/* The mapping may have moved since the previous kernel. */
+	for (i = 0; i < num_subbuf_alloc; i++) {
+		struct lib_ring_buffer_backend_pages *pages;
+
+		pages = descs + i * pages_size;
+		pages->virt = data + (i << chanb->subbuf_size_order);
+		pages->vmapped = 0;
+		for (j = 0; j < bufb->num_pages_per_subbuf; j++) {
+			pages->p[j].virt = pages->virt + (j << PAGE_SHIFT);
+			pages->p[j].page = NULL;
+		}
+		bufb->array[i] = pages;
+	}
+
+	if (!chanb->static_recovered) {
+		for (i = 0; i < num_subbuf; i++)
+			bufb->buf_wsb[i].id = subbuffer_id(config, 0, 1, i);
+		if (extra_reader_sb)
+			bufb->buf_rsb.id = subbuffer_id(config, 0, 1,
+							num_subbuf_alloc - 1);
+		else
+			bufb->buf_rsb.id = subbuffer_id(config, 0, 1, 0);
+		goto end;
+	}
+
+	referenced = kzalloc(BITS_TO_LONGS(num_subbuf_alloc) * sizeof(long),
+			     GFP_KERNEL);
+	if (!referenced)
+		goto free_array;
+	for (i = 0; i < num_subbuf; i++) {
+		unsigned long index;
+
+		index = subbuffer_id_get_index(config, bufb->buf_wsb[i].id);
+		if (index >= num_subbuf_alloc
+		    || test_and_set_bit(index, referenced)) {
+			printk(KERN_ERR "ring_buffer: corrupted static memory "
+			       "sub-buffer table, cpu %d\n", bufb->cpu);
+			kfree(referenced);
+			ret = -EINVAL;
+			goto free_array;
+		}
+	}
+	if (extra_reader_sb)
+		bufb->buf_rsb.id = subbuffer_id(config, 0, 1,
+				find_first_zero_bit(referenced,
+						    num_subbuf_alloc));
+	else
+		bufb->buf_rsb.id = subbuffer_id(config, 0, 1, 0);
+	kfree(referenced);
+end:
+	bufb->nr_populated = num_subbuf_alloc;
+	return 0;
+
+free_array:
+	kfree(bufb->array);
+array_error:
+	return ret;
+}
+
 /**
  * lib_ring_buffer_backend_allocate - allocate a channel buffer
  * @config: ring buffer instance configuration
@@ -40,6 +300,10 @@
  * @size: total size of the buffer
  * @num_subbuf: number of subbuffers
  * @extra_reader_sb: need extra subbuffer for reader
+ *
+ * Adaptively populated buffers only get pages for their first
+ * RING_BUFFER_ADAPT_MIN_SUBBUF sub-buffers. The others are populated by the
+ * frontend as the buffer throughput requires.
  */
 static
 int lib_ring_buffer_backend_allocate(const struct lib_ring_buffer_config *config,
@@ -48,62 +312,44 @@ int lib_ring_buffer_backend_allocate(const struct lib_ring_buffer_config *config
 				     int extra_reader_sb)
 {
 	struct channel_backend *chanb = &bufb->chan->backend;
-	unsigned long j, num_pages, num_pages_per_subbuf, page_idx = 0;
+	unsigned long num_pages, num_pages_per_subbuf;
 	unsigned long subbuf_size, mmap_offset = 0;
-	unsigned long num_subbuf_alloc;
-	struct page **pages;
-	void **virt;
+	unsigned long num_subbuf_alloc, num_subbuf_populated;
 	unsigned long i;
 
 	num_pages = size >> PAGE_SHIFT;
 	num_pages_per_subbuf = num_pages >> get_count_order(num_subbuf);
 	subbuf_size = chanb->subbuf_size;
 	num_subbuf_alloc = num_subbuf;
+	bufb->num_pages_per_subbuf = num_pages_per_subbuf;
 
-	if (extra_reader_sb) {
-		num_pages += num_pages_per_subbuf; /* Add pages for reader */
-		num_subbuf_alloc++;
-	}
+	if (config->backend == RING_BUFFER_STATIC)
+		return lib_ring_buffer_backend_allocate_static(config, bufb,
+						num_subbuf, extra_reader_sb);
 
-	pages = kmalloc_node(ALIGN(sizeof(*pages) * num_pages,
-				   1 << INTERNODE_CACHE_SHIFT),
-			GFP_KERNEL, cpu_to_node(max(bufb->cpu, 0)));
-	if (unlikely(!pages))
-		goto pages_error;
-
-	virt = kmalloc_node(ALIGN(sizeof(*virt) * num_pages,
-				  1 << INTERNODE_CACHE_SHIFT),
-			GFP_KERNEL, cpu_to_node(max(bufb->cpu, 0)));
-	if (unlikely(!virt))
-		goto virt_error;
+	if (extra_reader_sb)
+		num_subbuf_alloc++;	/* Add pages for reader */
+	num_subbuf_populated = num_subbuf_alloc;
+	if (chanb->max_populated)
+		num_subbuf_populated = min_t(unsigned long, num_subbuf_alloc,
+					     RING_BUFFER_ADAPT_MIN_SUBBUF);
 
-	bufb->array = kmalloc_node(ALIGN(sizeof(*bufb->array)
+	bufb->array = kzalloc_node(ALIGN(sizeof(*bufb->array)
 					 * num_subbuf_alloc,
 				  1 << INTERNODE_CACHE_SHIFT),
 			GFP_KERNEL, cpu_to_node(max(bufb->cpu, 0)));
 	if (unlikely(!bufb->array))
 		goto array_error;
 
-	for (i = 0; i < num_pages; i++) {
-		pages[i] = alloc_pages_node(cpu_to_node(max(bufb->cpu, 0)),
-					    GFP_KERNEL | __GFP_ZERO, 0);
-		if (unlikely(!pages[i]))
-			goto depopulate;
-		virt[i] = page_address(pages[i]);
-	}
-	bufb->num_pages_per_subbuf = num_pages_per_subbuf;
-
 	/* Allocate backend pages array elements */
-	for (i = 0; i < num_subbuf_alloc; i++) {
-		bufb->array[i] =
-			kzalloc_node(ALIGN(
-				sizeof(struct lib_ring_buffer_backend_pages) +
-				sizeof(struct lib_ring_buffer_backend_page)
-				* num_pages_per_subbuf,
-				1 << INTERNODE_CACHE_SHIFT),
-				GFP_KERNEL, cpu_to_node(max(bufb->cpu, 0)));
+	for (i = 0; i < num_subbuf_populated; i++) {
+		bufb->array[i] = lib_ring_buffer_backend_pages_alloc(bufb);
 		if (!bufb->array[i])
 			goto free_array;
+		if (config->output == RING_BUFFER_MMAP) {
+			bufb->array[i]->mmap_offset = mmap_offset;
+			mmap_offset += subbuf_size;
+		}
 	}
 
 	/* Allocate write-side subbuffer table */
@@ -125,42 +371,21 @@ int lib_ring_buffer_backend_allocate(const struct lib_ring_buffer_config *config
 	else
 		bufb->buf_rsb.id = subbuffer_id(config, 0, 1, 0);
 
-	/* Assign pages to page index */
-	for (i = 0; i < num_subbuf_alloc; i++) {
-		for (j = 0; j < num_pages_per_subbuf; j++) {
-			CHAN_WARN_ON(chanb, page_idx > num_pages);
-			bufb->array[i]->p[j].virt = virt[page_idx];
-			bufb->array[i]->p[j].page = pages[page_idx];
-			page_idx++;
-		}
-		if (config->output == RING_BUFFER_MMAP) {
-			bufb->array[i]->mmap_offset = mmap_offset;
-			mmap_offset += subbuf_size;
-		}
-	}
-
 	/*
 	 * If kmalloc ever uses vmalloc underneath, make sure the buffer pages
-	 * will not fault.
+	 * will not fault. This also covers virtually contiguous sub-buffers.
 	 */
 	wrapper_vmalloc_sync_all();
-	kfree(virt);
-	kfree(pages);
+	bufb->nr_populated = num_subbuf_populated;
+	if (chanb->max_populated)
+		atomic_long_add(num_subbuf_populated, &chanb->nr_populated);
 	return 0;
 
 free_array:
-	for (i = 0; (i < num_subbuf_alloc && bufb->array[i]); i++)
-		kfree(bufb->array[i]);
-depopulate:
-	/* Free all allocated pages */
-	for (i = 0; (i < num_pages && pages[i]); i++)
-		__free_page(pages[i]);
+	for (i = 0; (i < num_subbuf_populated && bufb->array[i]); i++)
+		lib_ring_buffer_backend_pages_free(bufb, bufb->array[i]);
 	kfree(bufb->array);
 array_error:
-	kfree(virt);
-virt_error:
-	kfree(pages);
-pages_error:
 	return -ENOMEM;
 }
 
@@ -180,33 +405,180 @@ int lib_ring_buffer_backend_create(struct lib_ring_buffer_backend *bufb,
 void lib_ring_buffer_backend_free(struct lib_ring_buffer_backend *bufb)
 {
 	struct channel_backend *chanb = &bufb->chan->backend;
-	unsigned long i, j, num_subbuf_alloc;
+	unsigned long i, num_subbuf_alloc;
 
 	num_subbuf_alloc = chanb->num_subbuf;
 	if (chanb->extra_reader_sb)
 		num_subbuf_alloc++;
 
-	kfree(bufb->buf_wsb);
+	if (chanb->config.backend != RING_BUFFER_STATIC)
+		kfree(bufb->buf_wsb);	/* Else in static memory */
 	for (i = 0; i < num_subbuf_alloc; i++) {
-		for (j = 0; j < bufb->num_pages_per_subbuf; j++)
-			__free_page(bufb->array[i]->p[j].page);
-		kfree(bufb->array[i]);
+		if (!bufb->array[i])
+			continue;	/* Not populated */
+		lib_ring_buffer_backend_pages_free(bufb, bufb->array[i]);
 	}
 	kfree(bufb->array);
+	if (chanb->max_populated)
+		atomic_long_sub(bufb->nr_populated, &chanb->nr_populated);
 	bufb->allocated = 0;
 }
 
+/*
+ * Allocate a physically contiguous page set for RING_BUFFER_VMAP. It is
+ * addressed through the kernel linear mapping, which most architectures map
+ * with huge pages, so it needs no page table of its own and costs fewer TLB
+ * entries than pages mapped one by one.
+ */
+static
+int lib_ring_buffer_backend_pages_contig(struct lib_ring_buffer_backend *bufb,
+				struct lib_ring_buffer_backend_pages *pages,
+				int node)
+{
+	unsigned int order;
+	struct page *page;
+	unsigned long j;
+
+	order = get_order(bufb->num_pages_per_subbuf << PAGE_SHIFT);
+	page = alloc_pages_node(node,
+			GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN | __GFP_NORETRY,
+			order);
+	if (!page)
+		return -ENOMEM;
+	/* Let splice and mmap reference each page on its own. */
+	split_page(page, order);
+	pages->virt = page_address(page);
+	for (j = 0; j < bufb->num_pages_per_subbuf; j++) {
+		pages->p[j].page = page + j;
+		pages->p[j].virt = pages->virt + (j << PAGE_SHIFT);
+	}
+	return 0;
+}
+
+/*
+ * Map a page set made of order-0 pages in the vmalloc area for
+ * RING_BUFFER_VMAP. On failure, the page set stays discontiguous and writes
+ * crossing pages are split as for RING_BUFFER_PAGE.
+ */
+static
+void lib_ring_buffer_backend_pages_vmap(struct lib_ring_buffer_backend *bufb,
+				struct lib_ring_buffer_backend_pages *pages)
+{
+	struct page **page_array;
+	unsigned long j;
+
+	page_array = kmalloc(sizeof(*page_array) * bufb->num_pages_per_subbuf,
+			     GFP_KERNEL);
+	if (!page_array)
+		return;
+	for (j = 0; j < bufb->num_pages_per_subbuf; j++)
+		page_array[j] = pages->p[j].page;
+	pages->virt = vmap(page_array, bufb->num_pages_per_subbuf, VM_MAP,
+			   PAGE_KERNEL);
+	kfree(page_array);
+	if (!pages->virt)
+		return;
+	pages->vmapped = 1;
+	for (j = 0; j < bufb->num_pages_per_subbuf; j++)
+		pages->p[j].virt = pages->virt + (j << PAGE_SHIFT);
+}
+
+/**
+ * lib_ring_buffer_backend_pages_alloc - allocate a sub-buffer page set
+ * @bufb : buffer backend
+ *
+ * Allocates the pages of one sub-buffer on the buffer's node. With
+ * RING_BUFFER_VMAP, the sub-buffer is made virtually contiguous when
+ * possible. The caller is responsible for calling wrapper_vmalloc_sync_all()
+ * before the page set is written to.
+ * Returns NULL on failure.
+ */
+struct lib_ring_buffer_backend_pages *
+	lib_ring_buffer_backend_pages_alloc(struct lib_ring_buffer_backend *bufb)
+{
+	const struct lib_ring_buffer_config *config = &bufb->chan->backend.config;
+	struct lib_ring_buffer_backend_pages *pages;
+	int node = cpu_to_node(max(bufb->cpu, 0));
+	unsigned long j;
+
+	pages = kzalloc_node(ALIGN(
+			sizeof(struct lib_ring_buffer_backend_pages) +
+			sizeof(struct lib_ring_buffer_backend_page)
+			* bufb->num_pages_per_subbuf,
+			1 << INTERNODE_CACHE_SHIFT),
+			GFP_KERNEL, node);
+	if (unlikely(!pages))
+		return NULL;
+
+	if (config->backend == RING_BUFFER_VMAP
+	    && !lib_ring_buffer_backend_pages_contig(bufb, pages, node))
+		return pages;
+
+	for (j = 0; j < bufb->num_pages_per_subbuf; j++) {
+		struct page *page;
+
+		page = alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, 0);
+		if (unlikely(!page))
+			goto depopulate;
+		pages->p[j].page = page;
+		pages->p[j].virt = page_address(page);
+	}
+	if (config->backend == RING_BUFFER_VMAP)
+		lib_ring_buffer_backend_pages_vmap(bufb, pages);
+	return pages;
+
+depopulate:
+	while (j--)
+		__free_page(pages->p[j].page);
+	kfree(pages);
+	return NULL;
+}
+
+/*
+ * May sleep when the page set is mapped in the vmalloc area.
+ */
+void lib_ring_buffer_backend_pages_free(struct lib_ring_buffer_backend *bufb,
+				struct lib_ring_buffer_backend_pages *pages)
+{
+	const struct lib_ring_buffer_config *config = &bufb->chan->backend.config;
+	unsigned long j;
+
+	if (config->backend == RING_BUFFER_STATIC)
+		return;		/* Page set in static memory */
+	if (pages->vmapped)
+		vunmap(pages->virt);
+	for (j = 0; j < bufb->num_pages_per_subbuf; j++)
+		__free_page(pages->p[j].page);
+	kfree(pages);
+}
+
 void lib_ring_buffer_backend_reset(struct lib_ring_buffer_backend *bufb)
 {
 	struct channel_backend *chanb = &bufb->chan->backend;
 	const struct lib_ring_buffer_config *config = &chanb->config;
 	unsigned long num_subbuf_alloc;
-	unsigned int i;
+	unsigned int i, j;
 
 	num_subbuf_alloc = chanb->num_subbuf;
 	if (chanb->extra_reader_sb)
 		num_subbuf_alloc++;
 
+	if (chanb->max_populated) {
+		/*
+		 * Move the populated page sets back to the first sub-buffers,
+		 * where the writable window starts after reset.
+		 */
+		for (i = 0, j = 0; i < num_subbuf_alloc; i++) {
+			struct lib_ring_buffer_backend_pages *pages;
+
+			pages = bufb->array[i];
+			if (!pages)
+				continue;
+			bufb->array[i] = NULL;
+			bufb->array[j++] = pages;
+		}
+	}
+
 	for (i = 0; i < chanb->num_subbuf; i++)
 		bufb->buf_wsb[i].id = subbuffer_id(config, 0, 1, i);
 	if (chanb->extra_reader_sb)
@@ -216,6 +588,8 @@ void lib_ring_buffer_backend_reset(struct lib_ring_buffer_backend *bufb)
 		bufb->buf_rsb.id = subbuffer_id(config, 0, 1, 0);
 
 	for (i = 0; i < num_subbuf_alloc; i++) {
+		if (!bufb->array[i])
+			continue;	/* Not populated */
 		/* Don't reset mmap_offset */
 		v_set(config, &bufb->array[i]->records_commit, 0);
 		v_set(config, &bufb->array[i]->records_unread, 0);
@@ -238,9 +612,12 @@ void channel_backend_reset(struct channel_backend *chanb)
 	/*
 	 * Don't reset buf_size, subbuf_size, subbuf_size_order,
 	 * num_subbuf_order, buf_size_order, extra_reader_sb, num_subbuf,
-	 * priv, notifiers, config, cpumask and name.
+	 * max_populated, nr_populated, static_mem, static_slot_size, priv,
+	 * notifiers, config, cpumask and name.
 	 */
 	chanb->start_tsc = config->cb.ring_buffer_clock_read(chan);
+	/* The recovered content is gone. */
+	chanb->static_recovered = 0;
 }
 
 #ifdef CONFIG_HOTPLUG_CPU
@@ -296,8 +673,13 @@ int lib_ring_buffer_cpu_hp_callback(struct notifier_block *nb,
  * @config: client ring buffer configuration
  * @priv: client private data
  * @parent: dentry of parent directory, %NULL for root directory
+ * @buf_addr: static memory mapping of RING_BUFFER_STATIC channels
  * @subbuf_size: size of sub-buffers (> PAGE_SIZE, power of 2)
  * @num_subbuf: number of sub-buffers (power of 2)
+ * @max_memory: ceiling (in bytes) of the memory populated for all buffers of
+ *              an adaptively populated channel, 0 to populate all buffers
+ *              fully. Must hold the initial sub-buffers of every possible
+ *              CPU buffer.
  *
  * Returns channel pointer if successful, %NULL otherwise.
  *
@@ -310,7 +692,8 @@ int lib_ring_buffer_cpu_hp_callback(struct notifier_block *nb,
 int channel_backend_init(struct channel_backend *chanb,
 			 const char *name,
 			 const struct lib_ring_buffer_config *config,
-			 void *priv, size_t subbuf_size, size_t num_subbuf)
+			 void *priv, void *buf_addr, size_t subbuf_size,
+			 size_t num_subbuf, size_t max_memory)
 {
 	struct channel *chan = container_of(chanb, struct channel, backend);
 	unsigned int i;
@@ -345,9 +728,26 @@ int channel_backend_init(struct channel_backend *chanb,
 	chanb->extra_reader_sb =
 			(config->mode == RING_BUFFER_OVERWRITE) ? 1 : 0;
 	chanb->num_subbuf = num_subbuf;
+	if (max_memory) {
+		chanb->max_populated = max_memory >> chanb->subbuf_size_order;
+		/*
+		 * The initial sub-buffers of each buffer count in the ceiling,
+		 * which must hold them for all possible CPUs.
+		 */
+		if (chanb->max_populated < num_possible_cpus()
+				* min_t(size_t, num_subbuf,
+					RING_BUFFER_ADAPT_MIN_SUBBUF))
+			return -EINVAL;
+	}
 	strlcpy(chanb->name, name, NAME_MAX);
 	memcpy(&chanb->config, config, sizeof(chanb->config));
 
+	if (config->backend == RING_BUFFER_STATIC) {
+		ret = channel_backend_static_init(chanb, buf_addr);
+		if (ret)
+			return ret;
+	}
+
 	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
 		if (!zalloc_cpumask_var(&chanb->cpumask, GFP_KERNEL))
 			return -ENOMEM;
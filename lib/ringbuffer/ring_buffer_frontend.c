@@ -55,11 +55,13 @@
 #include <linux/module.h>
 #include <linux/percpu.h>
 
+#include "../../wrapper/vmalloc.h"	/* for wrapper_vmalloc_sync_all() */
 #include "../../wrapper/ringbuffer/config.h"
 #include "../../wrapper/ringbuffer/backend.h"
 #include "../../wrapper/ringbuffer/frontend.h"
 #include "../../wrapper/ringbuffer/iterator.h"
 #include "../../wrapper/ringbuffer/nohz.h"
+#include "../../wrapper/ringbuffer/vfs.h"
 
 /*
  * Internal structure representing offsets to use at a sub-buffer switch.
@@ -90,6 +92,42 @@ static
 void lib_ring_buffer_print_errors(struct channel *chan,
 				  struct lib_ring_buffer *buf, int cpu);
 
+/*
+ * Control pages, see struct lib_ring_buffer_ctrl_page. They are split in
+ * order-0 pages, so the mappings can reference each page on its own.
+ */
+static
+int lib_ring_buffer_ctrl_alloc(struct lib_ring_buffer *buf,
+			       struct channel *chan, int cpu)
+{
+	unsigned int order = get_order(lib_ring_buffer_ctrl_len(chan));
+
+	buf->ctrl_page = alloc_pages_node(cpu_to_node(max(cpu, 0)),
+					  GFP_KERNEL | __GFP_ZERO, order);
+	if (!buf->ctrl_page)
+		return -ENOMEM;
+	split_page(buf->ctrl_page, order);
+	buf->ctrl = page_address(buf->ctrl_page);
+	buf->ctrl->num_subbuf = chan->backend.num_subbuf;
+	atomic_set(&buf->ctrl_mapped, 0);
+	return 0;
+}
+
+static
+void lib_ring_buffer_ctrl_free(struct lib_ring_buffer *buf)
+{
+	struct channel *chan = buf->backend.chan;
+	unsigned long i, nr_pages;
+
+	if (!buf->ctrl_page)
+		return;
+	nr_pages = 1UL << get_order(lib_ring_buffer_ctrl_len(chan));
+	for (i = 0; i < nr_pages; i++)
+		__free_page(buf->ctrl_page + i);
+	buf->ctrl_page = NULL;
+	buf->ctrl = NULL;
+}
+
 /*
  * Must be called under cpu hotplug protection.
  */
@@ -98,8 +136,11 @@ void lib_ring_buffer_free(struct lib_ring_buffer *buf)
 	struct channel *chan = buf->backend.chan;
 
 	lib_ring_buffer_print_errors(chan, buf, buf->backend.cpu);
-	kfree(buf->commit_hot);
-	kfree(buf->commit_cold);
+	lib_ring_buffer_ctrl_free(buf);
+	if (chan->backend.config.backend != RING_BUFFER_STATIC) {
+		kfree(buf->commit_hot);
+		kfree(buf->commit_cold);
+	}
 
 	lib_ring_buffer_backend_free(&buf->backend);
 }
@@ -140,7 +181,15 @@ void lib_ring_buffer_reset(struct lib_ring_buffer *buf)
 	v_set(config, &buf->records_lost_big, 0);
 	v_set(config, &buf->records_count, 0);
 	v_set(config, &buf->records_overrun, 0);
+	buf->adapt_offset = 0;
+	buf->adapt_lost_full = 0;
 	buf->finalized = 0;
+	if (buf->ctrl) {
+		buf->ctrl->offset = 0;
+		buf->ctrl->consumed = 0;
+		memset(buf->ctrl->commit_count, 0,
+		       chan->backend.num_subbuf * sizeof(uint64_t));
+	}
 }
 EXPORT_SYMBOL_GPL(lib_ring_buffer_reset);
 
@@ -168,6 +217,86 @@ void channel_reset(struct channel *chan)
 }
 EXPORT_SYMBOL_GPL(channel_reset);
 
+/*
+ * lib_ring_buffer_static_recover - rebuild the positions of a buffer from the
+ * commit counters left in static memory by a previous kernel.
+ *
+ * The hot commit count of a sub-buffer counts the bytes committed to it since
+ * the buffer was created: it tells which pass over the buffer last wrote the
+ * sub-buffer, and how far that pass went. The write position is the end of
+ * the data most recently committed; space reserved but not committed when the
+ * previous kernel stopped is lost. The sub-buffer table and the cold commit
+ * counters are made consistent with the hot commit counters, so the buffer
+ * can be flushed and read as if it had just been written. Reading starts at
+ * the oldest sub-buffer still in the buffer, after the last one never written
+ * or left incomplete. A sub-buffer a reader was exchanging with the writer
+ * may be returned out of order.
+ *
+ * Returns 0 if the buffer was never written, 1 otherwise.
+ */
+static
+int lib_ring_buffer_static_recover(struct lib_ring_buffer *buf,
+				   struct channel *chan)
+{
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	struct lib_ring_buffer_backend *bufb = &buf->backend;
+	unsigned long subbuf_size = chan->backend.subbuf_size;
+	unsigned long offset = 0, consumed, begin, cc, base, i;
+	int found = 0;
+
+	for (i = 0; i < chan->backend.num_subbuf; i++) {
+		cc = v_read(config, &buf->commit_hot[i].cc);
+		if (!cc)
+			continue;	/* Never written */
+		/* Bytes committed to this sub-buffer by the previous passes */
+		base = (cc - 1) & ~(subbuf_size - 1);
+		begin = (base << chan->backend.num_subbuf_order)
+			+ (i << chan->backend.subbuf_size_order);
+		if (!found || (long) (begin + cc - base - offset) > 0)
+			offset = begin + cc - base;
+		found = 1;
+	}
+	if (!found)
+		return 0;
+
+	for (i = 0; i < chan->backend.num_subbuf; i++) {
+		unsigned long noref = 1;
+
+		cc = v_read(config, &buf->commit_hot[i].cc);
+		if (!cc)
+			continue;
+		base = (cc - 1) & ~(subbuf_size - 1);
+		begin = (base << chan->backend.num_subbuf_order)
+			+ (i << chan->backend.subbuf_size_order);
+		if (cc - base == subbuf_size) {
+			v_set(config, &buf->commit_cold[i].cc_sb, cc);
+		} else {
+			v_set(config, &buf->commit_cold[i].cc_sb, base);
+			if (begin == subbuf_trunc(offset, chan))
+				noref = 0;	/* Being written */
+		}
+		bufb->buf_wsb[i].id = subbuffer_id(config,
+				buf_trunc_val(begin, chan), noref,
+				subbuffer_id_get_index(config,
+						       bufb->buf_wsb[i].id));
+	}
+
+	consumed = subbuf_trunc(offset, chan) - chan->backend.buf_size
+		   + subbuf_size;
+	for (begin = consumed; begin != subbuf_trunc(offset, chan);
+	     begin += subbuf_size) {
+		i = subbuf_index(begin, chan);
+		cc = v_read(config, &buf->commit_hot[i].cc);
+		if (!cc || ((cc - subbuf_size) & chan->commit_count_mask)
+			   != (buf_trunc(begin, chan)
+			       >> chan->backend.num_subbuf_order))
+			consumed = begin + subbuf_size;
+	}
+	v_set(config, &buf->offset, offset);
+	atomic_long_set(&buf->consumed, consumed);
+	return 1;
+}
+
 /*
  * Must be called under cpu hotplug protection.
  */
@@ -195,6 +324,14 @@ int lib_ring_buffer_create(struct lib_ring_buffer *buf,
 	if (ret)
 		return ret;
 
+	if (config->backend == RING_BUFFER_STATIC) {
+		buf->commit_hot =
+			lib_ring_buffer_backend_static_counters(&buf->backend);
+		buf->commit_cold = (struct commit_counters_cold *)
+			(buf->commit_hot + chan->backend.num_subbuf);
+		goto counters_done;
+	}
+
 	buf->commit_hot =
 		kzalloc_node(ALIGN(sizeof(*buf->commit_hot)
 				   * chan->backend.num_subbuf,
@@ -215,9 +352,29 @@ int lib_ring_buffer_create(struct lib_ring_buffer *buf,
 		goto free_commit;
 	}
 
+counters_done:
+	ret = lib_ring_buffer_ctrl_alloc(buf, chan, cpu);
+	if (ret)
+		goto free_counters;
 	init_waitqueue_head(&buf->read_wait);
 	init_waitqueue_head(&buf->write_wait);
 	raw_spin_lock_init(&buf->raw_tick_nohz_spinlock);
+	spin_lock_init(&buf->adapt_lock);
+	mutex_init(&buf->output_mutex);
+	buf->adapt_target = buf->backend.nr_populated;
+
+	if (chanb->static_recovered) {
+		/*
+		 * The content left by the previous kernel is read-only: deliver
+		 * the sub-buffer it was writing, and let readers reach the end
+		 * of the buffer.
+		 */
+		if (lib_ring_buffer_static_recover(buf, chan))
+			lib_ring_buffer_switch_slow(buf, SWITCH_FLUSH);
+		atomic_set(&buf->record_disabled, 1);
+		buf->finalized = 1;
+		goto header_done;
+	}
 
 	/*
 	 * Write the subbuffer header for first subbuffer so we know the total
@@ -230,6 +387,7 @@ int lib_ring_buffer_create(struct lib_ring_buffer *buf,
 	config->cb.buffer_begin(buf, tsc, 0);
 	v_add(config, subbuf_header_size, &buf->commit_hot[0].cc);
 
+header_done:
 	if (config->cb.buffer_create) {
 		ret = config->cb.buffer_create(buf, priv, cpu, chanb->name);
 		if (ret)
@@ -254,6 +412,10 @@ int lib_ring_buffer_create(struct lib_ring_buffer *buf,
 
 	/* Error handling */
 free_init:
+	lib_ring_buffer_ctrl_free(buf);
+free_counters:
+	if (config->backend == RING_BUFFER_STATIC)
+		goto free_chanbuf;	/* Counters in static memory */
 	kfree(buf->commit_cold);
 free_commit:
 	kfree(buf->commit_hot);
@@ -262,24 +424,165 @@ free_chanbuf:
 	return ret;
 }
 
-static void switch_buffer_timer(unsigned long data)
-{
-	struct lib_ring_buffer *buf = (struct lib_ring_buffer *)data;
-	struct channel *chan = buf->backend.chan;
-	const struct lib_ring_buffer_config *config = &chan->backend.config;
+/*
+ * Periodical switch and read timers.
+ *
+ * The timers of all the per-cpu buffers of a CPU are serviced by a single
+ * timer pinned on this CPU, which handles every deadline due within
+ * timer_slack at each expiry, and lets the kernel delay its expiry by as
+ * much to batch it with other timers. Global buffers have their own timers.
+ */
+struct lib_ring_buffer_cpu_timer {
+	spinlock_t lock;		/* Protects the buffer list and timer */
+	struct list_head buffers;	/* Buffers with enabled timers */
+	struct timer_list timer;
+	int cpu;
+};
+
+static DEFINE_PER_CPU(struct lib_ring_buffer_cpu_timer, ring_buffer_cpu_timer);
 
+static unsigned int timer_slack = 1000;
+module_param(timer_slack, uint, 0444);
+MODULE_PARM_DESC(timer_slack,
+	"Slack (in us) allowed on sub-buffer switch and reader wakeup timers");
+
+static
+void lib_ring_buffer_switch_timer_expired(struct lib_ring_buffer *buf)
+{
 	/*
 	 * Only flush buffers periodically if readers are active.
 	 */
 	if (atomic_long_read(&buf->active_readers))
 		lib_ring_buffer_switch_slow(buf, SWITCH_ACTIVE);
+}
 
-	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU)
-		mod_timer_pinned(&buf->switch_timer,
-				 jiffies + chan->switch_timer_interval);
-	else
-		mod_timer(&buf->switch_timer,
-			  jiffies + chan->switch_timer_interval);
+static
+void lib_ring_buffer_read_timer_expired(struct lib_ring_buffer *buf)
+{
+	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+
+	CHAN_WARN_ON(chan, !buf->backend.allocated);
+
+	if (atomic_long_read(&buf->active_readers)
+	    && lib_ring_buffer_poll_deliver(config, buf, chan)) {
+		wake_up_interruptible(&buf->read_wait);
+		wake_up_interruptible(&chan->read_wait);
+	}
+}
+
+/*
+ * Called with the cpu timer lock held.
+ */
+static
+unsigned long lib_ring_buffer_next_deadline(struct lib_ring_buffer *buf)
+{
+	if (!buf->read_timer_enabled)
+		return buf->switch_deadline;
+	if (!buf->switch_timer_enabled
+	    || time_before(buf->read_deadline, buf->switch_deadline))
+		return buf->read_deadline;
+	return buf->switch_deadline;
+}
+
+/*
+ * Runs in softirq context. The lock is taken with interrupts enabled: the
+ * buffers are serviced as the per-buffer timers would be, one after the
+ * other in the timer softirq. The other users of the lock disable
+ * interrupts, which also keeps this softirq from running on their CPU, and
+ * none of them runs in hardirq context (the nohz notifier is not called from
+ * an interrupt nested in a softirq).
+ */
+static
+void lib_ring_buffer_cpu_timer_fn(unsigned long data)
+{
+	struct lib_ring_buffer_cpu_timer *ct =
+		(struct lib_ring_buffer_cpu_timer *) data;
+	struct lib_ring_buffer *buf;
+	unsigned long due, next = 0;
+	int armed = 0;
+
+	spin_lock(&ct->lock);
+	due = jiffies + usecs_to_jiffies(timer_slack);
+	list_for_each_entry(buf, &ct->buffers, timer_node) {
+		struct channel *chan = buf->backend.chan;
+		unsigned long deadline;
+
+		if (buf->switch_timer_enabled
+		    && time_after_eq(due, buf->switch_deadline)) {
+			lib_ring_buffer_switch_timer_expired(buf);
+			buf->switch_deadline = jiffies
+				+ chan->switch_timer_interval;
+		}
+		if (buf->read_timer_enabled
+		    && time_after_eq(due, buf->read_deadline)) {
+			lib_ring_buffer_read_timer_expired(buf);
+			buf->read_deadline = jiffies
+				+ chan->read_timer_interval;
+		}
+		deadline = lib_ring_buffer_next_deadline(buf);
+		if (!armed || time_before(deadline, next)) {
+			next = deadline;
+			armed = 1;
+		}
+	}
+	/* Left unarmed once the last buffer is removed. */
+	if (armed)
+		mod_timer_pinned(&ct->timer, next);
+	spin_unlock(&ct->lock);
+}
+
+/*
+ * Enable or disable the switch and read timers of a per-cpu buffer. The
+ * buffer is not accessed by the timer of its CPU anymore once both are
+ * disabled.
+ */
+static
+void lib_ring_buffer_cpu_timer_set(struct lib_ring_buffer *buf,
+				   unsigned int switch_enabled,
+				   unsigned int read_enabled)
+{
+	struct lib_ring_buffer_cpu_timer *ct =
+		&per_cpu(ring_buffer_cpu_timer, buf->backend.cpu);
+	unsigned long flags, next;
+	int was_queued, first = 0;
+
+	spin_lock_irqsave(&ct->lock, flags);
+	was_queued = buf->switch_timer_enabled || buf->read_timer_enabled;
+	buf->switch_timer_enabled = switch_enabled;
+	buf->read_timer_enabled = read_enabled;
+	if (!switch_enabled && !read_enabled) {
+		if (was_queued)
+			list_del(&buf->timer_node);
+		goto end;
+	}
+	if (!was_queued) {
+		first = list_empty(&ct->buffers);
+		list_add(&buf->timer_node, &ct->buffers);
+	}
+	next = lib_ring_buffer_next_deadline(buf);
+	if (timer_pending(&ct->timer)) {
+		/*
+		 * A timer left armed by the last buffer removed may have
+		 * been migrated to another CPU by CPU hotplug: pin it again.
+		 */
+		if (!first && !time_before(next, ct->timer.expires))
+			goto end;
+		del_timer(&ct->timer);
+	}
+	ct->timer.expires = next;
+	add_timer_on(&ct->timer, ct->cpu);
+end:
+	spin_unlock_irqrestore(&ct->lock, flags);
+}
+
+static void switch_buffer_timer(unsigned long data)
+{
+	struct lib_ring_buffer *buf = (struct lib_ring_buffer *)data;
+	struct channel *chan = buf->backend.chan;
+
+	lib_ring_buffer_switch_timer_expired(buf);
+	mod_timer(&buf->switch_timer, jiffies + chan->switch_timer_interval);
 }
 
 /*
@@ -292,14 +595,18 @@ static void lib_ring_buffer_start_switch_timer(struct lib_ring_buffer *buf)
 
 	if (!chan->switch_timer_interval || buf->switch_timer_enabled)
 		return;
+	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
+		buf->switch_deadline = jiffies + chan->switch_timer_interval;
+		lib_ring_buffer_cpu_timer_set(buf, 1, buf->read_timer_enabled);
+		return;
+	}
 	init_timer(&buf->switch_timer);
 	buf->switch_timer.function = switch_buffer_timer;
 	buf->switch_timer.expires = jiffies + chan->switch_timer_interval;
 	buf->switch_timer.data = (unsigned long)buf;
-	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU)
-		add_timer_on(&buf->switch_timer, buf->backend.cpu);
-	else
-		add_timer(&buf->switch_timer);
+	set_timer_slack(&buf->switch_timer,
+			usecs_to_jiffies(timer_slack));
+	add_timer(&buf->switch_timer);
 	buf->switch_timer_enabled = 1;
 }
 
@@ -309,10 +616,14 @@ static void lib_ring_buffer_start_switch_timer(struct lib_ring_buffer *buf)
 static void lib_ring_buffer_stop_switch_timer(struct lib_ring_buffer *buf)
 {
 	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
 
 	if (!chan->switch_timer_interval || !buf->switch_timer_enabled)
 		return;
-
+	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
+		lib_ring_buffer_cpu_timer_set(buf, 0, buf->read_timer_enabled);
+		return;
+	}
 	del_timer_sync(&buf->switch_timer);
 	buf->switch_timer_enabled = 0;
 }
@@ -324,22 +635,9 @@ static void read_buffer_timer(unsigned long data)
 {
 	struct lib_ring_buffer *buf = (struct lib_ring_buffer *)data;
 	struct channel *chan = buf->backend.chan;
-	const struct lib_ring_buffer_config *config = &chan->backend.config;
-
-	CHAN_WARN_ON(chan, !buf->backend.allocated);
-
-	if (atomic_long_read(&buf->active_readers)
-	    && lib_ring_buffer_poll_deliver(config, buf, chan)) {
-		wake_up_interruptible(&buf->read_wait);
-		wake_up_interruptible(&chan->read_wait);
-	}
 
-	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU)
-		mod_timer_pinned(&buf->read_timer,
-				 jiffies + chan->read_timer_interval);
-	else
-		mod_timer(&buf->read_timer,
-			  jiffies + chan->read_timer_interval);
+	lib_ring_buffer_read_timer_expired(buf);
+	mod_timer(&buf->read_timer, jiffies + chan->read_timer_interval);
 }
 
 /*
@@ -354,16 +652,18 @@ static void lib_ring_buffer_start_read_timer(struct lib_ring_buffer *buf)
 	    || !chan->read_timer_interval
 	    || buf->read_timer_enabled)
 		return;
-
+	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
+		buf->read_deadline = jiffies + chan->read_timer_interval;
+		lib_ring_buffer_cpu_timer_set(buf, buf->switch_timer_enabled, 1);
+		return;
+	}
 	init_timer(&buf->read_timer);
 	buf->read_timer.function = read_buffer_timer;
 	buf->read_timer.expires = jiffies + chan->read_timer_interval;
 	buf->read_timer.data = (unsigned long)buf;
-
-	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU)
-		add_timer_on(&buf->read_timer, buf->backend.cpu);
-	else
-		add_timer(&buf->read_timer);
+	set_timer_slack(&buf->read_timer,
+			usecs_to_jiffies(timer_slack));
+	add_timer(&buf->read_timer);
 	buf->read_timer_enabled = 1;
 }
 
@@ -380,7 +680,12 @@ static void lib_ring_buffer_stop_read_timer(struct lib_ring_buffer *buf)
 	    || !buf->read_timer_enabled)
 		return;
 
-	del_timer_sync(&buf->read_timer);
+	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
+		lib_ring_buffer_cpu_timer_set(buf, buf->switch_timer_enabled, 0);
+	} else {
+		del_timer_sync(&buf->read_timer);
+		buf->read_timer_enabled = 0;
+	}
 	/*
 	 * do one more check to catch data that has been written in the last
 	 * timer period.
@@ -389,9 +694,42 @@ static void lib_ring_buffer_stop_read_timer(struct lib_ring_buffer *buf)
 		wake_up_interruptible(&buf->read_wait);
 		wake_up_interruptible(&chan->read_wait);
 	}
-	buf->read_timer_enabled = 0;
 }
 
+#ifdef CONFIG_IRQ_WORK
+static
+int lib_ring_buffer_wakeup_buffer(struct lib_ring_buffer *buf)
+{
+	if (!test_bit(0, &buf->wakeup_pending)
+	    || !test_and_clear_bit(0, &buf->wakeup_pending))
+		return 0;
+	wake_up_interruptible(&buf->read_wait);
+	return 1;
+}
+
+/*
+ * RING_BUFFER_WAKEUP_BY_WORK: wake up the readers of all the buffers marked
+ * deliverable since the last run, and the channel readers once.
+ */
+static
+void lib_ring_buffer_wakeup_work(struct irq_work *work)
+{
+	struct channel *chan = container_of(work, struct channel, wakeup_work);
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	int cpu, wakeup = 0;
+
+	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
+		for_each_channel_cpu(cpu, chan)
+			wakeup |= lib_ring_buffer_wakeup_buffer(
+				per_cpu_ptr(chan->backend.buf, cpu));
+	} else {
+		wakeup = lib_ring_buffer_wakeup_buffer(chan->backend.buf);
+	}
+	if (wakeup)
+		wake_up_interruptible(&chan->read_wait);
+}
+#endif /* CONFIG_IRQ_WORK */
+
 #ifdef CONFIG_HOTPLUG_CPU
 /**
  *	lib_ring_buffer_cpu_hp_callback - CPU hotplug callback
@@ -532,6 +870,198 @@ void notrace lib_ring_buffer_tick_nohz_restart(void)
 }
 #endif /* defined(CONFIG_NO_HZ) && defined(CONFIG_LIB_RING_BUFFER) */
 
+/*
+ * Adaptive population.
+ *
+ * An adaptively populated buffer keeps the sub-buffer geometry given at
+ * channel creation, but only its nr_populated sub-buffers starting at the
+ * consumed position are backed by pages. The writer considers the buffer full
+ * when it reaches the end of this window (see lib_ring_buffer_window_full()).
+ * The window end never moves backward, so a writer working with a stale
+ * consumed position or population count never goes past it:
+ *
+ * - when the reader releases a sub-buffer, its page set is either freed, if
+ *   the buffer has more sub-buffers populated than its target, or moved to
+ *   the sub-buffer following the window end,
+ * - a periodic work samples the bytes produced and the records lost because
+ *   the buffer was full to compute the target of each buffer, and grows the
+ *   window up to this target, within the channel memory ceiling.
+ *
+ * Page sets are only attached to, or detached from, sub-buffers outside of
+ * the writable window, so the writer fast path is left untouched. Both
+ * operations are serialized by the buffer adapt_lock.
+ */
+#define LIB_RING_BUFFER_ADAPT_INTERVAL	(HZ / 10)
+
+/*
+ * Called with adapt_lock held, after the reader released the sub-buffer at
+ * the consumed position, before moving the consumed position forward.
+ * Returns the page set to free, if any.
+ */
+static
+struct lib_ring_buffer_backend_pages *
+	lib_ring_buffer_adapt_release(struct lib_ring_buffer *buf,
+				      struct channel *chan,
+				      unsigned long consumed)
+{
+	struct lib_ring_buffer_backend *bufb = &buf->backend;
+	struct lib_ring_buffer_backend_pages *pages;
+	unsigned long idx, end_idx;
+
+	idx = subbuf_index(consumed, chan);
+	pages = bufb->array[idx];
+	if (bufb->nr_populated > ACCESS_ONCE(buf->adapt_target)) {
+		/* Shrink: the window end stays in place. */
+		bufb->array[idx] = NULL;
+		ACCESS_ONCE(bufb->nr_populated) = bufb->nr_populated - 1;
+		return pages;
+	}
+	end_idx = (idx + bufb->nr_populated) & (chan->backend.num_subbuf - 1);
+	if (end_idx == idx)
+		return NULL;	/* Fully populated */
+	CHAN_WARN_ON(chan, bufb->array[end_idx]);
+	bufb->array[end_idx] = pages;
+	bufb->array[idx] = NULL;
+	return NULL;
+}
+
+/*
+ * Page sets are freed after releasing adapt_lock, because unmapping
+ * virtually contiguous sub-buffers may sleep. Only the reader moves the
+ * consumed position in discard mode.
+ */
+static
+void lib_ring_buffer_adapt_consume(struct lib_ring_buffer *buf,
+				   struct channel *chan,
+				   unsigned long consumed_new)
+{
+	struct lib_ring_buffer_backend_pages *pages;
+	unsigned long consumed, next;
+
+	consumed = atomic_long_read(&buf->consumed);
+	while ((long) consumed - (long) consumed_new < 0) {
+		pages = NULL;
+		next = subbuf_align(consumed, chan);
+		spin_lock(&buf->adapt_lock);
+		if ((long) next - (long) consumed_new > 0)
+			next = consumed_new;	/* Sub-buffer partially read */
+		else
+			pages = lib_ring_buffer_adapt_release(buf, chan,
+							      consumed);
+		/*
+		 * Update the page set array and nr_populated before moving
+		 * the window start. Matches the smp_rmb() in
+		 * lib_ring_buffer_window_full().
+		 */
+		smp_wmb();
+		atomic_long_set(&buf->consumed, next);
+		spin_unlock(&buf->adapt_lock);
+		if (pages) {
+			lib_ring_buffer_backend_pages_free(&buf->backend,
+							   pages);
+			atomic_long_dec(&chan->backend.nr_populated);
+		}
+		consumed = next;
+	}
+}
+
+/*
+ * Populate the sub-buffer following the window end, and extend the window.
+ * Only called from the adaptive work, which is the only place where
+ * nr_populated can increase.
+ */
+static
+int lib_ring_buffer_adapt_grow(struct lib_ring_buffer *buf,
+			       struct channel *chan)
+{
+	struct lib_ring_buffer_backend *bufb = &buf->backend;
+	struct lib_ring_buffer_backend_pages *pages;
+	unsigned long end_idx;
+	int ret;
+
+	if (atomic_long_inc_return(&chan->backend.nr_populated)
+	    > chan->backend.max_populated) {
+		ret = -ENOSPC;
+		goto error;
+	}
+	pages = lib_ring_buffer_backend_pages_alloc(bufb);
+	if (!pages) {
+		ret = -ENOMEM;
+		goto error;
+	}
+	wrapper_vmalloc_sync_all();
+	spin_lock(&buf->adapt_lock);
+	end_idx = (subbuf_index(atomic_long_read(&buf->consumed), chan)
+		   + bufb->nr_populated) & (chan->backend.num_subbuf - 1);
+	CHAN_WARN_ON(chan, bufb->array[end_idx]);
+	bufb->array[end_idx] = pages;
+	/*
+	 * Populate the sub-buffer before extending the window. Matches the
+	 * smp_rmb() in lib_ring_buffer_window_full().
+	 */
+	smp_wmb();
+	ACCESS_ONCE(bufb->nr_populated) = bufb->nr_populated + 1;
+	spin_unlock(&buf->adapt_lock);
+	return 0;
+
+error:
+	atomic_long_dec(&chan->backend.nr_populated);
+	return ret;
+}
+
+static
+void lib_ring_buffer_adapt_buffer(struct lib_ring_buffer *buf,
+				  struct channel *chan)
+{
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	unsigned long offset, lost_full, nr_populated, target;
+
+	offset = v_read(config, &buf->offset);
+	lost_full = v_read(config, &buf->records_lost_full);
+	nr_populated = ACCESS_ONCE(buf->backend.nr_populated);
+
+	/*
+	 * Keep room for two sampling intervals worth of data plus the
+	 * sub-buffer being written, so the reader has a whole interval to
+	 * catch up. Double the window when records were lost because it was
+	 * full, and shrink it by at most a quarter per interval to damp
+	 * oscillations.
+	 */
+	target = (DIV_ROUND_UP(offset - buf->adapt_offset,
+			       chan->backend.subbuf_size) << 1) + 1;
+	if (lost_full != buf->adapt_lost_full)
+		target = max(target, nr_populated << 1);
+	target = max(target, nr_populated - (nr_populated >> 2));
+	target = clamp_t(unsigned long, target, RING_BUFFER_ADAPT_MIN_SUBBUF,
+			 chan->backend.num_subbuf);
+	buf->adapt_offset = offset;
+	buf->adapt_lost_full = lost_full;
+	ACCESS_ONCE(buf->adapt_target) = target;
+
+	/* The reader only shrinks the window down to the target. */
+	while (ACCESS_ONCE(buf->backend.nr_populated) < target) {
+		if (lib_ring_buffer_adapt_grow(buf, chan))
+			break;
+	}
+}
+
+static
+void lib_ring_buffer_adapt_work(struct work_struct *work)
+{
+	struct channel *chan = container_of(work, struct channel,
+					    adapt_work.work);
+	int cpu;
+
+	for_each_channel_cpu(cpu, chan) {
+		struct lib_ring_buffer *buf = per_cpu_ptr(chan->backend.buf,
+							  cpu);
+
+		lib_ring_buffer_adapt_buffer(buf, chan);
+	}
+	schedule_delayed_work(&chan->adapt_work,
+			      LIB_RING_BUFFER_ADAPT_INTERVAL);
+}
+
 /*
  * Holds CPU hotplug.
  */
@@ -540,6 +1070,8 @@ static void channel_unregister_notifiers(struct channel *chan)
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
 	int cpu;
 
+	if (lib_ring_buffer_adaptive(config, chan))
+		cancel_delayed_work_sync(&chan->adapt_work);
 	channel_iterator_unregister_notifiers(chan);
 	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
 #ifdef CONFIG_NO_HZ
@@ -585,8 +1117,13 @@ static void channel_unregister_notifiers(struct channel *chan)
 
 static void channel_free(struct channel *chan)
 {
+#ifdef CONFIG_IRQ_WORK
+	if (chan->backend.config.wakeup == RING_BUFFER_WAKEUP_BY_WORK)
+		irq_work_sync(&chan->wakeup_work);
+#endif
 	channel_iterator_free(chan);
 	channel_backend_free(&chan->backend);
+	lib_ring_buffer_page_pool_destroy(chan->splice_pool);
 	kfree(chan);
 }
 
@@ -596,14 +1133,17 @@ static void channel_free(struct channel *chan)
  * @name: name of the channel
  * @priv: ring buffer client private data
  * @buf_addr: pointer the the beginning of the preallocated buffer contiguous
- *            address mapping. It is used only by RING_BUFFER_STATIC
- *            configuration. It can be set to NULL for other backends.
+ *            address mapping, of at least channel_static_size() bytes. It is
+ *            used only by RING_BUFFER_STATIC configuration. It can be set to
+ *            NULL for other backends.
  * @subbuf_size: subbuffer size
  * @num_subbuf: number of subbuffers
  * @switch_timer_interval: Time interval (in us) to fill sub-buffers with
  *                         padding to let readers get those sub-buffers.
  *                         Used for live streaming.
  * @read_timer_interval: Time interval (in us) to wake up pending readers.
+ * @max_memory: Memory ceiling (in bytes) of an adaptively populated channel,
+ *              0 to populate all buffers fully.
  *
  * Holds cpu hotplug.
  * Returns NULL on failure.
@@ -612,21 +1152,36 @@ struct channel *channel_create(const struct lib_ring_buffer_config *config,
 		   const char *name, void *priv, void *buf_addr,
 		   size_t subbuf_size,
 		   size_t num_subbuf, unsigned int switch_timer_interval,
-		   unsigned int read_timer_interval)
+		   unsigned int read_timer_interval, size_t max_memory)
 {
 	int ret, cpu;
 	struct channel *chan;
 
 	if (lib_ring_buffer_check_config(config, switch_timer_interval,
-					 read_timer_interval))
+					 read_timer_interval, max_memory))
 		return NULL;
 
 	chan = kzalloc(sizeof(struct channel), GFP_KERNEL);
 	if (!chan)
 		return NULL;
 
+	/* Used by the flush of buffers recovered from static memory. */
+	chan->commit_count_mask = (~0UL >> get_count_order(num_subbuf));
+	init_waitqueue_head(&chan->read_wait);
+#ifdef CONFIG_IRQ_WORK
+	init_irq_work(&chan->wakeup_work, lib_ring_buffer_wakeup_work);
+#endif
+
+	if (config->output == RING_BUFFER_SPLICE) {
+		chan->splice_pool = lib_ring_buffer_page_pool_create(config,
+								 subbuf_size);
+		if (!chan->splice_pool)
+			goto error;
+	}
+
 	ret = channel_backend_init(&chan->backend, name, config, priv,
-				   subbuf_size, num_subbuf);
+				   buf_addr, subbuf_size, num_subbuf,
+				   max_memory);
 	if (ret)
 		goto error;
 
@@ -634,11 +1189,9 @@ struct channel *channel_create(const struct lib_ring_buffer_config *config,
 	if (ret)
 		goto error_free_backend;
 
-	chan->commit_count_mask = (~0UL >> chan->backend.num_subbuf_order);
 	chan->switch_timer_interval = usecs_to_jiffies(switch_timer_interval);
 	chan->read_timer_interval = usecs_to_jiffies(read_timer_interval);
 	kref_init(&chan->ref);
-	init_waitqueue_head(&chan->read_wait);
 	init_waitqueue_head(&chan->hp_wait);
 
 	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU) {
@@ -690,11 +1243,18 @@ struct channel *channel_create(const struct lib_ring_buffer_config *config,
 		lib_ring_buffer_start_read_timer(buf);
 	}
 
+	if (lib_ring_buffer_adaptive(config, chan)) {
+		INIT_DELAYED_WORK(&chan->adapt_work, lib_ring_buffer_adapt_work);
+		schedule_delayed_work(&chan->adapt_work,
+				      LIB_RING_BUFFER_ADAPT_INTERVAL);
+	}
+
 	return chan;
 
 error_free_backend:
 	channel_backend_free(&chan->backend);
 error:
+	lib_ring_buffer_page_pool_destroy(chan->splice_pool);
 	kfree(chan);
 	return NULL;
 }
@@ -746,7 +1306,8 @@ void *channel_destroy(struct channel *chan)
 			 */
 			smp_wmb();
 			ACCESS_ONCE(buf->finalized) = 1;
-			wake_up_interruptible(&buf->read_wait);
+			/* Wake exclusive waiters too: they all reach the end. */
+			wake_up_interruptible_all(&buf->read_wait);
 		}
 	} else {
 		struct lib_ring_buffer *buf = chan->backend.buf;
@@ -760,10 +1321,11 @@ void *channel_destroy(struct channel *chan)
 		 */
 		smp_wmb();
 		ACCESS_ONCE(buf->finalized) = 1;
-		wake_up_interruptible(&buf->read_wait);
+		wake_up_interruptible_all(&buf->read_wait);
 	}
 	ACCESS_ONCE(chan->finalized) = 1;
-	wake_up_interruptible(&chan->hp_wait);
+	/* Wake exclusive waiters too: they all reach the end. */
+	wake_up_interruptible_all(&chan->hp_wait);
 	wake_up_interruptible(&chan->read_wait);
 	priv = chan->backend.priv;
 	kref_put(&chan->ref, channel_release);
@@ -891,10 +1453,16 @@ void lib_ring_buffer_move_consumer(struct lib_ring_buffer *buf,
 {
 	struct lib_ring_buffer_backend *bufb = &buf->backend;
 	struct channel *chan = bufb->chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
 	unsigned long consumed;
 
 	CHAN_WARN_ON(chan, atomic_long_read(&buf->active_readers) != 1);
 
+	if (lib_ring_buffer_adaptive(config, chan)) {
+		lib_ring_buffer_adapt_consume(buf, chan, consumed_new);
+		goto end;
+	}
+
 	/*
 	 * Only push the consumed value forward.
 	 * If the consumed cmpxchg fails, this is because we have been pushed by
@@ -904,26 +1472,95 @@ void lib_ring_buffer_move_consumer(struct lib_ring_buffer *buf,
 	while ((long) consumed - (long) consumed_new < 0)
 		consumed = atomic_long_cmpxchg(&buf->consumed, consumed,
 					       consumed_new);
+end:
+	if (buf->ctrl)
+		lib_ring_buffer_ctrl_push(&buf->ctrl->consumed,
+					  atomic_long_read(&buf->consumed));
 	/* Wake-up the metadata producer */
 	wake_up_interruptible(&buf->write_wait);
 }
 EXPORT_SYMBOL_GPL(lib_ring_buffer_move_consumer);
 
+/*
+ * Publish the reader sub-buffer in the control pages.
+ */
+static
+void lib_ring_buffer_update_ctrl_read(const struct lib_ring_buffer_config *config,
+				      struct lib_ring_buffer *buf)
+{
+	struct lib_ring_buffer_ctrl_page *ctrl = buf->ctrl;
+	unsigned long sb_bindex;
+
+	if (!ctrl)
+		return;
+	sb_bindex = subbuffer_id_get_index(config, buf->backend.buf_rsb.id);
+	lib_ring_buffer_ctrl_set(&ctrl->read_sb_id, buf->backend.buf_rsb.id);
+	lib_ring_buffer_ctrl_set(&ctrl->read_sb_index, sb_bindex);
+	lib_ring_buffer_ctrl_set(&ctrl->read_mmap_offset,
+				 buf->backend.array[sb_bindex]->mmap_offset);
+	lib_ring_buffer_ctrl_set(&ctrl->read_data_size,
+				 buf->backend.array[sb_bindex]->data_size);
+}
+
+/*
+ * Bring the positions and commit counts of the control pages up to date,
+ * once they are mapped: writers do not publish them otherwise. Called after
+ * ctrl_mapped is incremented, which orders it before the counter reads.
+ */
+void lib_ring_buffer_ctrl_refresh(struct lib_ring_buffer *buf)
+{
+	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	struct lib_ring_buffer_ctrl_page *ctrl = buf->ctrl;
+	unsigned long i;
+
+	for (i = 0; i < chan->backend.num_subbuf; i++)
+		lib_ring_buffer_ctrl_push(&ctrl->commit_count[i],
+			v_read(config, &buf->commit_cold[i].cc_sb));
+	lib_ring_buffer_ctrl_push(&ctrl->offset, v_read(config, &buf->offset));
+	lib_ring_buffer_ctrl_push(&ctrl->consumed,
+				  atomic_long_read(&buf->consumed));
+}
+
+/*
+ * Check that the subbuffer at the consumed position has been fully committed,
+ * given its commit count.
+ */
+static
+int subbuf_is_committed(struct channel *chan, unsigned long commit_count,
+			unsigned long consumed)
+{
+	return !(((commit_count - chan->backend.subbuf_size)
+		  & chan->commit_count_mask)
+		 - (buf_trunc(consumed, chan)
+		    >> chan->backend.num_subbuf_order));
+}
+
 /**
- * lib_ring_buffer_get_subbuf - get exclusive access to subbuffer for reading
+ * lib_ring_buffer_get_subbufs - get exclusive access to a run of subbuffers
  * @buf: ring buffer
  * @consumed: consumed count indicating the position where to read
+ * @nr: maximum number of consecutive subbuffers to get
  *
  * Returns -ENODATA if buffer is finalized, -EAGAIN if there is currently no
- * data to read at consumed position, or 0 if the get operation succeeds.
+ * data to read at consumed position, or the number of consecutive fully
+ * committed subbuffers got (at least 1) starting at the consumed position.
  * Busy-loop trying to get data if the tick_nohz sequence lock is held.
+ *
+ * Runs of more than one subbuffer are only handed out in discard mode: in
+ * overwrite mode, the reader owns a single subbuffer, exchanged with the
+ * writer. The subbuffers of the run are accessed through
+ * lib_ring_buffer_select_subbuf(), and released together by
+ * lib_ring_buffer_put_subbuf().
  */
-int lib_ring_buffer_get_subbuf(struct lib_ring_buffer *buf,
-			       unsigned long consumed)
+int lib_ring_buffer_get_subbufs(struct lib_ring_buffer *buf,
+				unsigned long consumed, unsigned int nr)
 {
 	struct channel *chan = buf->backend.chan;
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
 	unsigned long consumed_cur, consumed_idx, commit_count, write_offset;
+	unsigned long consumed_next;
+	unsigned int nr_ready;
 	int ret;
 	int finalized;
 
@@ -934,6 +1571,11 @@ int lib_ring_buffer_get_subbuf(struct lib_ring_buffer *buf,
 		CHAN_WARN_ON(chan, 1);
 		return -EBUSY;
 	}
+	if (!nr)
+		return -EINVAL;
+	if (config->mode == RING_BUFFER_OVERWRITE)
+		nr = 1;
+	nr = min_t(unsigned int, nr, chan->backend.num_subbuf);
 retry:
 	finalized = ACCESS_ONCE(buf->finalized);
 	/*
@@ -943,6 +1585,20 @@ retry:
 	consumed_cur = atomic_long_read(&buf->consumed);
 	consumed_idx = subbuf_index(consumed, chan);
 	commit_count = v_read(config, &buf->commit_cold[consumed_idx].cc_sb);
+	/*
+	 * The following subbuffers join the run for as long as they are fully
+	 * committed. Their commit counts are read before the barrier below,
+	 * like the first one.
+	 */
+	for (nr_ready = 1; nr_ready < nr; nr_ready++) {
+		consumed_next = consumed + ((unsigned long) nr_ready
+				<< chan->backend.subbuf_size_order);
+		if (!subbuf_is_committed(chan,
+				v_read(config, &buf->commit_cold[
+					subbuf_index(consumed_next, chan)].cc_sb),
+				consumed_next))
+			break;
+	}
 	/*
 	 * Make sure we read the commit count before reading the buffer
 	 * data and the write offset. Correct consumed offset ordering
@@ -1020,20 +1676,20 @@ retry:
 	 * Check that the subbuffer we are trying to consume has been
 	 * already fully committed.
 	 */
-	if (((commit_count - chan->backend.subbuf_size)
-	     & chan->commit_count_mask)
-	    - (buf_trunc(consumed, chan)
-	       >> chan->backend.num_subbuf_order)
-	    != 0)
+	if (!subbuf_is_committed(chan, commit_count, consumed))
 		goto nodata;
 
 	/*
 	 * Check that we are not about to read the same subbuffer in
-	 * which the writer head is.
+	 * which the writer head is. The run stops before that subbuffer.
 	 */
 	if (subbuf_trunc(write_offset, chan) - subbuf_trunc(consumed, chan)
 	    == 0)
 		goto nodata;
+	nr_ready = min_t(unsigned long, nr_ready,
+			 (subbuf_trunc(write_offset, chan)
+			  - subbuf_trunc(consumed, chan))
+			 >> chan->backend.subbuf_size_order);
 
 	/*
 	 * Failure to get the subbuffer causes a busy-loop retry without going
@@ -1049,9 +1705,11 @@ retry:
 	subbuffer_id_clear_noref(config, &buf->backend.buf_rsb.id);
 
 	buf->get_subbuf_consumed = consumed;
+	buf->get_subbuf_count = nr_ready;
 	buf->get_subbuf = 1;
+	lib_ring_buffer_update_ctrl_read(config, buf);
 
-	return 0;
+	return nr_ready;
 
 nodata:
 	/*
@@ -1065,11 +1723,62 @@ nodata:
 	else
 		return -EAGAIN;
 }
+EXPORT_SYMBOL_GPL(lib_ring_buffer_get_subbufs);
+
+/**
+ * lib_ring_buffer_get_subbuf - get exclusive access to subbuffer for reading
+ * @buf: ring buffer
+ * @consumed: consumed count indicating the position where to read
+ *
+ * Returns -ENODATA if buffer is finalized, -EAGAIN if there is currently no
+ * data to read at consumed position, or 0 if the get operation succeeds.
+ * Busy-loop trying to get data if the tick_nohz sequence lock is held.
+ */
+int lib_ring_buffer_get_subbuf(struct lib_ring_buffer *buf,
+			       unsigned long consumed)
+{
+	int ret;
+
+	ret = lib_ring_buffer_get_subbufs(buf, consumed, 1);
+	return ret < 0 ? ret : 0;
+}
 EXPORT_SYMBOL_GPL(lib_ring_buffer_get_subbuf);
 
+/**
+ * lib_ring_buffer_select_subbuf - select a subbuffer of the run held by reader
+ * @buf: ring buffer
+ * @k: index of the subbuffer within the run
+ *
+ * Makes the read-side accessors (read pages, data size, mmap read offset)
+ * refer to the k-th subbuffer of the run got by lib_ring_buffer_get_subbufs().
+ * Runs only span more than one subbuffer in discard mode, where the reader
+ * subbuffer is a reference to the writer subbuffer.
+ */
+void lib_ring_buffer_select_subbuf(struct lib_ring_buffer *buf, unsigned int k)
+{
+	struct lib_ring_buffer_backend *bufb = &buf->backend;
+	struct channel *chan = bufb->chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	unsigned long consumed;
+
+	if (!buf->get_subbuf || k >= buf->get_subbuf_count) {
+		CHAN_WARN_ON(chan, 1);
+		return;
+	}
+	if (config->mode != RING_BUFFER_DISCARD)
+		return;
+	consumed = buf->get_subbuf_consumed
+		+ ((unsigned long) k << chan->backend.subbuf_size_order);
+	bufb->buf_rsb.id = bufb->buf_wsb[subbuf_index(consumed, chan)].id;
+	lib_ring_buffer_update_ctrl_read(config, buf);
+}
+EXPORT_SYMBOL_GPL(lib_ring_buffer_select_subbuf);
+
 /**
  * lib_ring_buffer_put_subbuf - release exclusive subbuffer access
  * @buf: ring buffer
+ *
+ * Releases the whole run of subbuffers got by the reader.
  */
 void lib_ring_buffer_put_subbuf(struct lib_ring_buffer *buf)
 {
@@ -1077,6 +1786,7 @@ void lib_ring_buffer_put_subbuf(struct lib_ring_buffer *buf)
 	struct channel *chan = bufb->chan;
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
 	unsigned long read_sb_bindex, consumed_idx, consumed;
+	unsigned int k;
 
 	CHAN_WARN_ON(chan, atomic_long_read(&buf->active_readers) != 1);
 
@@ -1088,20 +1798,24 @@ void lib_ring_buffer_put_subbuf(struct lib_ring_buffer *buf)
 		return;
 	}
 	consumed = buf->get_subbuf_consumed;
-	buf->get_subbuf = 0;
 
 	/*
-	 * Clear the records_unread counter. (overruns counter)
+	 * Clear the records_unread counter of each subbuffer of the run, ending
+	 * with the first one. (overruns counter)
 	 * Can still be non-zero if a file reader simply grabbed the data
 	 * without using iterators.
 	 * Can be below zero if an iterator is used on a snapshot more than
 	 * once.
 	 */
-	read_sb_bindex = subbuffer_id_get_index(config, bufb->buf_rsb.id);
-	v_add(config, v_read(config,
-			     &bufb->array[read_sb_bindex]->records_unread),
-	      &bufb->records_read);
-	v_set(config, &bufb->array[read_sb_bindex]->records_unread, 0);
+	for (k = buf->get_subbuf_count; k-- > 0;) {
+		lib_ring_buffer_select_subbuf(buf, k);
+		read_sb_bindex = subbuffer_id_get_index(config, bufb->buf_rsb.id);
+		v_add(config, v_read(config,
+				     &bufb->array[read_sb_bindex]->records_unread),
+		      &bufb->records_read);
+		v_set(config, &bufb->array[read_sb_bindex]->records_unread, 0);
+	}
+	buf->get_subbuf = 0;
 	CHAN_WARN_ON(chan, config->mode == RING_BUFFER_OVERWRITE
 		     && subbuffer_id_is_noref(config, bufb->buf_rsb.id));
 	subbuffer_id_set_noref(config, &bufb->buf_rsb.id);
@@ -1121,6 +1835,7 @@ void lib_ring_buffer_put_subbuf(struct lib_ring_buffer *buf)
 	 * update_read_sb_index return value ignored. Don't exchange sub-buffer
 	 * if the writer concurrently updated it.
 	 */
+	lib_ring_buffer_update_ctrl_read(config, buf);
 }
 EXPORT_SYMBOL_GPL(lib_ring_buffer_put_subbuf);
 
@@ -1186,6 +1901,59 @@ void lib_ring_buffer_print_buffer_errors(struct lib_ring_buffer *buf,
 						       cpu);
 }
 
+/*
+ * Number of times the counters are sampled again if writers changed them
+ * while lib_ring_buffer_get_stats() was reading them.
+ */
+#define LIB_RING_BUFFER_STATS_RETRY	3
+
+static
+void lib_ring_buffer_sample_stats(const struct lib_ring_buffer_config *config,
+				  struct lib_ring_buffer *buf,
+				  struct lib_ring_buffer_stats *stats)
+{
+	stats->bytes_produced = v_read(config, &buf->offset);
+	stats->records_count = v_read(config, &buf->records_count);
+	stats->records_overrun = v_read(config, &buf->records_overrun);
+	stats->records_lost_full = v_read(config, &buf->records_lost_full);
+	stats->records_lost_wrap = v_read(config, &buf->records_lost_wrap);
+	stats->records_lost_big = v_read(config, &buf->records_lost_big);
+	stats->bytes_consumed = atomic_long_read(&buf->consumed);
+	stats->flags = 0;
+}
+
+/**
+ * lib_ring_buffer_get_stats - Sample the buffer counters.
+ * @buf: ring buffer
+ * @stats: counters snapshot (output)
+ *
+ * Never takes any lock, and never touches the write-side cache lines other
+ * than to read them. All the counters are sampled twice in a row: the
+ * snapshot is consistent if both samples match, which is retried a few times.
+ * Otherwise the last sample is returned with LIB_RING_BUFFER_STATS_INCONSISTENT
+ * set. Lost record counters can change without the write position moving, so
+ * they are compared too. records_count is only updated at sub-buffer delivery.
+ */
+void lib_ring_buffer_get_stats(struct lib_ring_buffer *buf,
+			       struct lib_ring_buffer_stats *stats)
+{
+	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	struct lib_ring_buffer_stats check;
+	int retry = LIB_RING_BUFFER_STATS_RETRY;
+
+	lib_ring_buffer_sample_stats(config, buf, stats);
+	do {
+		smp_rmb();
+		lib_ring_buffer_sample_stats(config, buf, &check);
+		if (!memcmp(stats, &check, sizeof(check)))
+			return;
+		*stats = check;
+	} while (--retry);
+	stats->flags |= LIB_RING_BUFFER_STATS_INCONSISTENT;
+}
+EXPORT_SYMBOL_GPL(lib_ring_buffer_get_stats);
+
 static
 void lib_ring_buffer_print_errors(struct channel *chan,
 				  struct lib_ring_buffer *buf, int cpu)
@@ -1437,10 +2205,8 @@ int lib_ring_buffer_try_switch_slow(enum switch_mode mode,
 		if (likely(reserve_commit_diff == 0)) {
 			/* Next subbuffer not being written to. */
 			if (unlikely(config->mode != RING_BUFFER_OVERWRITE &&
-				subbuf_trunc(offsets->begin, chan)
-				 - subbuf_trunc((unsigned long)
-				     atomic_long_read(&buf->consumed), chan)
-				>= chan->backend.buf_size)) {
+				lib_ring_buffer_window_full(config, buf, chan,
+							    offsets->begin))) {
 				/*
 				 * We do not overwrite non consumed buffers
 				 * and we are full : don't switch.
@@ -1665,10 +2431,8 @@ retry:
 		if (likely(reserve_commit_diff == 0)) {
 			/* Next subbuffer not being written to. */
 			if (unlikely(config->mode != RING_BUFFER_OVERWRITE &&
-				subbuf_trunc(offsets->begin, chan)
-				 - subbuf_trunc((unsigned long)
-				     atomic_long_read(&buf->consumed), chan)
-				>= chan->backend.buf_size)) {
+				lib_ring_buffer_window_full(config, buf, chan,
+							    offsets->begin))) {
 				/*
 				 * We do not overwrite non consumed buffers
 				 * and we are full : record is lost.
@@ -1816,15 +2580,32 @@ int __init init_lib_ring_buffer_frontend(void)
 {
 	int cpu;
 
-	for_each_possible_cpu(cpu)
+	for_each_possible_cpu(cpu) {
+		struct lib_ring_buffer_cpu_timer *ct =
+			&per_cpu(ring_buffer_cpu_timer, cpu);
+
 		spin_lock_init(&per_cpu(ring_buffer_nohz_lock, cpu));
-	return 0;
+		spin_lock_init(&ct->lock);
+		INIT_LIST_HEAD(&ct->buffers);
+		setup_timer(&ct->timer, lib_ring_buffer_cpu_timer_fn,
+			    (unsigned long) ct);
+		set_timer_slack(&ct->timer,
+				usecs_to_jiffies(timer_slack));
+		ct->cpu = cpu;
+	}
+	return lib_ring_buffer_output_init();
 }
 
 module_init(init_lib_ring_buffer_frontend);
 
 void __exit exit_lib_ring_buffer_frontend(void)
 {
+	int cpu;
+
+	/* All buffers are gone, but the last expiry may still be armed. */
+	for_each_possible_cpu(cpu)
+		del_timer_sync(&per_cpu(ring_buffer_cpu_timer, cpu).timer);
+	lib_ring_buffer_output_exit();
 }
 
 module_exit(exit_lib_ring_buffer_frontend);
@@ -29,18 +29,66 @@
 #include <linux/jiffies.h>
 #include <linux/delay.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 
 /*
  * Safety factor taking into account internal kernel interrupt latency.
- * Assuming 250ms worse-case latency.
+ * Assuming 250ms worse-case latency by default. It sets the cadence of the
+ * quiescent state checks of channel iterators: systems with a lower latency
+ * bound can lower it.
  */
-#define MAX_SYSTEM_LATENCY	250
+static unsigned int max_system_latency = 250;
+module_param(max_system_latency, uint, 0644);
+MODULE_PARM_DESC(max_system_latency,
+	"Worst-case interrupt latency (in ms) awaited by quiescent state checks");
 
 /*
  * Maximum delta expected between trace clocks. At most 1 jiffy delta.
  */
 #define MAX_CLOCK_DELTA		(jiffies_to_usecs(1) * 1000)
 
+/*
+ * Get the next sub-buffer of the buffer for the iterator. Returns 0 on
+ * success, -EAGAIN if buffer is empty, -ENODATA if buffer is empty and
+ * finalized. On success, the iterator read offset is at the beginning of the
+ * sub-buffer.
+ */
+static
+int lib_ring_buffer_iter_get_subbuf(struct channel *chan,
+				    struct lib_ring_buffer *buf)
+{
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	struct lib_ring_buffer_iter *iter = &buf->iter;
+	int ret;
+
+	ret = lib_ring_buffer_get_next_subbuf(buf);
+	if (ret && !ACCESS_ONCE(buf->finalized)
+	    && config->alloc == RING_BUFFER_ALLOC_GLOBAL) {
+		/*
+		 * Use "pull" scheme for global buffers. The reader
+		 * itself flushes the buffer to "pull" data not visible
+		 * to readers yet. Flush current subbuffer and re-try.
+		 *
+		 * Per-CPU buffers rather use a "push" scheme because
+		 * the IPI needed to flush all CPU's buffers is too
+		 * costly. In the "push" scheme, the reader waits for
+		 * the writer periodic deferrable timer to flush the
+		 * buffers (keeping track of a quiescent state
+		 * timestamp). Therefore, the writer "pushes" data out
+		 * of the buffers rather than letting the reader "pull"
+		 * data from the buffer.
+		 */
+		lib_ring_buffer_switch_slow(buf, SWITCH_ACTIVE);
+		ret = lib_ring_buffer_get_next_subbuf(buf);
+	}
+	if (ret)
+		return ret;
+	iter->consumed = buf->cons_snapshot;
+	iter->data_size = lib_ring_buffer_get_read_data_size(config, buf);
+	iter->read_offset = iter->consumed;
+	return 0;
+}
+
 /**
  * lib_ring_buffer_get_next_record - Get the next record in a buffer.
  * @chan: channel
@@ -59,31 +107,9 @@ ssize_t lib_ring_buffer_get_next_record(struct channel *chan,
 restart:
 	switch (iter->state) {
 	case ITER_GET_SUBBUF:
-		ret = lib_ring_buffer_get_next_subbuf(buf);
-		if (ret && !ACCESS_ONCE(buf->finalized)
-		    && config->alloc == RING_BUFFER_ALLOC_GLOBAL) {
-			/*
-			 * Use "pull" scheme for global buffers. The reader
-			 * itself flushes the buffer to "pull" data not visible
-			 * to readers yet. Flush current subbuffer and re-try.
-			 *
-			 * Per-CPU buffers rather use a "push" scheme because
-			 * the IPI needed to flush all CPU's buffers is too
-			 * costly. In the "push" scheme, the reader waits for
-			 * the writer periodic deferrable timer to flush the
-			 * buffers (keeping track of a quiescent state
-			 * timestamp). Therefore, the writer "pushes" data out
-			 * of the buffers rather than letting the reader "pull"
-			 * data from the buffer.
-			 */
-			lib_ring_buffer_switch_slow(buf, SWITCH_ACTIVE);
-			ret = lib_ring_buffer_get_next_subbuf(buf);
-		}
+		ret = lib_ring_buffer_iter_get_subbuf(chan, buf);
 		if (ret)
 			return ret;
-		iter->consumed = buf->cons_snapshot;
-		iter->data_size = lib_ring_buffer_get_read_data_size(config, buf);
-		iter->read_offset = iter->consumed;
 		/* skip header */
 		iter->read_offset += config->cb.subbuffer_header_size();
 		iter->state = ITER_TEST_RECORD;
@@ -119,25 +145,31 @@ restart:
 }
 EXPORT_SYMBOL_GPL(lib_ring_buffer_get_next_record);
 
-static int buf_is_higher(void *a, void *b)
-{
-	struct lib_ring_buffer *bufa = a;
-	struct lib_ring_buffer *bufb = b;
-
-	/* Consider lowest timestamps to be at the top of the heap */
-	return (bufa->iter.timestamp < bufb->iter.timestamp);
-}
-
+/*
+ * When probe is set, only the buffers with a sub-buffer ready for delivery
+ * are read. Reading a per-cpu buffer does not flush it (the writer timer
+ * pushes its data), but getting a sub-buffer orders the commit count read
+ * before the data read: with RING_BUFFER_IPI_BARRIER, from another CPU, this
+ * is a synchronous remote_mb() call on the buffer CPU, issued even when the
+ * buffer turns out empty, and thus wasted on the buffers of idle CPUs. The
+ * probe reads the buffer counters without memory barrier, so it can miss a
+ * sub-buffer delivered concurrently: quiescent state checks need a read of
+ * all buffers.
+ */
 static
 void lib_ring_buffer_get_empty_buf_records(const struct lib_ring_buffer_config *config,
-					   struct channel *chan)
+					   struct channel *chan, int probe)
 {
-	struct lttng_ptr_heap *heap = &chan->iter.heap;
+	struct lttng_key_heap *heap = &chan->iter.heap;
 	struct lib_ring_buffer *buf, *tmp;
+	size_t nr_added = 0;
 	ssize_t len;
 
 	list_for_each_entry_safe(buf, tmp, &chan->iter.empty_head,
 				 iter.empty_node) {
+		if (probe && !ACCESS_ONCE(buf->finalized)
+		    && !lib_ring_buffer_poll_deliver(config, buf, chan))
+			continue;
 		len = lib_ring_buffer_get_next_record(chan, buf);
 
 		/*
@@ -162,14 +194,21 @@ void lib_ring_buffer_get_empty_buf_records(const struct lib_ring_buffer_config *
 			break;
 		default:
 			/*
-			 * Insert buffer into the heap, remove from empty buffer
-			 * list.
+			 * Add buffer to the heap, remove from empty buffer
+			 * list. The heap is rebalanced once all buffers are
+			 * added.
 			 */
 			CHAN_WARN_ON(chan, len < 0);
 			list_del(&buf->iter.empty_node);
-			CHAN_WARN_ON(chan, lttng_heap_insert(heap, buf));
+			CHAN_WARN_ON(chan, lttng_key_heap_append(heap,
+					buf->iter.timestamp, buf));
+			nr_added++;
 		}
 	}
+	if (nr_added) {
+		lttng_key_heap_build(heap);
+		chan->iter.batch_valid = 0;
+	}
 }
 
 static
@@ -191,11 +230,11 @@ void lib_ring_buffer_wait_for_qs(const struct lib_ring_buffer_config *config,
 	 * Do a get next buf record on each of them. Add them to
 	 * the heap if they have data. If at least one of them
 	 * don't have data, we need to wait for
-	 * switch_timer_interval + MAX_SYSTEM_LATENCY (so we are sure the
+	 * switch_timer_interval + max_system_latency (so we are sure the
 	 * buffers have been switched either by the timer or idle entry) and
 	 * check them again, adding them if they have data.
 	 */
-	lib_ring_buffer_get_empty_buf_records(config, chan);
+	lib_ring_buffer_get_empty_buf_records(config, chan, 1);
 
 	/*
 	 * No need to wait if no empty buffers are present.
@@ -210,9 +249,9 @@ void lib_ring_buffer_wait_for_qs(const struct lib_ring_buffer_config *config,
 	 * empty buffers belong to idle or offline cpus.
 	 */
 	wait_msecs = jiffies_to_msecs(chan->switch_timer_interval);
-	wait_msecs += MAX_SYSTEM_LATENCY;
+	wait_msecs += ACCESS_ONCE(max_system_latency);
 	msleep(wait_msecs);
-	lib_ring_buffer_get_empty_buf_records(config, chan);
+	lib_ring_buffer_get_empty_buf_records(config, chan, 0);
 	/*
 	 * Any buffer still in the empty list here cannot possibly
 	 * contain an event with a timestamp prior to "timestamp_qs".
@@ -222,6 +261,26 @@ void lib_ring_buffer_wait_for_qs(const struct lib_ring_buffer_config *config,
 	 * merge.
 	 */
 	chan->iter.last_qs = timestamp_qs;
+	chan->iter.batch_valid = 0;
+}
+
+/*
+ * The buffer at the top of the heap stays there for as long as its records
+ * are not newer than the ones at the top of its children, and can be read
+ * without quiescent state check up to last_qs. Computing this limit once per
+ * batch saves a heap rebalancing for each record.
+ */
+static
+void channel_update_batch_limit(struct channel *chan)
+{
+	struct lttng_key_heap *heap = &chan->iter.heap;
+	u64 limit = chan->iter.last_qs;
+	size_t i;
+
+	for (i = 1; i < min_t(size_t, heap->len, 3); i++)
+		limit = min(limit, heap->entries[i].key);
+	chan->iter.batch_limit = limit;
+	chan->iter.batch_valid = 1;
 }
 
 /**
@@ -239,7 +298,7 @@ ssize_t channel_get_next_record(struct channel *chan,
 {
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
 	struct lib_ring_buffer *buf;
-	struct lttng_ptr_heap *heap;
+	struct lttng_key_heap *heap;
 	ssize_t len;
 
 	if (config->alloc == RING_BUFFER_ALLOC_GLOBAL) {
@@ -252,7 +311,7 @@ ssize_t channel_get_next_record(struct channel *chan,
 	/*
 	 * get next record for topmost buffer.
 	 */
-	buf = lttng_heap_maximum(heap);
+	buf = lttng_key_heap_minimum(heap);
 	if (buf) {
 		len = lib_ring_buffer_get_next_record(chan, buf);
 		/*
@@ -264,7 +323,8 @@ ssize_t channel_get_next_record(struct channel *chan,
 			buf->iter.timestamp = 0;
 			list_add(&buf->iter.empty_node, &chan->iter.empty_head);
 			/* Remove topmost buffer from the heap */
-			CHAN_WARN_ON(chan, lttng_heap_remove(heap) != buf);
+			CHAN_WARN_ON(chan, lttng_key_heap_remove(heap) != buf);
+			chan->iter.batch_valid = 0;
 			break;
 		case -ENODATA:
 			/*
@@ -272,24 +332,37 @@ ssize_t channel_get_next_record(struct channel *chan,
 			 * don't add to list of empty buffer, because it has no
 			 * more data to provide, ever.
 			 */
-			CHAN_WARN_ON(chan, lttng_heap_remove(heap) != buf);
+			CHAN_WARN_ON(chan, lttng_key_heap_remove(heap) != buf);
+			chan->iter.batch_valid = 0;
 			break;
 		case -EBUSY:
 			CHAN_WARN_ON(chan, 1);
 			break;
 		default:
+			CHAN_WARN_ON(chan, len < 0);
+			/*
+			 * Within the batch, the buffer stays at the top of the
+			 * heap.
+			 */
+			if (chan->iter.batch_valid
+			    && buf->iter.timestamp <= chan->iter.batch_limit) {
+				lttng_key_heap_update_min_key(heap,
+						buf->iter.timestamp);
+				break;
+			}
 			/*
 			 * Reinsert buffer into the heap. Note that heap can be
 			 * partially empty, so we need to use
-			 * lttng_heap_replace_max().
+			 * lttng_key_heap_replace_min().
 			 */
-			CHAN_WARN_ON(chan, len < 0);
-			CHAN_WARN_ON(chan, lttng_heap_replace_max(heap, buf) != buf);
+			CHAN_WARN_ON(chan, lttng_key_heap_replace_min(heap,
+					buf->iter.timestamp, buf) != buf);
+			chan->iter.batch_valid = 0;
 			break;
 		}
 	}
 
-	buf = lttng_heap_maximum(heap);
+	buf = lttng_key_heap_minimum(heap);
 	if (!buf || buf->iter.timestamp > chan->iter.last_qs) {
 		/*
 		 * Deal with buffers previously showing no data.
@@ -299,8 +372,10 @@ ssize_t channel_get_next_record(struct channel *chan,
 		lib_ring_buffer_wait_for_qs(config, chan);
 	}
 
-	*ret_buf = buf = lttng_heap_maximum(heap);
+	*ret_buf = buf = lttng_key_heap_minimum(heap);
 	if (buf) {
+		if (!chan->iter.batch_valid)
+			channel_update_batch_limit(chan);
 		/*
 		 * If this warning triggers, you probably need to check your
 		 * system interrupt latency. Typical causes: too many printk()
@@ -332,6 +407,85 @@ ssize_t channel_get_next_record(struct channel *chan,
 }
 EXPORT_SYMBOL_GPL(channel_get_next_record);
 
+/*
+ * Get the next chunk of the buffer for packed reads: the data of the
+ * sub-buffer being read, from the iterator read offset up to the next page
+ * boundary. The sub-buffer is held until its last chunk is read.
+ *
+ * Returns the chunk length, -EAGAIN if buffer is empty, -ENODATA if buffer is
+ * empty and finalized.
+ */
+static
+ssize_t lib_ring_buffer_get_next_chunk(struct channel *chan,
+				       struct lib_ring_buffer *buf)
+{
+	struct lib_ring_buffer_iter *iter = &buf->iter;
+	unsigned long pos;
+	int ret;
+
+restart:
+	switch (iter->state) {
+	case ITER_GET_SUBBUF:
+		ret = lib_ring_buffer_iter_get_subbuf(chan, buf);
+		if (ret)
+			return ret;
+		iter->state = ITER_TEST_RECORD;
+		goto restart;
+	case ITER_TEST_RECORD:
+		pos = iter->read_offset - iter->consumed;
+		if (pos >= iter->data_size) {
+			lib_ring_buffer_put_next_subbuf(buf);
+			iter->state = ITER_GET_SUBBUF;
+			goto restart;
+		}
+		return min_t(unsigned long, iter->data_size - pos,
+			     PAGE_SIZE - (iter->read_offset & ~PAGE_MASK));
+	default:
+		CHAN_WARN_ON(chan, 1);	/* Should not happen */
+		return -EPERM;
+	}
+}
+
+/*
+ * Get the next chunk of a channel for packed reads. Per-cpu buffers are
+ * visited in turn, starting with the one read last, which holds the
+ * remaining chunks of its current sub-buffer. Records are not merged:
+ * user space orders them. Returns the current buffer in ret_buf.
+ */
+static
+ssize_t channel_get_next_chunk(struct channel *chan,
+			       struct lib_ring_buffer **ret_buf)
+{
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	struct lib_ring_buffer *buf;
+	ssize_t len, ret = -ENODATA;
+	int cpu, pass;
+
+	if (config->alloc == RING_BUFFER_ALLOC_GLOBAL) {
+		*ret_buf = channel_get_ring_buffer(config, chan, 0);
+		return lib_ring_buffer_get_next_chunk(chan, *ret_buf);
+	}
+
+	for (pass = 0; pass < 2; pass++) {
+		for_each_channel_cpu(cpu, chan) {
+			/* First pass from last_cpu, second pass up to it. */
+			if (pass ? cpu >= chan->iter.last_cpu
+				 : cpu < chan->iter.last_cpu)
+				continue;
+			buf = channel_get_ring_buffer(config, chan, cpu);
+			len = lib_ring_buffer_get_next_chunk(chan, buf);
+			if (len >= 0) {
+				chan->iter.last_cpu = cpu;
+				*ret_buf = buf;
+				return len;
+			}
+			if (len != -ENODATA)
+				ret = len;
+		}
+	}
+	return ret;
+}
+
 static
 void lib_ring_buffer_iterator_init(struct channel *chan, struct lib_ring_buffer *buf)
 {
@@ -388,9 +542,9 @@ int channel_iterator_init(struct channel *chan)
 		int cpu, ret;
 
 		INIT_LIST_HEAD(&chan->iter.empty_head);
-		ret = lttng_heap_init(&chan->iter.heap,
+		ret = lttng_key_heap_init(&chan->iter.heap,
 				num_possible_cpus(),
-				GFP_KERNEL, buf_is_higher);
+				GFP_KERNEL);
 		if (ret)
 			return ret;
 		/*
@@ -438,7 +592,7 @@ void channel_iterator_free(struct channel *chan)
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
 
 	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU)
-		lttng_heap_free(&chan->iter.heap);
+		lttng_key_heap_free(&chan->iter.heap);
 }
 
 int lib_ring_buffer_iterator_open(struct lib_ring_buffer *buf)
@@ -526,8 +680,9 @@ void lib_ring_buffer_iterator_reset(struct lib_ring_buffer *buf)
 		lib_ring_buffer_put_next_subbuf(buf);
 	buf->iter.state = ITER_GET_SUBBUF;
 	/* Remove from heap (if present). */
-	if (lttng_heap_cherrypick(&chan->iter.heap, buf))
+	if (lttng_key_heap_cherrypick(&chan->iter.heap, buf))
 		list_add(&buf->iter.empty_node, &chan->iter.empty_head);
+	chan->iter.batch_valid = 0;
 	buf->iter.timestamp = 0;
 	buf->iter.header_len = 0;
 	buf->iter.payload_len = 0;
@@ -544,7 +699,7 @@ void channel_iterator_reset(struct channel *chan)
 	int cpu;
 
 	/* Empty heap, put into empty_head */
-	while ((buf = lttng_heap_remove(&chan->iter.heap)) != NULL)
+	while ((buf = lttng_key_heap_remove(&chan->iter.heap)) != NULL)
 		list_add(&buf->iter.empty_node, &chan->iter.empty_head);
 
 	for_each_channel_cpu(cpu, chan) {
@@ -553,6 +708,7 @@ void channel_iterator_reset(struct channel *chan)
 	}
 	/* Don't reset read_open */
 	chan->iter.last_qs = 0;
+	chan->iter.batch_valid = 0;
 	chan->iter.last_timestamp = 0;
 	chan->iter.last_cpu = 0;
 	chan->iter.len_left = 0;
@@ -585,7 +741,7 @@ ssize_t channel_ring_buffer_file_read(struct file *filp,
 			read_offset = *ppos;
 			if (config->alloc == RING_BUFFER_ALLOC_PER_CPU
 			    && fusionmerge)
-				buf = lttng_heap_maximum(&chan->iter.heap);
+				buf = lttng_key_heap_minimum(&chan->iter.heap);
 			CHAN_WARN_ON(chan, !buf);
 			goto skip_get_next;
 		}
@@ -674,6 +830,104 @@ nodata:
 	return read_count;
 }
 
+/*
+ * Ring buffer packed read() implementation. Copies the sub-buffers content
+ * in chunks of at most one page, each preceded by a
+ * struct lib_ring_buffer_chunk_header. A chunk is never split across read()
+ * calls: the read stops before a chunk which does not fit, and fails with
+ * -EINVAL if the first one does not.
+ */
+static
+ssize_t channel_ring_buffer_file_read_packed(struct file *filp,
+					     char __user *user_buf,
+					     size_t count,
+					     struct channel *chan,
+					     struct lib_ring_buffer *buf,
+					     int fusionmerge)
+{
+	struct lib_ring_buffer_chunk_header header;
+	size_t read_count = 0, copy_len;
+	ssize_t len;
+
+	might_sleep();
+	if (count <= sizeof(header))
+		return -EINVAL;
+	if (!access_ok(VERIFY_WRITE, user_buf, count))
+		return -EFAULT;
+
+	while (read_count + sizeof(header) < count) {
+		if (fusionmerge)
+			len = channel_get_next_chunk(chan, &buf);
+		else
+			len = lib_ring_buffer_get_next_chunk(chan, buf);
+len_test:
+		if (len < 0) {
+			/*
+			 * Check if buffer is finalized (end of file).
+			 */
+			if (len == -ENODATA)
+				break;
+			if (filp->f_flags & O_NONBLOCK) {
+				if (!read_count)
+					return -EAGAIN;
+				break;
+			} else {
+				int error;
+
+				/*
+				 * No data available at the moment, return what
+				 * we got.
+				 */
+				if (read_count)
+					break;
+
+				/*
+				 * Wait for returned len to be >= 0 or -ENODATA.
+				 */
+				if (fusionmerge)
+					error = wait_event_interruptible(
+					  chan->read_wait,
+					  ((len = channel_get_next_chunk(chan,
+						&buf)), len != -EAGAIN));
+				else
+					error = wait_event_interruptible(
+					  buf->read_wait,
+					  ((len = lib_ring_buffer_get_next_chunk(
+						  chan, buf)), len != -EAGAIN));
+				if (error)
+					return error;
+				CHAN_WARN_ON(chan, len < 0 && len != -ENODATA);
+				goto len_test;
+			}
+		}
+		/*
+		 * Leave a chunk which does not fit in the user buffer for the
+		 * next read(): its header describes the whole chunk.
+		 */
+		if (len > count - read_count - sizeof(header)) {
+			if (!read_count)
+				return -EINVAL;
+			break;
+		}
+		copy_len = len;
+		header.cpu = buf->backend.cpu;
+		header.len = copy_len;
+		header.offset = buf->iter.read_offset - buf->iter.consumed;
+		header.data_size = buf->iter.data_size;
+		if (__copy_to_user(&user_buf[read_count], &header,
+				   sizeof(header)))
+			return -EFAULT;
+		read_count += sizeof(header);
+		if (__lib_ring_buffer_copy_to_user(&buf->backend,
+					buf->iter.read_offset,
+					&user_buf[read_count], copy_len))
+			return -EFAULT;
+		buf->iter.read_offset += copy_len;
+		read_count += copy_len;
+	}
+	return read_count;
+}
+
 /**
  * lib_ring_buffer_file_read - Read buffer record payload.
  * @filp: file structure pointer.
@@ -731,6 +985,53 @@ ssize_t channel_file_read(struct file *filp,
 	}
 }
 
+/**
+ * lib_ring_buffer_file_read_packed - Read buffer content in chunks.
+ * @filp: file structure pointer.
+ * @buffer: user buffer to read data into.
+ * @count: number of bytes to read.
+ * @ppos: file read position.
+ *
+ * Returns a negative value on error, or the number of bytes read on success.
+ * Returns -EINVAL if count cannot hold the next chunk and its header.
+ */
+static
+ssize_t lib_ring_buffer_file_read_packed(struct file *filp,
+					 char __user *user_buf,
+					 size_t count,
+					 loff_t *ppos)
+{
+	struct inode *inode = filp->f_dentry->d_inode;
+	struct lib_ring_buffer *buf = inode->i_private;
+	struct channel *chan = buf->backend.chan;
+
+	return channel_ring_buffer_file_read_packed(filp, user_buf, count,
+						    chan, buf, 0);
+}
+
+/**
+ * channel_file_read_packed - Read channel buffers content in chunks.
+ * @filp: file structure pointer.
+ * @buffer: user buffer to read data into.
+ * @count: number of bytes to read.
+ * @ppos: file read position.
+ *
+ * Returns a negative value on error, or the number of bytes read on success.
+ * Returns -EINVAL if count cannot hold the next chunk and its header.
+ */
+static
+ssize_t channel_file_read_packed(struct file *filp,
+				 char __user *user_buf,
+				 size_t count,
+				 loff_t *ppos)
+{
+	struct inode *inode = filp->f_dentry->d_inode;
+	struct channel *chan = inode->i_private;
+
+	return channel_ring_buffer_file_read_packed(filp, user_buf, count,
+						    chan, NULL, 1);
+}
+
 static
 int lib_ring_buffer_file_open(struct inode *inode, struct file *file)
 {
@@ -808,3 +1109,21 @@ const struct file_operations lib_ring_buffer_payload_file_operations = {
 	.llseek = vfs_lib_ring_buffer_no_llseek,
 };
 EXPORT_SYMBOL_GPL(lib_ring_buffer_payload_file_operations);
+
+const struct file_operations channel_packed_file_operations = {
+	.owner = THIS_MODULE,
+	.open = channel_file_open,
+	.release = channel_file_release,
+	.read = channel_file_read_packed,
+	.llseek = vfs_lib_ring_buffer_no_llseek,
+};
+EXPORT_SYMBOL_GPL(channel_packed_file_operations);
+
+const struct file_operations lib_ring_buffer_packed_file_operations = {
+	.owner = THIS_MODULE,
+	.open = lib_ring_buffer_file_open,
+	.release = lib_ring_buffer_file_release,
+	.read = lib_ring_buffer_file_read_packed,
+	.llseek = vfs_lib_ring_buffer_no_llseek,
+};
+EXPORT_SYMBOL_GPL(lib_ring_buffer_packed_file_operations);
@@ -29,35 +29,56 @@
 #include "../../wrapper/ringbuffer/frontend.h"
 #include "../../wrapper/ringbuffer/vfs.h"
 
+/*
+ * Get the page at mmap offset within the sub-buffers owned by the reader: the
+ * whole run got by RING_BUFFER_GET_NEXT_SUBBUFS, or the reader sub-buffer.
+ * Returns NULL if the offset is outside of them.
+ */
+static
+struct page **lib_ring_buffer_mmap_get_page(struct lib_ring_buffer *buf,
+					    unsigned long offset)
+{
+	struct lib_ring_buffer_backend *bufb = &buf->backend;
+	struct channel *chan = bufb->chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	struct lib_ring_buffer_backend_pages *rpages;
+	unsigned long consumed, id;
+	unsigned int k, count = 1;
+
+	/* Runs only span more than one sub-buffer in discard mode. */
+	if (config->mode == RING_BUFFER_DISCARD && buf->get_subbuf)
+		count = buf->get_subbuf_count;
+	consumed = buf->get_subbuf_consumed;
+	for (k = 0; k < count; k++) {
+		if (count > 1)
+			id = bufb->buf_wsb[subbuf_index(consumed
+				+ ((unsigned long) k << chan->backend.subbuf_size_order),
+				chan)].id;
+		else
+			id = bufb->buf_rsb.id;
+		rpages = bufb->array[subbuffer_id_get_index(config, id)];
+		if (offset >= rpages->mmap_offset
+		    && offset < rpages->mmap_offset + chan->backend.subbuf_size)
+			return &rpages->p[(offset - rpages->mmap_offset)
+					  >> PAGE_SHIFT].page;
+	}
+	return NULL;
+}
+
 /*
  * fault() vm_op implementation for ring buffer file mapping.
  */
 static int lib_ring_buffer_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 {
 	struct lib_ring_buffer *buf = vma->vm_private_data;
-	struct channel *chan = buf->backend.chan;
-	const struct lib_ring_buffer_config *config = &chan->backend.config;
-	pgoff_t pgoff = vmf->pgoff;
 	struct page **page;
-	void **virt;
-	unsigned long offset, sb_bindex;
 
 	/*
 	 * Verify that faults are only done on the range of pages owned by the
 	 * reader.
 	 */
-	offset = pgoff << PAGE_SHIFT;
-	sb_bindex = subbuffer_id_get_index(config, buf->backend.buf_rsb.id);
-	if (!(offset >= buf->backend.array[sb_bindex]->mmap_offset
-	      && offset < buf->backend.array[sb_bindex]->mmap_offset +
-			  buf->backend.chan->backend.subbuf_size))
-		return VM_FAULT_SIGBUS;
-	/*
-	 * ring_buffer_read_get_page() gets the page in the current reader's
-	 * pages.
-	 */
-	page = lib_ring_buffer_read_get_page(&buf->backend, offset, &virt);
-	if (!*page)
+	page = lib_ring_buffer_mmap_get_page(buf, vmf->pgoff << PAGE_SHIFT);
+	if (!page || !*page)
 		return VM_FAULT_SIGBUS;
 	get_page(*page);
 	vmf->page = *page;
@@ -72,6 +93,97 @@ static const struct vm_operations_struct lib_ring_buffer_mmap_ops = {
 	.fault = lib_ring_buffer_fault,
 };
 
+/*
+ * Populated mappings have all their pages inserted at mmap time.
+ */
+static int lib_ring_buffer_populated_fault(struct vm_area_struct *vma,
+					   struct vm_fault *vmf)
+{
+	return VM_FAULT_SIGBUS;
+}
+
+/*
+ * Populated mappings include the control pages: count them, so writers only
+ * publish positions while someone can read them.
+ */
+static void lib_ring_buffer_populated_open(struct vm_area_struct *vma)
+{
+	struct lib_ring_buffer *buf = vma->vm_private_data;
+
+	atomic_inc(&buf->ctrl_mapped);
+}
+
+static void lib_ring_buffer_populated_close(struct vm_area_struct *vma)
+{
+	struct lib_ring_buffer *buf = vma->vm_private_data;
+
+	atomic_dec(&buf->ctrl_mapped);
+}
+
+static const struct vm_operations_struct lib_ring_buffer_mmap_populated_ops = {
+	.open = lib_ring_buffer_populated_open,
+	.close = lib_ring_buffer_populated_close,
+	.fault = lib_ring_buffer_populated_fault,
+};
+
+/*
+ * Insert the control pages at addr, read-only.
+ */
+static int lib_ring_buffer_mmap_ctrl(struct lib_ring_buffer *buf,
+				     struct vm_area_struct *vma,
+				     unsigned long addr)
+{
+	unsigned long i, ctrl_len;
+	int ret;
+
+	ctrl_len = lib_ring_buffer_ctrl_len(buf->backend.chan);
+	for (i = 0; i < ctrl_len >> PAGE_SHIFT; i++) {
+		ret = vm_insert_page(vma, addr + (i << PAGE_SHIFT),
+				     buf->ctrl_page + i);
+		if (ret)
+			return ret;
+	}
+	return 0;
+}
+
+/*
+ * Insert all the buffer pages at their mmap offset, followed by the control
+ * pages, so the reader never takes a fault on the buffer. Each inserted page
+ * holds a reference, which keeps it alive until the mapping goes away. The
+ * pages of the writer sub-buffers are mapped too: the reader uses the control
+ * pages or RING_BUFFER_GET_MMAP_READ_OFFSET to find the sub-buffer it owns.
+ */
+static int lib_ring_buffer_mmap_populate(struct lib_ring_buffer *buf,
+					 struct vm_area_struct *vma)
+{
+	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	unsigned long num_subbuf_alloc, i, j;
+	int ret;
+
+	/* Sub-buffers of static memory have no struct page. */
+	if (config->backend == RING_BUFFER_STATIC)
+		return -EINVAL;
+
+	num_subbuf_alloc = chan->backend.num_subbuf;
+	if (chan->backend.extra_reader_sb)
+		num_subbuf_alloc++;
+	for (i = 0; i < num_subbuf_alloc; i++) {
+		struct lib_ring_buffer_backend_pages *pages =
+			buf->backend.array[i];
+
+		for (j = 0; j < buf->backend.num_pages_per_subbuf; j++) {
+			ret = vm_insert_page(vma, vma->vm_start
+					+ pages->mmap_offset + (j << PAGE_SHIFT),
+					pages->p[j].page);
+			if (ret)
+				return ret;
+		}
+	}
+	return lib_ring_buffer_mmap_ctrl(buf, vma,
+			vma->vm_start + lib_ring_buffer_ctrl_offset(chan));
+}
+
 /**
  *	lib_ring_buffer_mmap_buf: - mmap channel buffer to process address space
  *	@buf: ring buffer to map
@@ -79,6 +191,11 @@ static const struct vm_operations_struct lib_ring_buffer_mmap_ops = {
  *
  *	Returns 0 if ok, negative on error
  *
+ *	Mapping the buffer length plus the control pages length populates the
+ *	whole mapping at once, see lib_ring_buffer_mmap_populate(). The control
+ *	pages can also be mapped on their own, whatever the buffer output.
+ *	These mappings are read-only.
+ *
  *	Caller should already have grabbed mmap_sem.
  */
 static int lib_ring_buffer_mmap_buf(struct lib_ring_buffer *buf,
@@ -87,23 +204,43 @@ static int lib_ring_buffer_mmap_buf(struct lib_ring_buffer *buf,
 	unsigned long length = vma->vm_end - vma->vm_start;
 	struct channel *chan = buf->backend.chan;
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
-	unsigned long mmap_buf_len;
-
-	if (config->output != RING_BUFFER_MMAP)
-		return -EINVAL;
+	unsigned long mmap_buf_len, ctrl_len;
+	int populated, ret;
 
-	mmap_buf_len = chan->backend.buf_size;
-	if (chan->backend.extra_reader_sb)
-		mmap_buf_len += chan->backend.subbuf_size;
+	mmap_buf_len = lib_ring_buffer_ctrl_offset(chan);
+	ctrl_len = lib_ring_buffer_ctrl_len(chan);
 
-	if (length != mmap_buf_len)
+	if (vma->vm_pgoff == mmap_buf_len >> PAGE_SHIFT && length == ctrl_len)
+		populated = 0;
+	else if (config->output != RING_BUFFER_MMAP)
+		return -EINVAL;
+	else if (!vma->vm_pgoff && length == mmap_buf_len + ctrl_len)
+		populated = 1;
+	else if (length == mmap_buf_len) {
+		vma->vm_ops = &lib_ring_buffer_mmap_ops;
+		vma->vm_flags |= VM_DONTEXPAND;
+		vma->vm_private_data = buf;
+		return 0;
+	} else
 		return -EINVAL;
 
-	vma->vm_ops = &lib_ring_buffer_mmap_ops;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
 	vma->vm_flags |= VM_DONTEXPAND;
+	vma->vm_ops = &lib_ring_buffer_mmap_populated_ops;
 	vma->vm_private_data = buf;
-
-	return 0;
+	/* Paired with ->close(), except if the mmap fails. */
+	atomic_inc(&buf->ctrl_mapped);
+	smp_mb__after_atomic_inc();
+	lib_ring_buffer_ctrl_refresh(buf);
+	if (populated)
+		ret = lib_ring_buffer_mmap_populate(buf, vma);
+	else
+		ret = lib_ring_buffer_mmap_ctrl(buf, vma, vma->vm_start);
+	if (ret)
+		atomic_dec(&buf->ctrl_mapped);
+	return ret;
 }
 
 int lib_ring_buffer_mmap(struct file *filp, struct vm_area_struct *vma,
@@ -0,0 +1,329 @@
+/*
+ * ring_buffer_output.c
+ *
+ * Ring Buffer output to a file from kernel space.
+ *
+ * A per-cpu worker reads the completed sub-buffers of a buffer and writes them
+ * to a file opened by the consumer, which saves the consumer wakeups and the
+ * copy of the data through user space.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/uio.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <asm/uaccess.h>
+
+#include "../../wrapper/iov_iter.h"
+#include "../../wrapper/ringbuffer/backend.h"
+#include "../../wrapper/ringbuffer/frontend.h"
+#include "../../wrapper/ringbuffer/vfs.h"
+
+struct lib_ring_buffer_output {
+	struct lib_ring_buffer *buf;
+	struct file *file;		/* Target file */
+	struct work_struct work;	/* Writes the delivered sub-buffers */
+	wait_queue_t wait;		/* Queues work on buffer wakeups */
+#ifdef LTTNG_HAVE_WRITE_BVEC
+	struct bio_vec *vec;		/* One entry per sub-buffer page */
+#else
+	struct iovec *vec;		/* One entry per sub-buffer page */
+#endif
+	loff_t pos;			/* Next write position in the file */
+	int error;			/* Output error, 0 if none */
+};
+
+/*
+ * Bound workqueue: the work of a per-cpu buffer is queued on its CPU, where
+ * the buffer pages are local, and runs elsewhere while the CPU is offline.
+ */
+static struct workqueue_struct *lib_ring_buffer_output_wq;
+
+/*
+ * Sub-buffers written by one work run, before it lets the other work items
+ * queued on the CPU run.
+ */
+#define LIB_RING_BUFFER_OUTPUT_BATCH	4
+
+/*
+ * Write the sub-buffer held by the output to the file. Whole pages are
+ * written, as with splice, so the sub-buffers stay page aligned in the file.
+ * The buffer pages are handed to the file as is when the kernel can write
+ * pages, without copying them to the page cache for O_DIRECT files.
+ * Otherwise they are written through their kernel addresses, which O_DIRECT
+ * writes cannot pin: attach refuses O_DIRECT files on such kernels.
+ */
+static
+int lib_ring_buffer_output_subbuf(struct lib_ring_buffer_output *output)
+{
+	struct lib_ring_buffer *buf = output->buf;
+	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	unsigned long consumed = buf->cons_snapshot;
+	size_t len, i, nr_pages;
+#ifndef LTTNG_HAVE_WRITE_BVEC
+	mm_segment_t old_fs;
+#endif
+	struct page **page;
+	void **virt;
+	ssize_t ret;
+
+	len = PAGE_ALIGN(lib_ring_buffer_get_read_data_size(config, buf));
+	nr_pages = len >> PAGE_SHIFT;
+	for (i = 0; i < nr_pages; i++) {
+		page = lib_ring_buffer_read_get_page(&buf->backend,
+				consumed + (i << PAGE_SHIFT), &virt);
+		if (!*page)
+			return -EIO;
+#ifdef LTTNG_HAVE_WRITE_BVEC
+		output->vec[i].bv_page = *page;
+		output->vec[i].bv_offset = 0;
+		output->vec[i].bv_len = PAGE_SIZE;
+#else
+		output->vec[i].iov_base = (void __user __force *) *virt;
+		output->vec[i].iov_len = PAGE_SIZE;
+#endif
+	}
+#ifdef LTTNG_HAVE_WRITE_BVEC
+	ret = wrapper_vfs_write_bvec(output->file, output->vec, nr_pages,
+				     len, &output->pos);
+#else
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	ret = vfs_writev(output->file,
+			 (const struct iovec __user __force *) output->vec,
+			 nr_pages, &output->pos);
+	set_fs(old_fs);
+#endif
+	if (ret < 0)
+		return ret;
+	if (ret != len)
+		return -EIO;
+	return 0;
+}
+
+static
+void lib_ring_buffer_output_queue(struct lib_ring_buffer_output *output)
+{
+	int cpu = output->buf->backend.cpu;
+
+	if (cpu < 0)
+		queue_work(lib_ring_buffer_output_wq, &output->work);
+	else
+		queue_work_on(cpu, lib_ring_buffer_output_wq, &output->work);
+}
+
+/*
+ * Write the sub-buffers delivered so far. A delivery racing with the last
+ * get queues the work again: it is not pending anymore while it runs.
+ */
+static
+void lib_ring_buffer_output_work(struct work_struct *work)
+{
+	struct lib_ring_buffer_output *output =
+		container_of(work, struct lib_ring_buffer_output, work);
+	struct lib_ring_buffer *buf = output->buf;
+	struct channel *chan = buf->backend.chan;
+	int i, ret;
+
+	if (output->error)
+		return;
+	for (i = 0; i < LIB_RING_BUFFER_OUTPUT_BATCH; i++) {
+		if (lib_ring_buffer_channel_is_disabled(chan)) {
+			output->error = -EIO;
+			return;
+		}
+		ret = lib_ring_buffer_get_next_subbuf(buf);
+		if (ret)
+			return;		/* No data, or finalized. */
+		ret = lib_ring_buffer_output_subbuf(output);
+		if (ret) {
+			/*
+			 * Leave the sub-buffer to the consumer, which reads it
+			 * again once the output is detached.
+			 */
+			lib_ring_buffer_put_subbuf(buf);
+			output->error = ret;
+			return;
+		}
+		lib_ring_buffer_put_next_subbuf(buf);
+	}
+	lib_ring_buffer_output_queue(output);
+}
+
+/*
+ * Called with the buffer read wait queue lock held, by each reader wakeup.
+ */
+static
+int lib_ring_buffer_output_wake(wait_queue_t *wait, unsigned mode, int sync,
+				void *key)
+{
+	struct lib_ring_buffer_output *output =
+		container_of(wait, struct lib_ring_buffer_output, wait);
+
+	if (!ACCESS_ONCE(output->error))
+		lib_ring_buffer_output_queue(output);
+	return 0;
+}
+
+/**
+ * lib_ring_buffer_output_attach - write the buffer data to a file
+ * @buf: buffer
+ * @fd: file descriptor of the target file, opened for writing
+ *
+ * Starts consuming the buffer: each sub-buffer delivered is written to the
+ * file, at its current position, padded to a multiple of the page size, by
+ * the output workqueue. The consumer must not read the buffer until the
+ * output is detached. For files opened with O_DIRECT, the file position must
+ * be page aligned, and the kernel able to write pages (-EINVAL otherwise).
+ */
+int lib_ring_buffer_output_attach(struct lib_ring_buffer *buf, int fd)
+{
+	struct channel *chan = buf->backend.chan;
+	struct lib_ring_buffer_output *output;
+	int ret;
+
+	mutex_lock(&buf->output_mutex);
+	if (buf->output || buf->get_subbuf) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+	output = kzalloc(sizeof(*output), GFP_KERNEL);
+	if (!output) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+	output->buf = buf;
+	output->file = fget(fd);
+	if (!output->file) {
+		ret = -EBADF;
+		goto free_output;
+	}
+	if (!(output->file->f_mode & FMODE_WRITE)) {
+		ret = -EBADF;
+		goto put_file;
+	}
+	output->pos = output->file->f_pos;
+#ifdef LTTNG_HAVE_WRITE_BVEC
+	if ((output->file->f_flags & O_DIRECT) && (output->pos & ~PAGE_MASK)) {
+#else
+	if (output->file->f_flags & O_DIRECT) {
+#endif
+		ret = -EINVAL;
+		goto put_file;
+	}
+	output->vec = kcalloc(chan->backend.subbuf_size >> PAGE_SHIFT,
+			      sizeof(*output->vec), GFP_KERNEL);
+	if (!output->vec) {
+		ret = -ENOMEM;
+		goto put_file;
+	}
+	INIT_WORK(&output->work, lib_ring_buffer_output_work);
+	init_waitqueue_func_entry(&output->wait, lib_ring_buffer_output_wake);
+	buf->output = output;
+	add_wait_queue(&buf->read_wait, &output->wait);
+	/* Write the sub-buffers delivered before the attach. */
+	lib_ring_buffer_output_queue(output);
+	mutex_unlock(&buf->output_mutex);
+	return 0;
+
+put_file:
+	fput(output->file);
+free_output:
+	kfree(output);
+unlock:
+	mutex_unlock(&buf->output_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(lib_ring_buffer_output_attach);
+
+/**
+ * lib_ring_buffer_output_detach - stop writing the buffer data to a file
+ * @buf: buffer
+ *
+ * Returns the error which stopped the output, if any, or 0. The file position
+ * is set after the data written.
+ */
+int lib_ring_buffer_output_detach(struct lib_ring_buffer *buf)
+{
+	struct lib_ring_buffer_output *output;
+	int ret;
+
+	mutex_lock(&buf->output_mutex);
+	output = buf->output;
+	if (!output) {
+		mutex_unlock(&buf->output_mutex);
+		return 0;
+	}
+	/* No wakeup queues the work once removed from the wait queue. */
+	remove_wait_queue(&buf->read_wait, &output->wait);
+	cancel_work_sync(&output->work);
+	buf->output = NULL;
+	ret = output->error;
+	output->file->f_pos = output->pos;
+	fput(output->file);
+	kfree(output->vec);
+	kfree(output);
+	mutex_unlock(&buf->output_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(lib_ring_buffer_output_detach);
+
+/**
+ * lib_ring_buffer_output_read_begin - start a read of the buffer by its file
+ * @buf: buffer
+ *
+ * Returns -EBUSY if an output is attached: its work is the buffer reader.
+ * Otherwise, keeps outputs from being attached until the matching
+ * lib_ring_buffer_output_read_end().
+ */
+int lib_ring_buffer_output_read_begin(struct lib_ring_buffer *buf)
+{
+	mutex_lock(&buf->output_mutex);
+	if (buf->output) {
+		mutex_unlock(&buf->output_mutex);
+		return -EBUSY;
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lib_ring_buffer_output_read_begin);
+
+void lib_ring_buffer_output_read_end(struct lib_ring_buffer *buf)
+{
+	mutex_unlock(&buf->output_mutex);
+}
+EXPORT_SYMBOL_GPL(lib_ring_buffer_output_read_end);
+
+int __init lib_ring_buffer_output_init(void)
+{
+	lib_ring_buffer_output_wq = alloc_workqueue("lttng_output",
+						    WQ_MEM_RECLAIM, 0);
+	if (!lib_ring_buffer_output_wq)
+		return -ENOMEM;
+	return 0;
+}
+
+void lib_ring_buffer_output_exit(void)
+{
+	destroy_workqueue(lib_ring_buffer_output_wq);
+}
@@ -25,6 +25,8 @@
 
 #include <linux/module.h>
 #include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/slab.h>
 
 #include "../../wrapper/splice.h"
 #include "../../wrapper/ringbuffer/backend.h"
@@ -44,6 +46,105 @@ loff_t vfs_lib_ring_buffer_no_llseek(struct file *file, loff_t offset,
 }
 EXPORT_SYMBOL_GPL(vfs_lib_ring_buffer_no_llseek);
 
+/*
+ * Pages moved into the pipe are replaced in the buffer by pages taken from a
+ * per-channel pool, which the pipe feeds back when it releases them, so
+ * splice neither allocates nor clears pages once the pool is warm. Pages are
+ * recycled as-is: they only ever held data of the channel, so the stale tail
+ * between the content size and the padded size of a sub-buffer, which readers
+ * skip, leaks nothing. Each page handed to the pipe holds a reference on the
+ * pool, which may outlive the channel.
+ */
+struct lib_ring_buffer_page_pool {
+	spinlock_t lock;
+	struct list_head pages;		/* Free pages, linked by page->lru */
+	unsigned long nr_pages;
+	unsigned long max_pages;	/* One sub-buffer per buffer */
+	struct kref ref;
+};
+
+struct lib_ring_buffer_page_pool *
+	lib_ring_buffer_page_pool_create(const struct lib_ring_buffer_config *config,
+					 size_t subbuf_size)
+{
+	struct lib_ring_buffer_page_pool *pool;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return NULL;
+	spin_lock_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->pages);
+	pool->max_pages = max_t(unsigned long, subbuf_size >> PAGE_SHIFT, 1);
+	if (config->alloc == RING_BUFFER_ALLOC_PER_CPU)
+		pool->max_pages *= num_possible_cpus();
+	kref_init(&pool->ref);
+	return pool;
+}
+
+static
+void lib_ring_buffer_page_pool_release(struct kref *kref)
+{
+	struct lib_ring_buffer_page_pool *pool =
+		container_of(kref, struct lib_ring_buffer_page_pool, ref);
+	struct page *page, *tmp;
+
+	list_for_each_entry_safe(page, tmp, &pool->pages, lru)
+		__free_page(page);
+	kfree(pool);
+}
+
+/*
+ * Drop the channel reference on the pool.
+ */
+void lib_ring_buffer_page_pool_destroy(struct lib_ring_buffer_page_pool *pool)
+{
+	if (pool)
+		kref_put(&pool->ref, lib_ring_buffer_page_pool_release);
+}
+
+static
+struct page *lib_ring_buffer_page_pool_get(struct lib_ring_buffer_page_pool *pool,
+					   int node)
+{
+	struct page *page = NULL;
+
+	spin_lock(&pool->lock);
+	if (!list_empty(&pool->pages)) {
+		page = list_first_entry(&pool->pages, struct page, lru);
+		list_del(&page->lru);
+		pool->nr_pages--;
+	}
+	spin_unlock(&pool->lock);
+	if (page)
+		return page;
+	/* Fresh pages are cleared, not to leak kernel memory in the trace. */
+	return alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, 0);
+}
+
+/*
+ * Recycle a page released by the pipe, unless it is still referenced
+ * elsewhere or was stolen into the page cache (a stealer may keep the page
+ * with a mapping, or on the LRU, past the pipe reference), and drop the pipe
+ * reference on the pool.
+ */
+static
+void lib_ring_buffer_page_pool_put(struct lib_ring_buffer_page_pool *pool,
+				   struct page *page)
+{
+	if (page_count(page) == 1 && !page->mapping && !PageLRU(page)) {
+		spin_lock(&pool->lock);
+		if (pool->nr_pages < pool->max_pages) {
+			list_add(&page->lru, &pool->pages);
+			pool->nr_pages++;
+			page = NULL;
+		}
+		spin_unlock(&pool->lock);
+	}
+	if (page)
+		__free_page(page);
+	kref_put(&pool->ref, lib_ring_buffer_page_pool_release);
+}
+
 /*
  * Release pages from the buffer so splice pipe_to_file can move them.
  * Called after the pipe has been populated with buffer pages.
@@ -51,7 +152,22 @@ EXPORT_SYMBOL_GPL(vfs_lib_ring_buffer_no_llseek);
 static void lib_ring_buffer_pipe_buf_release(struct pipe_inode_info *pipe,
 					     struct pipe_buffer *pbuf)
 {
-	__free_page(pbuf->page);
+	lib_ring_buffer_page_pool_put((struct lib_ring_buffer_page_pool *)
+				      pbuf->private, pbuf->page);
+}
+
+/*
+ * Each pipe buffer referencing the page releases it: tee() takes a pool
+ * reference along with the page reference.
+ */
+static void lib_ring_buffer_pipe_buf_get(struct pipe_inode_info *pipe,
+					 struct pipe_buffer *pbuf)
+{
+	struct lib_ring_buffer_page_pool *pool =
+		(struct lib_ring_buffer_page_pool *) pbuf->private;
+
+	kref_get(&pool->ref);
+	generic_pipe_buf_get(pipe, pbuf);
 }
 
 static const struct pipe_buf_operations ring_buffer_pipe_buf_ops = {
@@ -61,7 +177,7 @@ static const struct pipe_buf_operations ring_buffer_pipe_buf_ops = {
 	.confirm = generic_pipe_buf_confirm,
 	.release = lib_ring_buffer_pipe_buf_release,
 	.steal = generic_pipe_buf_steal,
-	.get = generic_pipe_buf_get,
+	.get = lib_ring_buffer_pipe_buf_get,
 };
 
 /*
@@ -70,11 +186,26 @@ static const struct pipe_buf_operations ring_buffer_pipe_buf_ops = {
 static void lib_ring_buffer_page_release(struct splice_pipe_desc *spd,
 					 unsigned int i)
 {
-	__free_page(spd->pages[i]);
+	lib_ring_buffer_page_pool_put((struct lib_ring_buffer_page_pool *)
+				      spd->partial[i].private, spd->pages[i]);
+}
+
+/*
+ * Bytes of the selected k-th sub-buffer of the run got by the reader which can
+ * be spliced: its padded data size, except for the last sub-buffer of the run,
+ * which can be read up to its end.
+ */
+static
+unsigned long subbuf_splice_avail(const struct lib_ring_buffer_config *config,
+				  struct lib_ring_buffer *buf, unsigned int k)
+{
+	if (k == buf->get_subbuf_count - 1)
+		return buf->backend.chan->backend.subbuf_size;
+	return PAGE_ALIGN(lib_ring_buffer_get_read_data_size(config, buf));
 }
 
 /*
- *	subbuf_splice_actor - splice up to one subbuf's worth of data
+ *	subbuf_splice_actor - splice up to one pipe's worth of the run of subbufs
  */
 static int subbuf_splice_actor(struct file *in,
 			       loff_t *ppos,
@@ -85,7 +216,7 @@ static int subbuf_splice_actor(struct file *in,
 {
 	struct channel *chan = buf->backend.chan;
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
-	unsigned int poff, subbuf_pages, nr_pages;
+	unsigned int poff, k;
 	struct page *pages[PIPE_DEF_BUFFERS];
 	struct partial_page partial[PIPE_DEF_BUFFERS];
 	struct splice_pipe_desc spd = {
@@ -98,36 +229,56 @@ static int subbuf_splice_actor(struct file *in,
 	};
 	unsigned long consumed_old, roffset;
 	unsigned long bytes_avail;
+	loff_t pos = *ppos;
 
 	/*
 	 * Check that a GET_SUBBUF ioctl has been done before.
 	 */
 	WARN_ON(atomic_long_read(&buf->active_readers) != 1);
-	consumed_old = lib_ring_buffer_get_consumed(config, buf);
-	consumed_old += *ppos;
+	if (!buf->get_subbuf)
+		return 0;
 
 	/*
-	 * Adjust read len, if longer than what is available.
-	 * Max read size is 1 subbuffer due to get_subbuf/put_subbuf for
+	 * Find the sub-buffer of the run holding the read position. Max read
+	 * size is the run of sub-buffers due to get_subbuf/put_subbuf for
 	 * protection.
 	 */
-	bytes_avail = chan->backend.subbuf_size;
-	WARN_ON(bytes_avail > chan->backend.buf_size);
-	len = min_t(size_t, len, bytes_avail);
-	subbuf_pages = bytes_avail >> PAGE_SHIFT;
-	nr_pages = min_t(unsigned int, subbuf_pages, PIPE_DEF_BUFFERS);
+	for (k = 0; ; k++) {
+		if (k == buf->get_subbuf_count)
+			return 0;
+		lib_ring_buffer_select_subbuf(buf, k);
+		bytes_avail = subbuf_splice_avail(config, buf, k);
+		WARN_ON(bytes_avail > chan->backend.buf_size);
+		if (pos < bytes_avail)
+			break;
+		pos -= bytes_avail;
+	}
+	bytes_avail -= pos;
+	consumed_old = buf->get_subbuf_consumed
+		+ ((unsigned long) k << chan->backend.subbuf_size_order) + pos;
 	roffset = consumed_old & PAGE_MASK;
 	poff = consumed_old & ~PAGE_MASK;
 	printk_dbg(KERN_DEBUG "SPLICE actor len %zu pos %zd write_pos %ld\n",
 		   len, (ssize_t)*ppos, lib_ring_buffer_get_offset(config, buf));
 
-	for (; spd.nr_pages < nr_pages; spd.nr_pages++) {
+	for (; spd.nr_pages < PIPE_DEF_BUFFERS; spd.nr_pages++) {
 		unsigned int this_len;
 		struct page **page, *new_page;
 		void **virt;
 
 		if (!len)
 			break;
+		if (!bytes_avail) {
+			/* Continue with the next sub-buffer of the run. */
+			if (++k == buf->get_subbuf_count)
+				break;
+			lib_ring_buffer_select_subbuf(buf, k);
+			bytes_avail = subbuf_splice_avail(config, buf, k);
+			roffset = buf->get_subbuf_consumed
+				+ ((unsigned long) k
+				   << chan->backend.subbuf_size_order);
+			poff = 0;
+		}
 		printk_dbg(KERN_DEBUG "SPLICE actor loop len %zu roffset %ld\n",
 			   len, roffset);
 
@@ -135,24 +286,38 @@ static int subbuf_splice_actor(struct file *in,
 		 * We have to replace the page we are moving into the splice
 		 * pipe.
 		 */
-		new_page = alloc_pages_node(cpu_to_node(max(buf->backend.cpu,
-							    0)),
-					    GFP_KERNEL | __GFP_ZERO, 0);
+		new_page = lib_ring_buffer_page_pool_get(chan->splice_pool,
+				cpu_to_node(max(buf->backend.cpu, 0)));
 		if (!new_page)
 			break;
+		kref_get(&chan->splice_pool->ref);
 
 		this_len = PAGE_SIZE - poff;
 		page = lib_ring_buffer_read_get_page(&buf->backend, roffset, &virt);
-		spd.pages[spd.nr_pages] = *page;
-		*page = new_page;
-		*virt = page_address(new_page);
+		if (config->backend != RING_BUFFER_PAGE) {
+			/*
+			 * Pages of contiguous sub-buffers cannot be replaced:
+			 * move a copy into the pipe.
+			 */
+			copy_page(page_address(new_page), *virt);
+			spd.pages[spd.nr_pages] = new_page;
+		} else {
+			spd.pages[spd.nr_pages] = *page;
+			*page = new_page;
+			*virt = page_address(new_page);
+		}
 		spd.partial[spd.nr_pages].offset = poff;
 		spd.partial[spd.nr_pages].len = this_len;
+		spd.partial[spd.nr_pages].private =
+			(unsigned long) chan->splice_pool;
 
 		poff = 0;
 		roffset += PAGE_SIZE;
-		len -= this_len;
+		len -= min_t(size_t, len, this_len);
+		bytes_avail -= min_t(unsigned long, bytes_avail, this_len);
 	}
+	/* Leave the first sub-buffer of the run selected. */
+	lib_ring_buffer_select_subbuf(buf, 0);
 
 	if (!spd.nr_pages)
 		return 0;
@@ -185,7 +350,9 @@ ssize_t lib_ring_buffer_splice_read(struct file *in, loff_t *ppos,
 	if (*ppos != PAGE_ALIGN(*ppos) || len != PAGE_ALIGN(len))
 		return -EINVAL;
 
-	ret = 0;
+	ret = lib_ring_buffer_output_read_begin(buf);
+	if (ret)
+		return ret;
 	spliced = 0;
 
 	printk_dbg(KERN_DEBUG "SPLICE read len %zu pos %zd\n", len,
@@ -208,6 +375,7 @@ ssize_t lib_ring_buffer_splice_read(struct file *in, loff_t *ppos,
 			len -= ret;
 		spliced += ret;
 	}
+	lib_ring_buffer_output_read_end(buf);
 
 	if (spliced)
 		return spliced;
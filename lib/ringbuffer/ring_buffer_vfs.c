@@ -29,6 +29,30 @@
 #include "../../wrapper/ringbuffer/vfs.h"
 #include "../../wrapper/poll.h"
 
+/*
+ * While an output is attached to the buffer, its work is the buffer reader.
+ * Reads through the file are done within lib_ring_buffer_output_read_begin()
+ * and lib_ring_buffer_output_read_end().
+ */
+static
+int lib_ring_buffer_cmd_reads(unsigned int cmd)
+{
+	switch (cmd) {
+	case RING_BUFFER_GET_SUBBUF:
+	case RING_BUFFER_PUT_SUBBUF:
+	case RING_BUFFER_GET_NEXT_SUBBUF:
+	case RING_BUFFER_PUT_NEXT_SUBBUF:
+	case RING_BUFFER_PUT_GET_NEXT_SUBBUF:
+	case RING_BUFFER_GET_NEXT_SUBBUFS:
+#ifdef CONFIG_COMPAT
+	case RING_BUFFER_COMPAT_GET_SUBBUF:
+#endif
+		return 1;
+	default:
+		return 0;
+	}
+}
+
 static int put_ulong(unsigned long val, unsigned long arg)
 {
 	return put_user(val, (unsigned long __user *)arg);
@@ -41,6 +65,129 @@ static int compat_put_ulong(compat_ulong_t val, unsigned long arg)
 }
 #endif
 
+/*
+ * Get the next run of sub-buffers, and describe each of them to the reader.
+ * The run is released if it cannot be described.
+ */
+static
+long lib_ring_buffer_get_next_subbufs_desc(struct file *filp,
+		struct lib_ring_buffer *buf,
+		struct lib_ring_buffer_subbufs __user *usubbufs)
+{
+	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	struct lib_ring_buffer_subbuf_desc desc;
+	unsigned long sb_bindex;
+	uint32_t max_subbufs;
+	int i, nr;
+
+	if (get_user(max_subbufs, &usubbufs->max_subbufs))
+		return -EFAULT;
+	if (!max_subbufs)
+		return -EINVAL;
+	nr = lib_ring_buffer_get_next_subbufs(buf,
+			min_t(uint32_t, max_subbufs, RING_BUFFER_MAX_SUBBUFS));
+	if (nr < 0)
+		return nr;
+	/* Set file position to zero at each successful "get" */
+	filp->f_pos = 0;
+	for (i = 0; i < nr; i++) {
+		lib_ring_buffer_select_subbuf(buf, i);
+		desc.mmap_offset = 0;
+		if (config->output == RING_BUFFER_MMAP) {
+			sb_bindex = subbuffer_id_get_index(config,
+						buf->backend.buf_rsb.id);
+			desc.mmap_offset =
+				buf->backend.array[sb_bindex]->mmap_offset;
+		}
+		desc.data_size = lib_ring_buffer_get_read_data_size(config, buf);
+		desc.padded_size = PAGE_ALIGN(desc.data_size);
+		if (copy_to_user(&usubbufs->subbufs[i], &desc, sizeof(desc)))
+			goto fault;
+	}
+	lib_ring_buffer_select_subbuf(buf, 0);
+	if (put_user(nr, &usubbufs->nr_subbufs))
+		goto fault;
+	return 0;
+
+fault:
+	lib_ring_buffer_put_subbuf(buf);
+	return -EFAULT;
+}
+
+/**
+ *	lib_ring_buffer_read_subbufs - read the sub-buffers held by the reader
+ *	@filp: the file
+ *	@user_buf: user buffer to read data into
+ *	@count: number of bytes to read
+ *	@ppos: file read position
+ *	@buf: ring buffer
+ *
+ *	Copies the run of sub-buffers got by the reader from the file position,
+ *	which is set to zero at each successful "get". As with splice, the run
+ *	reads as the concatenation of its padded sub-buffers. Returns 0 at the
+ *	end of the run, or if no sub-buffer is held: it never blocks, so a
+ *	reader can drive many streams from one thread.
+ */
+ssize_t lib_ring_buffer_read_subbufs(struct file *filp, char __user *user_buf,
+		size_t count, loff_t *ppos, struct lib_ring_buffer *buf)
+{
+	struct channel *chan = buf->backend.chan;
+	const struct lib_ring_buffer_config *config = &chan->backend.config;
+	unsigned long size, offset;
+	ssize_t read_count = 0;
+	loff_t pos = *ppos;
+	size_t copy_len;
+	unsigned int k;
+
+	if (!buf->get_subbuf)
+		return 0;
+	if (!access_ok(VERIFY_WRITE, user_buf, count))
+		return -EFAULT;
+	for (k = 0; k < buf->get_subbuf_count && read_count < count; k++) {
+		lib_ring_buffer_select_subbuf(buf, k);
+		size = PAGE_ALIGN(lib_ring_buffer_get_read_data_size(config,
+								     buf));
+		if (pos >= size) {
+			pos -= size;
+			continue;
+		}
+		copy_len = min_t(size_t, count - read_count, size - pos);
+		offset = buf->get_subbuf_consumed
+			+ ((unsigned long) k << chan->backend.subbuf_size_order)
+			+ pos;
+		if (__lib_ring_buffer_copy_to_user(&buf->backend, offset,
+						   &user_buf[read_count],
+						   copy_len)) {
+			if (!read_count)
+				read_count = -EFAULT;
+			break;
+		}
+		read_count += copy_len;
+		pos = 0;
+	}
+	lib_ring_buffer_select_subbuf(buf, 0);
+	if (read_count > 0)
+		*ppos += read_count;
+	return read_count;
+}
+EXPORT_SYMBOL_GPL(lib_ring_buffer_read_subbufs);
+
+static
+ssize_t vfs_lib_ring_buffer_read(struct file *filp, char __user *user_buf,
+		size_t count, loff_t *ppos)
+{
+	struct lib_ring_buffer *buf = filp->private_data;
+	ssize_t ret;
+
+	ret = lib_ring_buffer_output_read_begin(buf);
+	if (ret)
+		return ret;
+	ret = lib_ring_buffer_read_subbufs(filp, user_buf, count, ppos, buf);
+	lib_ring_buffer_output_read_end(buf);
+	return ret;
+}
+
 int lib_ring_buffer_open(struct inode *inode, struct file *file,
 		struct lib_ring_buffer *buf)
 {
@@ -84,6 +231,7 @@ int vfs_lib_ring_buffer_open(struct inode *inode, struct file *file)
 int lib_ring_buffer_release(struct inode *inode, struct file *file,
 		struct lib_ring_buffer *buf)
 {
+	(void) lib_ring_buffer_output_detach(buf);
 	lib_ring_buffer_release_read(buf);
 
 	return 0;
@@ -105,61 +253,90 @@ int vfs_lib_ring_buffer_release(struct inode *inode, struct file *file)
 	return lib_ring_buffer_release(inode, file, buf);
 }
 
-unsigned int lib_ring_buffer_poll(struct file *filp, poll_table *wait,
-		struct lib_ring_buffer *buf)
+/*
+ * Readiness of the buffer for its reader, as a poll mask.
+ */
+static
+unsigned int lib_ring_buffer_poll_mask(struct lib_ring_buffer *buf)
 {
-	unsigned int mask = 0;
 	struct channel *chan = buf->backend.chan;
 	const struct lib_ring_buffer_config *config = &chan->backend.config;
 	int finalized, disabled;
 
-	if (filp->f_mode & FMODE_READ) {
-		poll_wait_set_exclusive(wait);
-		poll_wait(filp, &buf->read_wait, wait);
+	finalized = lib_ring_buffer_is_finalized(config, buf);
+	disabled = lib_ring_buffer_channel_is_disabled(chan);
 
-		finalized = lib_ring_buffer_is_finalized(config, buf);
-		disabled = lib_ring_buffer_channel_is_disabled(chan);
-
-		/*
-		 * lib_ring_buffer_is_finalized() contains a smp_rmb() ordering
-		 * finalized load before offsets loads.
-		 */
-		WARN_ON(atomic_long_read(&buf->active_readers) != 1);
+	/*
+	 * lib_ring_buffer_is_finalized() contains a smp_rmb() ordering
+	 * finalized load before offsets loads.
+	 */
+	WARN_ON(atomic_long_read(&buf->active_readers) != 1);
 retry:
-		if (disabled)
-			return POLLERR;
-
-		if (subbuf_trunc(lib_ring_buffer_get_offset(config, buf), chan)
-		  - subbuf_trunc(lib_ring_buffer_get_consumed(config, buf), chan)
-		  == 0) {
-			if (finalized)
-				return POLLHUP;
-			else {
-				/*
-				 * The memory barriers
-				 * __wait_event()/wake_up_interruptible() take
-				 * care of "raw_spin_is_locked" memory ordering.
-				 */
-				if (raw_spin_is_locked(&buf->raw_tick_nohz_spinlock))
-					goto retry;
-				else
-					return 0;
-			}
-		} else {
-			if (subbuf_trunc(lib_ring_buffer_get_offset(config, buf),
-					 chan)
-			  - subbuf_trunc(lib_ring_buffer_get_consumed(config, buf),
-					 chan)
-			  >= chan->backend.buf_size)
-				return POLLPRI | POLLRDBAND;
+	if (disabled)
+		return POLLERR;
+
+	if (subbuf_trunc(lib_ring_buffer_get_offset(config, buf), chan)
+	  - subbuf_trunc(lib_ring_buffer_get_consumed(config, buf), chan)
+	  == 0) {
+		if (finalized)
+			return POLLHUP;
+		else {
+			/*
+			 * The memory barriers
+			 * __wait_event()/wake_up_interruptible() take
+			 * care of "raw_spin_is_locked" memory ordering.
+			 */
+			if (raw_spin_is_locked(&buf->raw_tick_nohz_spinlock))
+				goto retry;
 			else
-				return POLLIN | POLLRDNORM;
+				return 0;
 		}
+	} else {
+		if (subbuf_trunc(lib_ring_buffer_get_offset(config, buf),
+				 chan)
+		  - subbuf_trunc(lib_ring_buffer_get_consumed(config, buf),
+				 chan)
+		  >= chan->backend.buf_size)
+			return POLLPRI | POLLRDBAND;
+		else
+			return POLLIN | POLLRDNORM;
+	}
+}
+
+unsigned int lib_ring_buffer_poll(struct file *filp, poll_table *wait,
+		struct lib_ring_buffer *buf)
+{
+	unsigned int mask = 0;
+
+	if (filp->f_mode & FMODE_READ) {
+		poll_wait_set_exclusive(wait);
+		poll_wait(filp, &buf->read_wait, wait);
+		mask = lib_ring_buffer_poll_mask(buf);
 	}
 	return mask;
 }
 EXPORT_SYMBOL_GPL(lib_ring_buffer_poll);
 
+/*
+ * Wait for the buffer to be ready, as an exclusive waiter of its read wait
+ * queue: each wakeup of the queue wakes all the poll() callers but a single
+ * one of the exclusive waiters, so consumer threads sharing streams are not
+ * all woken for each sub-buffer delivered. Returns the poll mask of the
+ * buffer.
+ */
+static
+long lib_ring_buffer_wait_exclusive(struct lib_ring_buffer *buf)
+{
+	unsigned int mask;
+	int ret;
+
+	ret = wait_event_interruptible_exclusive(buf->read_wait,
+			(mask = lib_ring_buffer_poll_mask(buf)) != 0);
+	if (ret)
+		return ret;
+	return mask;
+}
+
 /**
  *	vfs_lib_ring_buffer_poll - ring buffer poll file operation
  *	@filp: the file
@@ -175,7 +352,8 @@ unsigned int vfs_lib_ring_buffer_poll(struct file *filp, poll_table *wait)
 	return lib_ring_buffer_poll(filp, wait, buf);
 }
 
-long lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd,
+static
+long __lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd,
 		unsigned long arg, struct lib_ring_buffer *buf)
 {
 	struct channel *chan = buf->backend.chan;
@@ -225,6 +403,19 @@ long lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd,
 	case RING_BUFFER_PUT_NEXT_SUBBUF:
 		lib_ring_buffer_put_next_subbuf(buf);
 		return 0;
+	case RING_BUFFER_PUT_GET_NEXT_SUBBUF:
+	{
+		long ret;
+
+		if (buf->get_subbuf)
+			lib_ring_buffer_put_next_subbuf(buf);
+		ret = lib_ring_buffer_get_next_subbuf(buf);
+		if (!ret) {
+			/* Set file position to zero at each successful "get" */
+			filp->f_pos = 0;
+		}
+		return ret;
+	}
 	case RING_BUFFER_GET_SUBBUF_SIZE:
 		return put_ulong(lib_ring_buffer_get_read_data_size(config, buf),
 				 arg);
@@ -265,10 +456,47 @@ long lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd,
 	case RING_BUFFER_FLUSH:
 		lib_ring_buffer_switch_remote(buf);
 		return 0;
+	case RING_BUFFER_GET_STATS:
+	{
+		struct lib_ring_buffer_stats stats;
+
+		lib_ring_buffer_get_stats(buf, &stats);
+		if (copy_to_user((void __user *) arg, &stats, sizeof(stats)))
+			return -EFAULT;
+		return 0;
+	}
+	case RING_BUFFER_GET_NEXT_SUBBUFS:
+		return lib_ring_buffer_get_next_subbufs_desc(filp, buf,
+			(struct lib_ring_buffer_subbufs __user *) arg);
+	case RING_BUFFER_GET_CTRL_OFFSET:
+		return put_ulong(lib_ring_buffer_ctrl_offset(chan), arg);
+	case RING_BUFFER_GET_CTRL_LEN:
+		return put_ulong(lib_ring_buffer_ctrl_len(chan), arg);
+	case RING_BUFFER_WAIT_EXCLUSIVE:
+		return lib_ring_buffer_wait_exclusive(buf);
+	case RING_BUFFER_SET_OUTPUT_FD:
+		if ((int) arg < 0)
+			return lib_ring_buffer_output_detach(buf);
+		return lib_ring_buffer_output_attach(buf, (int) arg);
 	default:
 		return -ENOIOCTLCMD;
 	}
 }
+
+long lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd,
+		unsigned long arg, struct lib_ring_buffer *buf)
+{
+	long ret;
+
+	if (!lib_ring_buffer_cmd_reads(cmd))
+		return __lib_ring_buffer_ioctl(filp, cmd, arg, buf);
+	ret = lib_ring_buffer_output_read_begin(buf);
+	if (ret)
+		return ret;
+	ret = __lib_ring_buffer_ioctl(filp, cmd, arg, buf);
+	lib_ring_buffer_output_read_end(buf);
+	return ret;
+}
 EXPORT_SYMBOL_GPL(lib_ring_buffer_ioctl);
 
 /**
@@ -284,6 +512,9 @@ EXPORT_SYMBOL_GPL(lib_ring_buffer_ioctl);
  *		Get the next sub-buffer that can be read. It never blocks.
  *	RING_BUFFER_PUT_NEXT_SUBBUF
  *		Release the currently read sub-buffer.
+ *	RING_BUFFER_PUT_GET_NEXT_SUBBUF
+ *		Release the currently read sub-buffer, if any, and get the
+ *		next sub-buffer that can be read. It never blocks.
  *	RING_BUFFER_GET_SUBBUF_SIZE
  *		returns the size of the current sub-buffer.
  *	RING_BUFFER_GET_MAX_SUBBUF_SIZE
@@ -294,6 +525,21 @@ EXPORT_SYMBOL_GPL(lib_ring_buffer_ioctl);
  *      RING_BUFFER_GET_MMAP_READ_OFFSET
  *              returns the offset of the subbuffer belonging to the reader.
  *              Should only be used for mmap clients.
+ *	RING_BUFFER_GET_STATS
+ *		returns a snapshot of the buffer counters.
+ *	RING_BUFFER_GET_NEXT_SUBBUFS
+ *		Get a run of consecutive sub-buffers that can be read, released
+ *		by RING_BUFFER_PUT_NEXT_SUBBUF. It never blocks.
+ *	RING_BUFFER_GET_CTRL_OFFSET
+ *		returns the mmap offset of the read-only control pages.
+ *	RING_BUFFER_GET_CTRL_LEN
+ *		returns the length of the read-only control pages.
+ *	RING_BUFFER_WAIT_EXCLUSIVE
+ *		Wait for the buffer to be ready, waking a single waiter per
+ *		sub-buffer delivered. Returns the poll mask of the buffer.
+ *	RING_BUFFER_SET_OUTPUT_FD
+ *		Write the delivered sub-buffers to the file descriptor passed
+ *		as argument from kernel space, or stop with -1.
  */
 static
 long vfs_lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
@@ -304,7 +550,8 @@ long vfs_lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd, unsigned lon
 }
 
 #ifdef CONFIG_COMPAT
-long lib_ring_buffer_compat_ioctl(struct file *filp, unsigned int cmd,
+static
+long __lib_ring_buffer_compat_ioctl(struct file *filp, unsigned int cmd,
 		unsigned long arg, struct lib_ring_buffer *buf)
 {
 	struct channel *chan = buf->backend.chan;
@@ -358,6 +605,19 @@ long lib_ring_buffer_compat_ioctl(struct file *filp, unsigned int cmd,
 	case RING_BUFFER_COMPAT_PUT_NEXT_SUBBUF:
 		lib_ring_buffer_put_next_subbuf(buf);
 		return 0;
+	case RING_BUFFER_COMPAT_PUT_GET_NEXT_SUBBUF:
+	{
+		long ret;
+
+		if (buf->get_subbuf)
+			lib_ring_buffer_put_next_subbuf(buf);
+		ret = lib_ring_buffer_get_next_subbuf(buf);
+		if (!ret) {
+			/* Set file position to zero at each successful "get" */
+			filp->f_pos = 0;
+		}
+		return ret;
+	}
 	case RING_BUFFER_COMPAT_GET_SUBBUF_SIZE:
 	{
 		unsigned long data_size;
@@ -410,10 +670,49 @@ long lib_ring_buffer_compat_ioctl(struct file *filp, unsigned int cmd,
 	case RING_BUFFER_COMPAT_FLUSH:
 		lib_ring_buffer_switch_remote(buf);
 		return 0;
+	case RING_BUFFER_COMPAT_GET_STATS:
+	{
+		struct lib_ring_buffer_stats stats;
+
+		lib_ring_buffer_get_stats(buf, &stats);
+		if (copy_to_user(compat_ptr(arg), &stats, sizeof(stats)))
+			return -EFAULT;
+		return 0;
+	}
+	case RING_BUFFER_COMPAT_GET_NEXT_SUBBUFS:
+		return lib_ring_buffer_get_next_subbufs_desc(filp, buf,
+						compat_ptr(arg));
+	case RING_BUFFER_COMPAT_GET_CTRL_OFFSET:
+		if (lib_ring_buffer_ctrl_offset(chan) > UINT_MAX)
+			return -EFBIG;
+		return compat_put_ulong(lib_ring_buffer_ctrl_offset(chan), arg);
+	case RING_BUFFER_COMPAT_GET_CTRL_LEN:
+		return compat_put_ulong(lib_ring_buffer_ctrl_len(chan), arg);
+	case RING_BUFFER_COMPAT_WAIT_EXCLUSIVE:
+		return lib_ring_buffer_wait_exclusive(buf);
+	case RING_BUFFER_COMPAT_SET_OUTPUT_FD:
+		if ((int) arg < 0)
+			return lib_ring_buffer_output_detach(buf);
+		return lib_ring_buffer_output_attach(buf, (int) arg);
 	default:
 		return -ENOIOCTLCMD;
 	}
 }
+
+long lib_ring_buffer_compat_ioctl(struct file *filp, unsigned int cmd,
+		unsigned long arg, struct lib_ring_buffer *buf)
+{
+	long ret;
+
+	if (!lib_ring_buffer_cmd_reads(cmd))
+		return __lib_ring_buffer_compat_ioctl(filp, cmd, arg, buf);
+	ret = lib_ring_buffer_output_read_begin(buf);
+	if (ret)
+		return ret;
+	ret = __lib_ring_buffer_compat_ioctl(filp, cmd, arg, buf);
+	lib_ring_buffer_output_read_end(buf);
+	return ret;
+}
 EXPORT_SYMBOL_GPL(lib_ring_buffer_compat_ioctl);
 
 static
@@ -431,6 +730,7 @@ const struct file_operations lib_ring_buffer_file_operations = {
 	.open = vfs_lib_ring_buffer_open,
 	.release = vfs_lib_ring_buffer_release,
 	.poll = vfs_lib_ring_buffer_poll,
+	.read = vfs_lib_ring_buffer_read,
 	.splice_read = vfs_lib_ring_buffer_splice_read,
 	.mmap = vfs_lib_ring_buffer_mmap,
 	.unlocked_ioctl = vfs_lib_ring_buffer_ioctl,
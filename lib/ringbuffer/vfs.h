@@ -28,6 +28,7 @@
 
 #include <linux/fs.h>
 #include <linux/poll.h>
+#include <linux/types.h>
 
 /* VFS API */
 
@@ -50,6 +51,14 @@ ssize_t lib_ring_buffer_splice_read(struct file *in, loff_t *ppos,
 		unsigned int flags, struct lib_ring_buffer *buf);
 int lib_ring_buffer_mmap(struct file *filp, struct vm_area_struct *vma,
 		struct lib_ring_buffer *buf);
+ssize_t lib_ring_buffer_read_subbufs(struct file *filp, char __user *user_buf,
+		size_t count, loff_t *ppos, struct lib_ring_buffer *buf);
+int lib_ring_buffer_output_attach(struct lib_ring_buffer *buf, int fd);
+int lib_ring_buffer_output_detach(struct lib_ring_buffer *buf);
+int lib_ring_buffer_output_read_begin(struct lib_ring_buffer *buf);
+void lib_ring_buffer_output_read_end(struct lib_ring_buffer *buf);
+int lib_ring_buffer_output_init(void);
+void lib_ring_buffer_output_exit(void);
 
 /* Ring Buffer ioctl() and ioctl numbers */
 long lib_ring_buffer_ioctl(struct file *filp, unsigned int cmd,
@@ -70,7 +79,9 @@ ssize_t vfs_lib_ring_buffer_splice_read(struct file *in, loff_t *ppos,
 
 /*
  * Use RING_BUFFER_GET_NEXT_SUBBUF / RING_BUFFER_PUT_NEXT_SUBBUF to read and
- * consume sub-buffers sequentially.
+ * consume sub-buffers sequentially. RING_BUFFER_PUT_GET_NEXT_SUBBUF does both
+ * in a single call. The sub-buffers held can be read with splice(), mmap() or
+ * read(), and none of these operations block.
  *
  * Reading sub-buffers without consuming them can be performed with:
  *
@@ -113,6 +124,100 @@ ssize_t vfs_lib_ring_buffer_splice_read(struct file *in, loff_t *ppos,
 #define RING_BUFFER_GET_MMAP_READ_OFFSET	_IOR(0xF6, 0x0B, unsigned long)
 /* flush the current sub-buffer */
 #define RING_BUFFER_FLUSH			_IO(0xF6, 0x0C)
+/*
+ * get a snapshot of the buffer counters (struct lib_ring_buffer_stats, see
+ * frontend.h). Never fails because of writers: the flags field marks the
+ * snapshots taken while writers kept the counters moving.
+ */
+#define RING_BUFFER_GET_STATS			\
+	_IOR(0xF6, 0x0D, struct lib_ring_buffer_stats)
+
+/*
+ * Control pages of a buffer, which can be mapped read-only at the offset
+ * given by RING_BUFFER_GET_CTRL_OFFSET, for RING_BUFFER_GET_CTRL_LEN bytes,
+ * whatever the buffer output. They let the reader poll the buffer positions
+ * from user space, and only issue the ioctls to get sub-buffers when data is
+ * ready.
+ *
+ * With RING_BUFFER_MMAP output, mapping the buffer with a length of
+ * RING_BUFFER_GET_MMAP_LEN plus RING_BUFFER_GET_CTRL_LEN maps all the buffer
+ * pages at mmap time, followed by the control pages, instead of faulting in
+ * the reader sub-buffer pages. Such mappings are read-only.
+ *
+ * The reader sub-buffer fields are updated each time the reader gets or
+ * releases sub-buffers, the positions and the commit count of a sub-buffer
+ * each time a sub-buffer is delivered or the consumer moves, while the
+ * control pages are mapped. Values are of the kernel unsigned long size,
+ * stored atomically, and the positions and commit counts only go backward
+ * when the buffer is reset.
+ * They are hints: the get ioctls validate them. The commit
+ * counts follow the rules of RING_BUFFER_GET_SUBBUF: a sub-buffer at
+ * position consumed is ready when
+ *   ((commit_count - subbuf_size) & commit_count_mask) ==
+ *     (consumed & ~(buf_size - 1)) >> num_subbuf_order
+ */
+struct lib_ring_buffer_ctrl_page {
+	uint64_t read_sb_index;		/* Backend index of reader sub-buffer */
+	uint64_t read_mmap_offset;	/* mmap offset of reader sub-buffer */
+	uint64_t read_data_size;	/* Size, without padding */
+	uint64_t read_sb_id;		/* Reader sub-buffer id */
+	uint64_t offset;		/* Write position, at last delivery */
+	uint64_t consumed;		/* Read position */
+	uint64_t num_subbuf;		/* Entries of commit_count */
+	uint64_t commit_count[];	/* Sub-buffer reader-visible commits */
+} __attribute__((packed));
+
+#define RING_BUFFER_MAX_SUBBUFS			32
+
+/*
+ * Run of consecutive sub-buffers got by RING_BUFFER_GET_NEXT_SUBBUFS.
+ * The reader sets max_subbufs, the kernel fills nr_subbufs descriptors.
+ * When spliced, the run reads as the concatenation of its sub-buffers, each
+ * one padded to padded_size: the sub-buffer k starts at the sum of the
+ * padded sizes of the sub-buffers before it.
+ */
+struct lib_ring_buffer_subbuf_desc {
+	uint64_t mmap_offset;		/* Sub-buffer offset (mmap output) */
+	uint64_t data_size;		/* Size, without padding */
+	uint64_t padded_size;		/* Size, with padding (for splice) */
+} __attribute__((packed));
+
+struct lib_ring_buffer_subbufs {
+	uint32_t max_subbufs;		/* In: sub-buffers wanted */
+	uint32_t nr_subbufs;		/* Out: sub-buffers got */
+	struct lib_ring_buffer_subbuf_desc subbufs[RING_BUFFER_MAX_SUBBUFS];
+} __attribute__((packed));
+
+/*
+ * Get exclusive read access to a run of consecutive sub-buffers that can be
+ * read. Runs span more than one sub-buffer in discard mode only. Release
+ * the whole run and move consumer forward with RING_BUFFER_PUT_NEXT_SUBBUF.
+ */
+#define RING_BUFFER_GET_NEXT_SUBBUFS		\
+	_IOWR(0xF6, 0x0E, struct lib_ring_buffer_subbufs)
+/* returns the mmap offset of the control pages. */
+#define RING_BUFFER_GET_CTRL_OFFSET		_IOR(0xF6, 0x0F, unsigned long)
+/* returns the length of the control pages. */
+#define RING_BUFFER_GET_CTRL_LEN		_IOR(0xF6, 0x10, unsigned long)
+/*
+ * Release the sub-buffers held, if any, move consumer forward, and get
+ * exclusive read access to the next sub-buffer that can be read.
+ */
+#define RING_BUFFER_PUT_GET_NEXT_SUBBUF		_IO(0xF6, 0x11)
+/*
+ * Wait until the buffer is ready for reading, as an exclusive waiter: a
+ * single waiting thread is woken per delivery. Returns the poll mask of the
+ * buffer (POLLIN, POLLPRI, POLLHUP or POLLERR).
+ */
+#define RING_BUFFER_WAIT_EXCLUSIVE		_IO(0xF6, 0x12)
+/*
+ * Write the delivered sub-buffers to the file descriptor passed as argument
+ * from kernel space, until it is detached by passing -1. Detaching returns
+ * the error which stopped the output, if any. The buffer cannot be read
+ * otherwise while an output is attached. For O_DIRECT files, the file position
+ * must be page aligned.
+ */
+#define RING_BUFFER_SET_OUTPUT_FD		_IO(0xF6, 0x13)
 
 #ifdef CONFIG_COMPAT
 /* Get a snapshot of the current ring buffer producer and consumer positions */
@@ -145,6 +250,20 @@ ssize_t vfs_lib_ring_buffer_splice_read(struct file *in, loff_t *ppos,
 #define RING_BUFFER_COMPAT_GET_MMAP_READ_OFFSET	_IOR(0xF6, 0x0B, compat_ulong_t)
 /* flush the current sub-buffer */
 #define RING_BUFFER_COMPAT_FLUSH		RING_BUFFER_FLUSH
+/* get a snapshot of the buffer counters */
+#define RING_BUFFER_COMPAT_GET_STATS		RING_BUFFER_GET_STATS
+/* get a run of consecutive sub-buffers */
+#define RING_BUFFER_COMPAT_GET_NEXT_SUBBUFS	RING_BUFFER_GET_NEXT_SUBBUFS
+/* returns the mmap offset of the control pages. */
+#define RING_BUFFER_COMPAT_GET_CTRL_OFFSET	_IOR(0xF6, 0x0F, compat_ulong_t)
+/* returns the length of the control pages. */
+#define RING_BUFFER_COMPAT_GET_CTRL_LEN		_IOR(0xF6, 0x10, compat_ulong_t)
+/* Release held sub-buffers, get the next sub-buffer that can be read. */
+#define RING_BUFFER_COMPAT_PUT_GET_NEXT_SUBBUF	RING_BUFFER_PUT_GET_NEXT_SUBBUF
+/* Wait for the buffer to be ready, as an exclusive waiter. */
+#define RING_BUFFER_COMPAT_WAIT_EXCLUSIVE	RING_BUFFER_WAIT_EXCLUSIVE
+/* Write the delivered sub-buffers to a file from kernel space. */
+#define RING_BUFFER_COMPAT_SET_OUTPUT_FD	RING_BUFFER_SET_OUTPUT_FD
 #endif /* CONFIG_COMPAT */
 
 #endif /* _LIB_RING_BUFFER_VFS_H */
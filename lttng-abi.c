@@ -39,6 +39,7 @@
 
 #include <linux/module.h>
 #include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <linux/anon_inodes.h>
 #include <linux/file.h>
 #include <linux/uaccess.h>
@@ -59,11 +60,13 @@
  */
 
 static struct proc_dir_entry *lttng_proc_dentry;
+static struct proc_dir_entry *lttng_stats_proc_dentry;
 static const struct file_operations lttng_fops;
 static const struct file_operations lttng_session_fops;
 static const struct file_operations lttng_channel_fops;
 static const struct file_operations lttng_metadata_fops;
 static const struct file_operations lttng_event_fops;
+static const struct file_operations lttng_enabler_fops;
 
 /*
  * Teardown management: opened file descriptors keep a refcount on the module,
@@ -303,6 +306,7 @@ int lttng_abi_create_channel(struct file *session_file,
 	const char *transport_name;
 	struct lttng_channel *chan;
 	struct file *chan_file;
+	size_t max_memory = 0;
 	int chan_fd;
 	int ret = 0;
 
@@ -335,9 +339,16 @@ int lttng_abi_create_channel(struct file *session_file,
 		} else if (chan_param->output == LTTNG_KERNEL_MMAP) {
 			transport_name = chan_param->overwrite ?
 				"relay-overwrite-mmap" : "relay-discard-mmap";
+		} else if (chan_param->output == LTTNG_KERNEL_SPLICE_VMAP) {
+			transport_name = chan_param->overwrite ?
+				"relay-overwrite-vmap" : "relay-discard-vmap";
+		} else if (chan_param->output == LTTNG_KERNEL_PERSISTENT
+			   && chan_param->overwrite) {
+			transport_name = "relay-overwrite-persistent";
 		} else {
 			return -EINVAL;
 		}
+		max_memory = chan_param->max_memory;
 		break;
 	case METADATA_CHANNEL:
 		if (chan_param->output == LTTNG_KERNEL_SPLICE)
@@ -360,7 +371,7 @@ int lttng_abi_create_channel(struct file *session_file,
 				  chan_param->num_subbuf,
 				  chan_param->switch_timer_interval,
 				  chan_param->read_timer_interval,
-				  channel_type);
+				  max_memory, channel_type);
 	if (!chan) {
 		ret = -EINVAL;
 		goto chan_error;
@@ -420,6 +431,7 @@ long lttng_session_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		chan_param.switch_timer_interval = old_chan_param.switch_timer_interval;
 		chan_param.read_timer_interval = old_chan_param.read_timer_interval;
 		chan_param.output = old_chan_param.output;
+		chan_param.max_memory = 0;
 
 		return lttng_abi_create_channel(file, &chan_param,
 				PER_CPU_CHANNEL);
@@ -460,6 +472,7 @@ long lttng_session_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		chan_param.switch_timer_interval = old_chan_param.switch_timer_interval;
 		chan_param.read_timer_interval = old_chan_param.read_timer_interval;
 		chan_param.output = old_chan_param.output;
+		chan_param.max_memory = 0;
 
 		return lttng_abi_create_channel(file, &chan_param,
 				METADATA_CHANNEL);
@@ -597,6 +610,25 @@ long lttng_metadata_ring_buffer_ioctl(struct file *filp,
 		 */
 		return -ENOSYS;
 	}
+	case RING_BUFFER_GET_NEXT_SUBBUFS:
+	case RING_BUFFER_PUT_GET_NEXT_SUBBUF:
+	case RING_BUFFER_SET_OUTPUT_FD:
+	{
+		/*
+		 * Metadata is pushed into the buffer one sub-buffer at a
+		 * time, on each get: runs and outputs are not available,
+		 * and puts need to be seen by the metadata stream.
+		 */
+		return -ENOSYS;
+	}
+	case RING_BUFFER_WAIT_EXCLUSIVE:
+	{
+		/*
+		 * Metadata readiness is signaled on the stream wait queue,
+		 * use poll.
+		 */
+		return -ENOSYS;
+	}
 	default:
 		break;
 	}
@@ -646,6 +678,25 @@ long lttng_metadata_ring_buffer_compat_ioctl(struct file *filp,
 		 */
 		return -ENOSYS;
 	}
+	case RING_BUFFER_GET_NEXT_SUBBUFS:
+	case RING_BUFFER_PUT_GET_NEXT_SUBBUF:
+	case RING_BUFFER_SET_OUTPUT_FD:
+	{
+		/*
+		 * Metadata is pushed into the buffer one sub-buffer at a
+		 * time, on each get: runs and outputs are not available,
+		 * and puts need to be seen by the metadata stream.
+		 */
+		return -ENOSYS;
+	}
+	case RING_BUFFER_WAIT_EXCLUSIVE:
+	{
+		/*
+		 * Metadata readiness is signaled on the stream wait queue,
+		 * use poll.
+		 */
+		return -ENOSYS;
+	}
 	default:
 		break;
 	}
@@ -704,6 +755,16 @@ ssize_t lttng_metadata_ring_buffer_splice_read(struct file *in, loff_t *ppos,
 			flags, buf);
 }
 
+static
+ssize_t lttng_metadata_ring_buffer_read(struct file *filp,
+		char __user *user_buf, size_t count, loff_t *ppos)
+{
+	struct lttng_metadata_stream *stream = filp->private_data;
+	struct lib_ring_buffer *buf = stream->priv;
+
+	return lib_ring_buffer_read_subbufs(filp, user_buf, count, ppos, buf);
+}
+
 static
 int lttng_metadata_ring_buffer_mmap(struct file *filp,
 		struct vm_area_struct *vma)
@@ -720,6 +781,7 @@ const struct file_operations lttng_metadata_ring_buffer_file_operations = {
 	.open = lttng_metadata_ring_buffer_open,
 	.release = lttng_metadata_ring_buffer_release,
 	.poll = lttng_metadata_ring_buffer_poll,
+	.read = lttng_metadata_ring_buffer_read,
 	.splice_read = lttng_metadata_ring_buffer_splice_read,
 	.mmap = lttng_metadata_ring_buffer_mmap,
 	.unlocked_ioctl = lttng_metadata_ring_buffer_ioctl,
@@ -829,6 +891,46 @@ fd_error:
 	return ret;
 }
 
+static
+int lttng_abi_create_enabler(struct file *channel_file,
+			     struct lttng_kernel_event *event_param)
+{
+	struct lttng_channel *channel = channel_file->private_data;
+	struct lttng_enabler *enabler;
+	int enabler_fd, ret;
+	struct file *enabler_file;
+
+	enabler_fd = get_unused_fd();
+	if (enabler_fd < 0) {
+		ret = enabler_fd;
+		goto fd_error;
+	}
+	enabler_file = anon_inode_getfile("[lttng_enabler]",
+					  &lttng_enabler_fops,
+					  NULL, O_RDWR);
+	if (IS_ERR(enabler_file)) {
+		ret = PTR_ERR(enabler_file);
+		goto file_error;
+	}
+	enabler = lttng_enabler_create(channel, event_param);
+	if (IS_ERR(enabler)) {
+		ret = PTR_ERR(enabler);
+		goto enabler_error;
+	}
+	enabler_file->private_data = enabler;
+	fd_install(enabler_fd, enabler_file);
+	/* The enabler holds a reference on the channel */
+	atomic_long_inc(&channel_file->f_count);
+	return enabler_fd;
+
+enabler_error:
+	fput(enabler_file);
+file_error:
+	put_unused_fd(enabler_fd);
+fd_error:
+	return ret;
+}
+
 static
 int lttng_abi_create_event(struct file *channel_file,
 			   struct lttng_kernel_event *event_param)
@@ -852,6 +954,15 @@ int lttng_abi_create_event(struct file *channel_file,
 	default:
 		break;
 	}
+	/*
+	 * A tracepoint name containing a star is a glob. The syscalls named
+	 * "*" are all traced through an enabler, which can filter them.
+	 */
+	if ((event_param->instrumentation == LTTNG_KERNEL_TRACEPOINT
+	     && strchr(event_param->name, '*'))
+	    || (event_param->instrumentation == LTTNG_KERNEL_SYSCALL
+	     && !strcmp(event_param->name, "*")))
+		return lttng_abi_create_enabler(channel_file, event_param);
 	switch (event_param->instrumentation) {
 	default:
 		event_fd = get_unused_fd();
@@ -886,7 +997,7 @@ int lttng_abi_create_event(struct file *channel_file,
 		 */
 		if (event_param->name[0] != '\0')
 			return -EINVAL;
-		ret = lttng_syscalls_register(channel, NULL);
+		ret = lttng_syscalls_register(channel);
 		if (ret)
 			goto fd_error;
 		event_fd = 0;
@@ -902,6 +1013,43 @@ fd_error:
 	return ret;
 }
 
+/*
+ * Stream addition/removal state of the channel, as a poll mask.
+ */
+static
+unsigned int lttng_channel_poll_mask(struct lttng_channel *channel)
+{
+	if (channel->ops->is_disabled(channel->chan))
+		return POLLERR;
+	if (channel->ops->is_finalized(channel->chan))
+		return POLLHUP;
+	if (channel->ops->buffer_has_read_closed_stream(channel->chan))
+		return POLLIN | POLLRDNORM;
+	return 0;
+}
+
+/*
+ * Wait for stream addition/removal as an exclusive waiter of the channel
+ * hotplug wait queue, like RING_BUFFER_WAIT_EXCLUSIVE does for streams.
+ * Returns the poll mask of the channel.
+ */
+static
+long lttng_channel_wait_exclusive(struct file *file)
+{
+	struct lttng_channel *channel = file->private_data;
+	unsigned int mask;
+	int ret;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+	ret = wait_event_interruptible_exclusive(
+			*channel->ops->get_hp_wait_queue(channel->chan),
+			(mask = lttng_channel_poll_mask(channel)) != 0);
+	if (ret)
+		return ret;
+	return mask;
+}
+
 /**
  *	lttng_channel_ioctl - lttng syscall through ioctl
  *
@@ -914,13 +1062,21 @@ fd_error:
  *              Returns an event stream file descriptor or failure.
  *              (typically, one event stream records events from one CPU)
  *	LTTNG_KERNEL_EVENT
- *		Returns an event file descriptor or failure.
+ *		Returns an event file descriptor or failure. For a
+ *		tracepoint name containing '*', returns an enabler file
+ *		descriptor: the events whose name matches the glob are
+ *		created, including those of the probes loaded later on.
+ *		Syscalls named "*" also return an enabler file descriptor,
+ *		through which all the syscall events are filtered.
  *	LTTNG_KERNEL_CONTEXT
  *		Prepend a context field to each event in the channel
  *	LTTNG_KERNEL_ENABLE
  *		Enable recording for events in this channel (weak enable)
  *	LTTNG_KERNEL_DISABLE
  *		Disable recording for events in this channel (strong disable)
+ *	LTTNG_KERNEL_CHANNEL_WAIT_EXCLUSIVE
+ *		Wait for stream addition/removal, waking a single waiter per
+ *		change. Returns the poll mask of the channel.
  *
  * Channel and event file descriptors also hold a reference on the session.
  */
@@ -1078,6 +1234,8 @@ old_ctx_end:
 	case LTTNG_KERNEL_OLD_DISABLE:
 	case LTTNG_KERNEL_DISABLE:
 		return lttng_channel_disable(channel);
+	case LTTNG_KERNEL_CHANNEL_WAIT_EXCLUSIVE:
+		return lttng_channel_wait_exclusive(file);
 	default:
 		return -ENOIOCTLCMD;
 	}
@@ -1124,14 +1282,7 @@ unsigned int lttng_channel_poll(struct file *file, poll_table *wait)
 		poll_wait_set_exclusive(wait);
 		poll_wait(file, channel->ops->get_hp_wait_queue(channel->chan),
 			  wait);
-
-		if (channel->ops->is_disabled(channel->chan))
-			return POLLERR;
-		if (channel->ops->is_finalized(channel->chan))
-			return POLLHUP;
-		if (channel->ops->buffer_has_read_closed_stream(channel->chan))
-			return POLLIN | POLLRDNORM;
-		return 0;
+		mask = lttng_channel_poll_mask(channel);
 	}
 	return mask;
 
@@ -1179,6 +1330,56 @@ static const struct file_operations lttng_metadata_fops = {
 #endif
 };
 
+/*
+ * Returns a copy of the filter bytecode, to free with kfree(), or an
+ * ERR_PTR() value.
+ */
+static
+struct lttng_kernel_filter_bytecode *lttng_abi_copy_filter(
+		struct lttng_kernel_filter_bytecode __user *ubytecode)
+{
+	struct lttng_kernel_filter_bytecode *bytecode;
+	uint32_t len;
+	int ret;
+
+	if (get_user(len, &ubytecode->len))
+		return ERR_PTR(-EFAULT);
+	if (len > LTTNG_KERNEL_FILTER_BYTECODE_MAX_LEN)
+		return ERR_PTR(-EINVAL);
+	bytecode = kmalloc(sizeof(*bytecode) + len, GFP_KERNEL);
+	if (!bytecode)
+		return ERR_PTR(-ENOMEM);
+	if (copy_from_user(bytecode, ubytecode, sizeof(*bytecode) + len)) {
+		ret = -EFAULT;
+		goto error;
+	}
+	/* Length read again: may have changed since the first read. */
+	if (bytecode->len != len) {
+		ret = -EINVAL;
+		goto error;
+	}
+	return bytecode;
+
+error:
+	kfree(bytecode);
+	return ERR_PTR(ret);
+}
+
+static
+int lttng_abi_event_filter(struct lttng_event *event,
+		struct lttng_kernel_filter_bytecode __user *ubytecode)
+{
+	struct lttng_kernel_filter_bytecode *bytecode;
+	int ret;
+
+	bytecode = lttng_abi_copy_filter(ubytecode);
+	if (IS_ERR(bytecode))
+		return PTR_ERR(bytecode);
+	ret = lttng_event_attach_filter(event, bytecode);
+	kfree(bytecode);
+	return ret;
+}
+
 /**
  *	lttng_event_ioctl - lttng syscall through ioctl
  *
@@ -1193,6 +1394,9 @@ static const struct file_operations lttng_metadata_fops = {
  *		Enable recording for this event (weak enable)
  *	LTTNG_KERNEL_DISABLE
  *		Disable recording for this event (strong disable)
+ *	LTTNG_KERNEL_FILTER
+ *		Attach a filter bytecode to this tracepoint event, replacing
+ *		the previous one. Only the events it accepts are recorded.
  */
 static
 long lttng_event_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
@@ -1268,6 +1472,9 @@ old_ctx_end:
 	case LTTNG_KERNEL_OLD_DISABLE:
 	case LTTNG_KERNEL_DISABLE:
 		return lttng_event_disable(event);
+	case LTTNG_KERNEL_FILTER:
+		return lttng_abi_event_filter(event,
+				(struct lttng_kernel_filter_bytecode __user *) arg);
 	default:
 		return -ENOIOCTLCMD;
 	}
@@ -1283,7 +1490,6 @@ int lttng_event_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
-/* TODO: filter control ioctl */
 static const struct file_operations lttng_event_fops = {
 	.owner = THIS_MODULE,
 	.release = lttng_event_release,
@@ -1293,6 +1499,104 @@ static const struct file_operations lttng_event_fops = {
 #endif
 };
 
+static
+int lttng_abi_enabler_filter(struct lttng_enabler *enabler,
+		struct lttng_kernel_filter_bytecode __user *ubytecode)
+{
+	struct lttng_kernel_filter_bytecode *bytecode;
+	int ret;
+
+	bytecode = lttng_abi_copy_filter(ubytecode);
+	if (IS_ERR(bytecode))
+		return PTR_ERR(bytecode);
+	ret = lttng_enabler_attach_filter(enabler, bytecode);
+	kfree(bytecode);
+	return ret;
+}
+
+/**
+ *	lttng_enabler_ioctl - lttng syscall through ioctl
+ *
+ *	@file: the file
+ *	@cmd: the command
+ *	@arg: command arg
+ *
+ *	This ioctl implements lttng commands:
+ *	LTTNG_KERNEL_ENABLE
+ *		Enable recording for the events of this enabler (weak enable)
+ *	LTTNG_KERNEL_DISABLE
+ *		Disable recording for the events of this enabler (strong
+ *		disable)
+ *	LTTNG_KERNEL_FILTER
+ *		Attach a filter bytecode to the events of this enabler,
+ *		replacing the previous one. The events lacking the fields it
+ *		refers to record nothing.
+ *
+ * Enabler file descriptors hold a reference on the channel.
+ */
+static
+long lttng_enabler_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	struct lttng_enabler *enabler = file->private_data;
+
+	switch (cmd) {
+	case LTTNG_KERNEL_OLD_ENABLE:
+	case LTTNG_KERNEL_ENABLE:
+		return lttng_enabler_enable(enabler);
+	case LTTNG_KERNEL_OLD_DISABLE:
+	case LTTNG_KERNEL_DISABLE:
+		return lttng_enabler_disable(enabler);
+	case LTTNG_KERNEL_FILTER:
+		return lttng_abi_enabler_filter(enabler,
+				(struct lttng_kernel_filter_bytecode __user *) arg);
+	default:
+		return -ENOIOCTLCMD;
+	}
+}
+
+static
+int lttng_enabler_release(struct inode *inode, struct file *file)
+{
+	struct lttng_enabler *enabler = file->private_data;
+
+	if (enabler)
+		fput(enabler->chan->file);
+	return 0;
+}
+
+static const struct file_operations lttng_enabler_fops = {
+	.owner = THIS_MODULE,
+	.release = lttng_enabler_release,
+	.unlocked_ioctl = lttng_enabler_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl = lttng_enabler_ioctl,
+#endif
+};
+
+static
+int lttng_stats_show(struct seq_file *m, void *v)
+{
+	return lttng_session_list_stats(m);
+}
+
+static
+int lttng_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lttng_stats_show, NULL);
+}
+
+/*
+ * /proc/lttng-stats: per-cpu buffer counters of every channel, readable while
+ * tracing without holding any stream file descriptor.
+ */
+static const struct file_operations lttng_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = lttng_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int __init lttng_abi_init(void)
 {
 	int ret = 0;
@@ -1306,12 +1610,26 @@ int __init lttng_abi_init(void)
 		ret = -ENOMEM;
 		goto error;
 	}
+	lttng_stats_proc_dentry = proc_create_data("lttng-stats", S_IRUSR,
+						NULL, &lttng_stats_fops, NULL);
+	if (!lttng_stats_proc_dentry) {
+		printk(KERN_ERR "Error creating LTTng stats file\n");
+		ret = -ENOMEM;
+		goto error_stats;
+	}
+	return 0;
+
+error_stats:
+	remove_proc_entry("lttng", NULL);
+	lttng_proc_dentry = NULL;
 error:
 	return ret;
 }
 
 void __exit lttng_abi_exit(void)
 {
+	if (lttng_stats_proc_dentry)
+		remove_proc_entry("lttng-stats", NULL);
 	if (lttng_proc_dentry)
 		remove_proc_entry("lttng", NULL);
 }
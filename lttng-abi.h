@@ -42,6 +42,8 @@ enum lttng_kernel_instrumentation {
 enum lttng_kernel_output {
 	LTTNG_KERNEL_SPLICE	= 0,
 	LTTNG_KERNEL_MMAP	= 1,
+	LTTNG_KERNEL_PERSISTENT	= 2,	/* splice, persistent memory */
+	LTTNG_KERNEL_SPLICE_VMAP = 3,	/* splice, contiguous sub-buffers */
 };
 
 /*
@@ -55,7 +57,12 @@ struct lttng_kernel_channel {
 	unsigned int read_timer_interval;	/* usecs */
 	enum lttng_kernel_output output;	/* splice, mmap */
 	int overwrite;				/* 1: overwrite, 0: discard */
-	char padding[LTTNG_KERNEL_CHANNEL_PADDING];
+	/*
+	 * Memory ceiling (in bytes) of an adaptively populated channel, 0 to
+	 * populate all buffers fully. Only for discard mode splice channels.
+	 */
+	uint64_t max_memory;
+	char padding[LTTNG_KERNEL_CHANNEL_PADDING - sizeof(uint64_t)];
 }__attribute__((packed));
 
 struct lttng_kernel_kretprobe {
@@ -144,6 +151,17 @@ struct lttng_kernel_context {
 	} u;
 }__attribute__((packed));
 
+/*
+ * Filter bytecode, see lttng-filter-bytecode.h. The relocation table starts
+ * at reloc_offset within data.
+ */
+#define LTTNG_KERNEL_FILTER_BYTECODE_MAX_LEN	65536
+struct lttng_kernel_filter_bytecode {
+	uint32_t len;		/* Length of data, in bytes */
+	uint32_t reloc_offset;
+	char data[0];
+}__attribute__((packed));
+
 /* LTTng file descriptor ioctl */
 #define LTTNG_KERNEL_SESSION			_IO(0xF6, 0x45)
 #define LTTNG_KERNEL_TRACER_VERSION		\
@@ -165,11 +183,19 @@ struct lttng_kernel_context {
 #define LTTNG_KERNEL_STREAM			_IO(0xF6, 0x62)
 #define LTTNG_KERNEL_EVENT			\
 	_IOW(0xF6, 0x63, struct lttng_kernel_event)
+/*
+ * Wait for stream addition/removal, as an exclusive waiter: a single waiting
+ * thread is woken per change. Returns the poll mask of the channel.
+ */
+#define LTTNG_KERNEL_CHANNEL_WAIT_EXCLUSIVE	_IO(0xF6, 0x64)
 
 /* Event and Channel FD ioctl */
 #define LTTNG_KERNEL_CONTEXT			\
 	_IOW(0xF6, 0x71, struct lttng_kernel_context)
 
+/* Event FD ioctl */
+#define LTTNG_KERNEL_FILTER			_IO(0xF6, 0x90)
+
 /* Event, Channel and Session ioctl */
 #define LTTNG_KERNEL_ENABLE			_IO(0xF6, 0x82)
 #define LTTNG_KERNEL_DISABLE			_IO(0xF6, 0x83)
@@ -65,6 +65,22 @@ void hostname_record(struct lttng_ctx_field *field,
 	}
 }
 
+static
+void hostname_gather(struct lttng_ctx_field *field,
+		 struct lib_ring_buffer_ctx *ctx,
+		 void *dst)
+{
+	struct nsproxy *nsproxy;
+
+	/* See hostname_record. */
+	nsproxy = current->nsproxy;
+	if (nsproxy)
+		memcpy(dst, nsproxy->uts_ns->name.nodename,
+			LTTNG_HOSTNAME_CTX_LEN);
+	else
+		memset(dst, 0, LTTNG_HOSTNAME_CTX_LEN);
+}
+
 int lttng_add_hostname_to_ctx(struct lttng_ctx **ctx)
 {
 	struct lttng_ctx_field *field;
@@ -89,6 +105,10 @@ int lttng_add_hostname_to_ctx(struct lttng_ctx **ctx)
 
 	field->get_size = hostname_get_size;
 	field->record = hostname_record;
+	field->gather.type = LTTNG_CTX_GATHER_CALLBACK;
+	field->gather.size = LTTNG_HOSTNAME_CTX_LEN;
+	field->gather.alignment = 1;
+	field->gather.get = hostname_gather;
 	wrapper_vmalloc_sync_all();
 	return 0;
 }
@@ -71,6 +71,9 @@ int lttng_add_nice_to_ctx(struct lttng_ctx **ctx)
 	field->event_field.type.u.basic.integer.encoding = lttng_encode_none;
 	field->get_size = nice_get_size;
 	field->record = nice_record;
+	field->gather.type = LTTNG_CTX_GATHER_NICE;
+	field->gather.size = sizeof(int);
+	field->gather.alignment = lttng_alignof(int);
 	wrapper_vmalloc_sync_all();
 	return 0;
 }
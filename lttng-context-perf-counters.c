@@ -43,9 +43,9 @@ size_t perf_counter_get_size(size_t offset)
 }
 
 static
-void perf_counter_record(struct lttng_ctx_field *field,
+void perf_counter_gather(struct lttng_ctx_field *field,
 			 struct lib_ring_buffer_ctx *ctx,
-			 struct lttng_channel *chan)
+			 void *dst)
 {
 	struct perf_event *event;
 	uint64_t value;
@@ -68,6 +68,17 @@ void perf_counter_record(struct lttng_ctx_field *field,
 		 */
 		value = 0;
 	}
+	memcpy(dst, &value, sizeof(value));
+}
+
+static
+void perf_counter_record(struct lttng_ctx_field *field,
+			 struct lib_ring_buffer_ctx *ctx,
+			 struct lttng_channel *chan)
+{
+	uint64_t value;
+
+	perf_counter_gather(field, ctx, &value);
 	lib_ring_buffer_align_ctx(ctx, lttng_alignof(value));
 	chan->ops->event_write(ctx, &value, sizeof(value));
 }
@@ -251,6 +262,10 @@ int lttng_add_perf_counter_to_ctx(uint32_t type,
 	field->event_field.type.u.basic.integer.encoding = lttng_encode_none;
 	field->get_size = perf_counter_get_size;
 	field->record = perf_counter_record;
+	field->gather.type = LTTNG_CTX_GATHER_CALLBACK;
+	field->gather.size = sizeof(uint64_t);
+	field->gather.alignment = lttng_alignof(uint64_t);
+	field->gather.get = perf_counter_gather;
 	field->u.perf_counter = perf_field;
 	perf_field->hp_enable = 1;
 
@@ -40,9 +40,9 @@ size_t ppid_get_size(size_t offset)
 }
 
 static
-void ppid_record(struct lttng_ctx_field *field,
+void ppid_gather(struct lttng_ctx_field *field,
 		 struct lib_ring_buffer_ctx *ctx,
-		 struct lttng_channel *chan)
+		 void *dst)
 {
 	pid_t ppid;
 
@@ -58,6 +58,17 @@ void ppid_record(struct lttng_ctx_field *field,
 	rcu_read_lock();
 	ppid = task_tgid_nr(current->real_parent);
 	rcu_read_unlock();
+	memcpy(dst, &ppid, sizeof(ppid));
+}
+
+static
+void ppid_record(struct lttng_ctx_field *field,
+		 struct lib_ring_buffer_ctx *ctx,
+		 struct lttng_channel *chan)
+{
+	pid_t ppid;
+
+	ppid_gather(field, ctx, &ppid);
 	lib_ring_buffer_align_ctx(ctx, lttng_alignof(ppid));
 	chan->ops->event_write(ctx, &ppid, sizeof(ppid));
 }
@@ -83,6 +94,10 @@ int lttng_add_ppid_to_ctx(struct lttng_ctx **ctx)
 	field->event_field.type.u.basic.integer.encoding = lttng_encode_none;
 	field->get_size = ppid_get_size;
 	field->record = ppid_record;
+	field->gather.type = LTTNG_CTX_GATHER_CALLBACK;
+	field->gather.size = sizeof(pid_t);
+	field->gather.alignment = lttng_alignof(pid_t);
+	field->gather.get = ppid_gather;
 	wrapper_vmalloc_sync_all();
 	return 0;
 }
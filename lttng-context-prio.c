@@ -52,6 +52,17 @@ size_t prio_get_size(size_t offset)
 	return size;
 }
 
+static
+void prio_gather(struct lttng_ctx_field *field,
+		struct lib_ring_buffer_ctx *ctx,
+		void *dst)
+{
+	int prio;
+
+	prio = wrapper_task_prio_sym(current);
+	memcpy(dst, &prio, sizeof(prio));
+}
+
 static
 void prio_record(struct lttng_ctx_field *field,
 		struct lib_ring_buffer_ctx *ctx,
@@ -59,7 +70,7 @@ void prio_record(struct lttng_ctx_field *field,
 {
 	int prio;
 
-	prio = wrapper_task_prio_sym(current);
+	prio_gather(field, ctx, &prio);
 	lib_ring_buffer_align_ctx(ctx, lttng_alignof(prio));
 	chan->ops->event_write(ctx, &prio, sizeof(prio));
 }
@@ -92,6 +103,10 @@ int lttng_add_prio_to_ctx(struct lttng_ctx **ctx)
 	field->event_field.type.u.basic.integer.encoding = lttng_encode_none;
 	field->get_size = prio_get_size;
 	field->record = prio_record;
+	field->gather.type = LTTNG_CTX_GATHER_CALLBACK;
+	field->gather.size = sizeof(int);
+	field->gather.alignment = lttng_alignof(int);
+	field->gather.get = prio_gather;
 	wrapper_vmalloc_sync_all();
 	return 0;
 }
@@ -75,6 +75,9 @@ int lttng_add_procname_to_ctx(struct lttng_ctx **ctx)
 
 	field->get_size = procname_get_size;
 	field->record = procname_record;
+	field->gather.type = LTTNG_CTX_GATHER_PROCNAME;
+	field->gather.size = sizeof(current->comm);
+	field->gather.alignment = 1;
 	wrapper_vmalloc_sync_all();
 	return 0;
 }
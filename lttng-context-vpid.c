@@ -77,6 +77,9 @@ int lttng_add_vpid_to_ctx(struct lttng_ctx **ctx)
 	field->event_field.type.u.basic.integer.encoding = lttng_encode_none;
 	field->get_size = vpid_get_size;
 	field->record = vpid_record;
+	field->gather.type = LTTNG_CTX_GATHER_VPID;
+	field->gather.size = sizeof(pid_t);
+	field->gather.alignment = lttng_alignof(pid_t);
 	wrapper_vmalloc_sync_all();
 	return 0;
 }
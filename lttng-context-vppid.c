@@ -40,9 +40,9 @@ size_t vppid_get_size(size_t offset)
 }
 
 static
-void vppid_record(struct lttng_ctx_field *field,
+void vppid_gather(struct lttng_ctx_field *field,
 		  struct lib_ring_buffer_ctx *ctx,
-		  struct lttng_channel *chan)
+		  void *dst)
 {
 	struct task_struct *parent;
 	pid_t vppid;
@@ -67,6 +67,17 @@ void vppid_record(struct lttng_ctx_field *field,
 	else
 		vppid = task_tgid_vnr(parent);
 	rcu_read_unlock();
+	memcpy(dst, &vppid, sizeof(vppid));
+}
+
+static
+void vppid_record(struct lttng_ctx_field *field,
+		  struct lib_ring_buffer_ctx *ctx,
+		  struct lttng_channel *chan)
+{
+	pid_t vppid;
+
+	vppid_gather(field, ctx, &vppid);
 	lib_ring_buffer_align_ctx(ctx, lttng_alignof(vppid));
 	chan->ops->event_write(ctx, &vppid, sizeof(vppid));
 }
@@ -92,6 +103,10 @@ int lttng_add_vppid_to_ctx(struct lttng_ctx **ctx)
 	field->event_field.type.u.basic.integer.encoding = lttng_encode_none;
 	field->get_size = vppid_get_size;
 	field->record = vppid_record;
+	field->gather.type = LTTNG_CTX_GATHER_CALLBACK;
+	field->gather.size = sizeof(pid_t);
+	field->gather.alignment = lttng_alignof(pid_t);
+	field->gather.get = vppid_gather;
 	wrapper_vmalloc_sync_all();
 	return 0;
 }
@@ -90,6 +90,35 @@ void lttng_remove_context_field(struct lttng_ctx **ctx_p,
 }
 EXPORT_SYMBOL_GPL(lttng_remove_context_field);
 
+/*
+ * Compute the bound of the blob gathering all the context field values,
+ * including their alignment padding. Leaves the context on the per-field
+ * record callbacks if any field cannot be gathered, or if the blob would
+ * not fit on the stack. Called with the sessions mutex held, once the
+ * context cannot change anymore.
+ */
+void lttng_context_update(struct lttng_ctx *ctx)
+{
+	size_t size = 0;
+	int i;
+
+	if (!ctx)
+		return;
+	for (i = 0; i < ctx->nr_fields; i++) {
+		struct lttng_ctx_gather *gather = &ctx->fields[i].gather;
+
+		if (gather->type == LTTNG_CTX_GATHER_NONE) {
+			size = 0;
+			goto end;
+		}
+		size += gather->alignment - 1 + gather->size;
+	}
+	if (size > LTTNG_CTX_GATHER_MAX)
+		size = 0;
+end:
+	ctx->gather_size = size;
+}
+
 void lttng_destroy_context(struct lttng_ctx *ctx)
 {
 	int i;
@@ -25,13 +25,18 @@
 #include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/err.h>
 #include <linux/jiffies.h>
 #include <linux/utsname.h>
+#include <linux/seq_file.h>
 #include "wrapper/uuid.h"
 #include "wrapper/vmalloc.h"	/* for wrapper_vmalloc_sync_all() */
 #include "wrapper/random.h"
 #include "wrapper/tracepoint.h"
+#include "wrapper/ringbuffer/frontend.h"
+#include "wrapper/ringbuffer/vfs.h"
 #include "lttng-events.h"
+#include "lttng-filter.h"
 #include "lttng-tracer.h"
 #include "lttng-abi-old.h"
 
@@ -56,6 +61,10 @@ static
 int _lttng_session_metadata_statedump(struct lttng_session *session);
 static
 void _lttng_metadata_channel_hangup(struct lttng_metadata_stream *stream);
+static
+void _lttng_session_set_active(struct lttng_session *session, int active);
+static
+void _lttng_enabler_destroy(struct lttng_enabler *enabler);
 
 void synchronize_trace(void)
 {
@@ -76,6 +85,7 @@ struct lttng_session *lttng_session_create(void)
 		goto err;
 	INIT_LIST_HEAD(&session->chan);
 	INIT_LIST_HEAD(&session->events);
+	INIT_LIST_HEAD(&session->enablers);
 	uuid_le_gen(&session->uuid);
 
 	metadata_cache = kzalloc(sizeof(struct lttng_metadata_cache),
@@ -115,11 +125,12 @@ void lttng_session_destroy(struct lttng_session *session)
 {
 	struct lttng_channel *chan, *tmpchan;
 	struct lttng_event *event, *tmpevent;
+	struct lttng_enabler *enabler, *tmpenabler;
 	struct lttng_metadata_stream *metadata_stream;
 	int ret;
 
 	mutex_lock(&sessions_mutex);
-	ACCESS_ONCE(session->active) = 0;
+	_lttng_session_set_active(session, 0);
 	list_for_each_entry(chan, &session->chan, list) {
 		ret = lttng_syscalls_unregister(chan);
 		WARN_ON(ret);
@@ -131,6 +142,8 @@ void lttng_session_destroy(struct lttng_session *session)
 	synchronize_trace();	/* Wait for in-flight events to complete */
 	list_for_each_entry_safe(event, tmpevent, &session->events, list)
 		_lttng_event_destroy(event);
+	list_for_each_entry_safe(enabler, tmpenabler, &session->enablers, node)
+		_lttng_enabler_destroy(enabler);
 	list_for_each_entry_safe(chan, tmpchan, &session->chan, list) {
 		BUG_ON(chan->channel_type == METADATA_CHANNEL);
 		_lttng_channel_destroy(chan);
@@ -143,10 +156,61 @@ void lttng_session_destroy(struct lttng_session *session)
 	kfree(session);
 }
 
+/*
+ * Needs to be called with sessions mutex held, before the event can be
+ * traced with its channel header type.
+ */
+static
+void _lttng_event_update_plan(struct lttng_event *event)
+{
+	struct lttng_channel *chan = event->chan;
+
+	if (chan->header_type && chan->ops->event_update_plan)
+		chan->ops->event_update_plan(event);
+}
+
+/*
+ * Recompute whether the probe records the event, from the session, channel
+ * and event state. Needs to be called with sessions mutex held.
+ */
+static
+void _lttng_event_update_armed(struct lttng_event *event)
+{
+	struct lttng_channel *chan = event->chan;
+
+	ACCESS_ONCE(event->armed) = chan->session->active && chan->enabled
+		&& event->enabled;
+}
+
+static
+void _lttng_channel_update_armed(struct lttng_channel *chan)
+{
+	struct lttng_event *event;
+
+	list_for_each_entry(event, &chan->session->events, list) {
+		if (event->chan == chan)
+			_lttng_event_update_armed(event);
+	}
+}
+
+/*
+ * Needs to be called with sessions mutex held.
+ */
+static
+void _lttng_session_set_active(struct lttng_session *session, int active)
+{
+	struct lttng_event *event;
+
+	ACCESS_ONCE(session->active) = active;
+	list_for_each_entry(event, &session->events, list)
+		_lttng_event_update_armed(event);
+}
+
 int lttng_session_enable(struct lttng_session *session)
 {
 	int ret = 0;
 	struct lttng_channel *chan;
+	struct lttng_event *event;
 
 	mutex_lock(&sessions_mutex);
 	if (session->active) {
@@ -167,16 +231,27 @@ int lttng_session_enable(struct lttng_session *session)
 			chan->header_type = 2;	/* large */
 	}
 
-	ACCESS_ONCE(session->active) = 1;
+	/*
+	 * Contexts cannot change anymore: precompute how they are recorded
+	 * and the header sizes.
+	 */
+	list_for_each_entry(chan, &session->chan, list)
+		lttng_context_update(chan->ctx);
+	list_for_each_entry(event, &session->events, list) {
+		lttng_context_update(event->ctx);
+		_lttng_event_update_plan(event);
+	}
+
+	_lttng_session_set_active(session, 1);
 	ACCESS_ONCE(session->been_active) = 1;
 	ret = _lttng_session_metadata_statedump(session);
 	if (ret) {
-		ACCESS_ONCE(session->active) = 0;
+		_lttng_session_set_active(session, 0);
 		goto end;
 	}
 	ret = lttng_statedump_start(session);
 	if (ret)
-		ACCESS_ONCE(session->active) = 0;
+		_lttng_session_set_active(session, 0);
 end:
 	mutex_unlock(&sessions_mutex);
 	return ret;
@@ -191,7 +266,7 @@ int lttng_session_disable(struct lttng_session *session)
 		ret = -EBUSY;
 		goto end;
 	}
-	ACCESS_ONCE(session->active) = 0;
+	_lttng_session_set_active(session, 0);
 end:
 	mutex_unlock(&sessions_mutex);
 	return ret;
@@ -199,49 +274,155 @@ end:
 
 int lttng_channel_enable(struct lttng_channel *channel)
 {
-	int old;
+	int ret = 0;
 
 	if (channel->channel_type == METADATA_CHANNEL)
 		return -EPERM;
-	old = xchg(&channel->enabled, 1);
-	if (old)
-		return -EEXIST;
-	return 0;
+	mutex_lock(&sessions_mutex);
+	if (channel->enabled) {
+		ret = -EEXIST;
+		goto end;
+	}
+	ACCESS_ONCE(channel->enabled) = 1;
+	_lttng_channel_update_armed(channel);
+end:
+	mutex_unlock(&sessions_mutex);
+	return ret;
 }
 
 int lttng_channel_disable(struct lttng_channel *channel)
 {
-	int old;
+	int ret = 0;
 
 	if (channel->channel_type == METADATA_CHANNEL)
 		return -EPERM;
-	old = xchg(&channel->enabled, 0);
-	if (!old)
-		return -EEXIST;
-	return 0;
+	mutex_lock(&sessions_mutex);
+	if (!channel->enabled) {
+		ret = -EEXIST;
+		goto end;
+	}
+	ACCESS_ONCE(channel->enabled) = 0;
+	_lttng_channel_update_armed(channel);
+end:
+	mutex_unlock(&sessions_mutex);
+	return ret;
 }
 
 int lttng_event_enable(struct lttng_event *event)
 {
-	int old;
+	int ret = 0;
 
 	if (event->chan->channel_type == METADATA_CHANNEL)
 		return -EPERM;
-	old = xchg(&event->enabled, 1);
-	if (old)
-		return -EEXIST;
-	return 0;
+	mutex_lock(&sessions_mutex);
+	if (event->enabled) {
+		ret = -EEXIST;
+		goto end;
+	}
+	ACCESS_ONCE(event->enabled) = 1;
+	_lttng_event_update_armed(event);
+end:
+	mutex_unlock(&sessions_mutex);
+	return ret;
 }
 
 int lttng_event_disable(struct lttng_event *event)
 {
-	int old;
+	int ret = 0;
+
+	if (event->chan->channel_type == METADATA_CHANNEL)
+		return -EPERM;
+	mutex_lock(&sessions_mutex);
+	if (!event->enabled) {
+		ret = -EEXIST;
+		goto end;
+	}
+	ACCESS_ONCE(event->enabled) = 0;
+	_lttng_event_update_armed(event);
+end:
+	mutex_unlock(&sessions_mutex);
+	return ret;
+}
+
+/*
+ * Link the filter bytecode against the event fields, and make the probe
+ * record only the events it accepts. Replaces the previous filter, which is
+ * freed once no probe can use it anymore.
+ */
+int lttng_event_attach_filter(struct lttng_event *event,
+		const struct lttng_kernel_filter_bytecode *bytecode)
+{
+	struct lttng_filter *filter, *old;
 
 	if (event->chan->channel_type == METADATA_CHANNEL)
 		return -EPERM;
-	old = xchg(&event->enabled, 0);
-	if (!old)
-		return -EEXIST;
+	/* Only the tracepoint and syscall probes capture the event fields. */
+	if (event->instrumentation != LTTNG_KERNEL_TRACEPOINT
+	    && event->instrumentation != LTTNG_KERNEL_NOOP)
+		return -EINVAL;
+	filter = lttng_filter_create(event->desc, bytecode);
+	if (IS_ERR(filter))
+		return PTR_ERR(filter);
+	mutex_lock(&sessions_mutex);
+	old = event->filter;
+	rcu_assign_pointer(event->filter, filter);
+	mutex_unlock(&sessions_mutex);
+	if (old) {
+		synchronize_trace();
+		lttng_filter_destroy(old);
+	}
+	return 0;
+}
+
+/*
+ * Print the counters of each per-cpu buffer of every channel, one line per
+ * buffer. Only the sessions_mutex is taken: the counters are sampled without
+ * synchronizing with the tracing fast path, and "consistent 0" marks the
+ * snapshots taken while writers kept changing the counters.
+ */
+int lttng_session_list_stats(struct seq_file *m)
+{
+	struct lttng_session *session;
+	struct lttng_channel *chan;
+	struct lib_ring_buffer_stats stats;
+	struct lib_ring_buffer *buf;
+	unsigned char *uuid_c;
+	int cpu;
+
+	mutex_lock(&sessions_mutex);
+	list_for_each_entry(session, &sessions, list) {
+		uuid_c = session->uuid.b;
+		list_for_each_entry(chan, &session->chan, list) {
+			if (chan->channel_type == METADATA_CHANNEL)
+				continue;
+			for_each_channel_cpu(cpu, chan->chan) {
+				buf = channel_get_ring_buffer(
+					&chan->chan->backend.config,
+					chan->chan, cpu);
+				lib_ring_buffer_get_stats(buf, &stats);
+				seq_printf(m,
+					"session %02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x "
+					"channel %u cpu %d "
+					"records %llu overrun %llu "
+					"lost_full %llu lost_wrap %llu lost_big %llu "
+					"produced %llu consumed %llu consistent %d\n",
+					uuid_c[0], uuid_c[1], uuid_c[2], uuid_c[3],
+					uuid_c[4], uuid_c[5], uuid_c[6], uuid_c[7],
+					uuid_c[8], uuid_c[9], uuid_c[10], uuid_c[11],
+					uuid_c[12], uuid_c[13], uuid_c[14], uuid_c[15],
+					chan->id, cpu,
+					(unsigned long long) stats.records_count,
+					(unsigned long long) stats.records_overrun,
+					(unsigned long long) stats.records_lost_full,
+					(unsigned long long) stats.records_lost_wrap,
+					(unsigned long long) stats.records_lost_big,
+					(unsigned long long) stats.bytes_produced,
+					(unsigned long long) stats.bytes_consumed,
+					!(stats.flags & LIB_RING_BUFFER_STATS_INCONSISTENT));
+			}
+		}
+	}
+	mutex_unlock(&sessions_mutex);
 	return 0;
 }
 
@@ -262,6 +443,7 @@ struct lttng_channel *lttng_channel_create(struct lttng_session *session,
 				       size_t subbuf_size, size_t num_subbuf,
 				       unsigned int switch_timer_interval,
 				       unsigned int read_timer_interval,
+				       size_t max_memory,
 				       enum channel_type channel_type)
 {
 	struct lttng_channel *chan;
@@ -292,7 +474,8 @@ struct lttng_channel *lttng_channel_create(struct lttng_session *session,
 	 */
 	chan->chan = transport->ops.channel_create(transport_name,
 			chan, buf_addr, subbuf_size, num_subbuf,
-			switch_timer_interval, read_timer_interval);
+			switch_timer_interval, read_timer_interval,
+			max_memory);
 	if (!chan->chan)
 		goto create_error;
 	chan->enabled = 1;
@@ -349,16 +532,19 @@ void _lttng_metadata_channel_hangup(struct lttng_metadata_stream *stream)
 
 /*
  * Supports event creation while tracing session is active.
+ * Needs to be called with sessions mutex held. Tracepoint events created by
+ * an enabler get the matching description as internal_desc.
  */
-struct lttng_event *lttng_event_create(struct lttng_channel *chan,
-				   struct lttng_kernel_event *event_param,
-				   void *filter,
-				   const struct lttng_event_desc *internal_desc)
+static
+struct lttng_event *_lttng_event_create(struct lttng_channel *chan,
+				struct lttng_kernel_event *event_param,
+				void *filter,
+				const struct lttng_event_desc *internal_desc,
+				struct lttng_enabler *enabler)
 {
 	struct lttng_event *event;
 	int ret;
 
-	mutex_lock(&sessions_mutex);
 	if (chan->free_event_id == -1U)
 		goto full;
 	/*
@@ -372,15 +558,24 @@ struct lttng_event *lttng_event_create(struct lttng_channel *chan,
 	if (!event)
 		goto cache_error;
 	event->chan = chan;
+	event->enabler = enabler;
 	event->filter = filter;
 	event->id = chan->free_event_id++;
-	event->enabled = 1;
+	event->enabled = enabler ? enabler->enabled : 1;
 	event->instrumentation = event_param->instrumentation;
+	_lttng_event_update_plan(event);
+	_lttng_event_update_armed(event);
 	/* Populate lttng_event structure before tracepoint registration. */
 	smp_wmb();
 	switch (event_param->instrumentation) {
 	case LTTNG_KERNEL_TRACEPOINT:
-		event->desc = lttng_event_get(event_param->name);
+		if (internal_desc) {
+			if (!try_module_get(internal_desc->owner))
+				goto register_error;
+			event->desc = internal_desc;
+		} else {
+			event->desc = lttng_event_get(event_param->name);
+		}
 		if (!event->desc)
 			goto register_error;
 		ret = kabi_2635_tracepoint_probe_register(event_param->name,
@@ -414,6 +609,8 @@ struct lttng_event *lttng_event_create(struct lttng_channel *chan,
 		event_return->id = chan->free_event_id++;
 		event_return->enabled = 1;
 		event_return->instrumentation = event_param->instrumentation;
+		_lttng_event_update_plan(event_return);
+		_lttng_event_update_armed(event_return);
 		/*
 		 * Populate lttng_event structure before kretprobe registration.
 		 */
@@ -464,7 +661,6 @@ struct lttng_event *lttng_event_create(struct lttng_channel *chan,
 	if (ret)
 		goto statedump_error;
 	list_add(&event->list, &chan->session->events);
-	mutex_unlock(&sessions_mutex);
 	return event;
 
 statedump_error:
@@ -474,10 +670,323 @@ register_error:
 cache_error:
 exist:
 full:
-	mutex_unlock(&sessions_mutex);
 	return NULL;
 }
 
+struct lttng_event *lttng_event_create(struct lttng_channel *chan,
+				   struct lttng_kernel_event *event_param,
+				   void *filter,
+				   const struct lttng_event_desc *internal_desc)
+{
+	struct lttng_event *event;
+
+	mutex_lock(&sessions_mutex);
+	event = _lttng_event_create(chan, event_param, filter, internal_desc,
+				    NULL);
+	mutex_unlock(&sessions_mutex);
+	return event;
+}
+
+/*
+ * Match an event name against a glob, where '*' matches any sequence of
+ * characters. Backtracks to the last star only, which is enough since a later
+ * star can match anything an earlier one would.
+ */
+static
+int lttng_match_glob(const char *pattern, const char *name)
+{
+	const char *star_p = NULL, *star_name = NULL;
+
+	for (;;) {
+		if (*pattern == '*') {
+			star_p = ++pattern;
+			star_name = name;
+			continue;
+		}
+		if (*pattern && *pattern == *name) {
+			pattern++;
+			name++;
+			continue;
+		}
+		if (!*pattern && !*name)
+			return 1;
+		if (!star_p || !*star_name)
+			return 0;
+		pattern = star_p;
+		name = ++star_name;
+	}
+}
+
+/*
+ * Link the filter of an enabler against one of its events. The events the
+ * filter cannot be linked against, e.g. lacking a field it refers to, record
+ * nothing. Returns NULL if out of memory.
+ */
+static
+struct lttng_filter *lttng_enabler_link_filter(
+		const struct lttng_kernel_filter_bytecode *bytecode,
+		const struct lttng_event_desc *desc)
+{
+	struct lttng_filter *filter;
+
+	filter = lttng_filter_create(desc, bytecode);
+	if (!IS_ERR(filter))
+		return filter;
+	if (PTR_ERR(filter) == -ENOMEM)
+		return NULL;
+	return lttng_filter_create_reject();
+}
+
+/*
+ * Create the event of an enabler for an event description, if its name
+ * matches and the session has no event of that name yet.
+ * Needs to be called with sessions mutex held.
+ */
+static
+void _lttng_enabler_create_event(struct lttng_enabler *enabler,
+				 const struct lttng_event_desc *desc)
+{
+	struct lttng_kernel_event event_param;
+	struct lttng_filter *filter = NULL;
+	struct lttng_event *event;
+
+	if (enabler->instrumentation != LTTNG_KERNEL_TRACEPOINT)
+		return;
+	if (!lttng_match_glob(enabler->name, desc->name))
+		return;
+	if (enabler->bytecode) {
+		filter = lttng_enabler_link_filter(enabler->bytecode, desc);
+		if (!filter)
+			return;
+	}
+	memset(&event_param, 0, sizeof(event_param));
+	strncpy(event_param.name, desc->name, LTTNG_KERNEL_SYM_NAME_LEN - 1);
+	event_param.instrumentation = enabler->instrumentation;
+	event = _lttng_event_create(enabler->chan, &event_param, filter, desc,
+				    enabler);
+	if (!event)
+		lttng_filter_destroy(filter);
+}
+
+/*
+ * Needs to be called with sessions mutex held.
+ */
+static
+void _lttng_enabler_sync(struct lttng_enabler *enabler)
+{
+	struct lttng_probe_desc *probe_desc;
+	int i;
+
+	lttng_lock_probes();
+	list_for_each_entry(probe_desc, lttng_get_probe_list_head(), head) {
+		for (i = 0; i < probe_desc->nr_events; i++)
+			_lttng_enabler_create_event(enabler,
+					probe_desc->event_desc[i]);
+	}
+	lttng_unlock_probes();
+}
+
+/*
+ * Give the syscall events of the channel which do not belong to an enabler
+ * yet to a syscall enabler, so that they can be filtered, enabled and
+ * disabled through it.
+ * Needs to be called with sessions mutex held.
+ */
+static
+void _lttng_enabler_claim_syscalls(struct lttng_enabler *enabler)
+{
+	struct lttng_event *event;
+
+	list_for_each_entry(event, &enabler->chan->session->events, list) {
+		if (event->chan != enabler->chan
+		    || event->instrumentation != LTTNG_KERNEL_NOOP
+		    || event->enabler)
+			continue;
+		event->enabler = enabler;
+	}
+}
+
+/*
+ * Creates the events matching the enabler for the probes registered, and
+ * those of the probes registered later on, until the session is destroyed.
+ * Tracepoint enablers match a glob. Syscall enablers, named "*", trace all
+ * the system calls, like a syscall event.
+ * Returns the enabler, or an ERR_PTR() on error.
+ */
+struct lttng_enabler *lttng_enabler_create(struct lttng_channel *chan,
+		struct lttng_kernel_event *event_param)
+{
+	struct lttng_enabler *enabler;
+	int ret;
+
+	switch (event_param->instrumentation) {
+	case LTTNG_KERNEL_TRACEPOINT:
+		break;
+	case LTTNG_KERNEL_SYSCALL:
+		if (strcmp(event_param->name, "*"))
+			return ERR_PTR(-EINVAL);
+		break;
+	default:
+		return ERR_PTR(-EINVAL);
+	}
+	enabler = kzalloc(sizeof(struct lttng_enabler), GFP_KERNEL);
+	if (!enabler)
+		return ERR_PTR(-ENOMEM);
+	strncpy(enabler->name, event_param->name,
+		LTTNG_KERNEL_SYM_NAME_LEN - 1);
+	enabler->instrumentation = event_param->instrumentation;
+	enabler->chan = chan;
+	enabler->enabled = 1;
+	if (enabler->instrumentation == LTTNG_KERNEL_SYSCALL) {
+		/* Creates the events, taking the sessions mutex. */
+		ret = lttng_syscalls_register(chan);
+		if (ret) {
+			kfree(enabler);
+			return ERR_PTR(ret);
+		}
+	}
+	mutex_lock(&sessions_mutex);
+	list_add(&enabler->node, &chan->session->enablers);
+	if (enabler->instrumentation == LTTNG_KERNEL_SYSCALL)
+		_lttng_enabler_claim_syscalls(enabler);
+	else
+		_lttng_enabler_sync(enabler);
+	mutex_unlock(&sessions_mutex);
+	return enabler;
+}
+
+/*
+ * Called when a probe is registered, to create the events of the enablers
+ * matching its event descriptions.
+ */
+void lttng_enablers_probe_register(struct lttng_probe_desc *desc)
+{
+	struct lttng_session *session;
+	struct lttng_enabler *enabler;
+	int i;
+
+	mutex_lock(&sessions_mutex);
+	list_for_each_entry(session, &sessions, list) {
+		list_for_each_entry(enabler, &session->enablers, node) {
+			for (i = 0; i < desc->nr_events; i++)
+				_lttng_enabler_create_event(enabler,
+						desc->event_desc[i]);
+		}
+	}
+	mutex_unlock(&sessions_mutex);
+}
+
+static
+int lttng_enabler_set_enabled(struct lttng_enabler *enabler, int enabled)
+{
+	struct lttng_event *event;
+	int ret = 0;
+
+	mutex_lock(&sessions_mutex);
+	if (enabler->enabled == enabled) {
+		ret = -EEXIST;
+		goto end;
+	}
+	enabler->enabled = enabled;
+	list_for_each_entry(event, &enabler->chan->session->events, list) {
+		if (event->enabler != enabler)
+			continue;
+		ACCESS_ONCE(event->enabled) = enabled;
+		_lttng_event_update_armed(event);
+	}
+end:
+	mutex_unlock(&sessions_mutex);
+	return ret;
+}
+
+int lttng_enabler_enable(struct lttng_enabler *enabler)
+{
+	return lttng_enabler_set_enabled(enabler, 1);
+}
+
+int lttng_enabler_disable(struct lttng_enabler *enabler)
+{
+	return lttng_enabler_set_enabled(enabler, 0);
+}
+
+/*
+ * Replace the filter of the enabler and of the events it created. The new
+ * filters are all linked before any is published, so that the events switch
+ * filters together, or not at all if out of memory.
+ */
+int lttng_enabler_attach_filter(struct lttng_enabler *enabler,
+		const struct lttng_kernel_filter_bytecode *bytecode)
+{
+	struct lttng_kernel_filter_bytecode *copy, *old_bytecode;
+	struct lttng_filter **filters, *old;
+	struct lttng_event *event;
+	int nr = 0, i = 0, ret = 0;
+
+	copy = kmemdup(bytecode, sizeof(*bytecode) + bytecode->len,
+		       GFP_KERNEL);
+	if (!copy)
+		return -ENOMEM;
+	mutex_lock(&sessions_mutex);
+	list_for_each_entry(event, &enabler->chan->session->events, list) {
+		if (event->enabler == enabler)
+			nr++;
+	}
+	filters = kcalloc(nr, sizeof(*filters), GFP_KERNEL);
+	if (!filters) {
+		ret = -ENOMEM;
+		goto end;
+	}
+	list_for_each_entry(event, &enabler->chan->session->events, list) {
+		if (event->enabler != enabler)
+			continue;
+		filters[i] = lttng_enabler_link_filter(copy, event->desc);
+		if (!filters[i]) {
+			ret = -ENOMEM;
+			goto link_error;
+		}
+		i++;
+	}
+	i = 0;
+	list_for_each_entry(event, &enabler->chan->session->events, list) {
+		if (event->enabler != enabler)
+			continue;
+		old = event->filter;
+		rcu_assign_pointer(event->filter, filters[i]);
+		filters[i++] = old;
+	}
+	old_bytecode = enabler->bytecode;
+	enabler->bytecode = copy;
+	copy = old_bytecode;
+	mutex_unlock(&sessions_mutex);
+	synchronize_trace();	/* Wait for in-flight events to complete */
+	for (i = 0; i < nr; i++)
+		lttng_filter_destroy(filters[i]);
+	kfree(filters);
+	kfree(copy);
+	return 0;
+
+link_error:
+	while (i-- > 0)
+		lttng_filter_destroy(filters[i]);
+	kfree(filters);
+end:
+	mutex_unlock(&sessions_mutex);
+	kfree(copy);
+	return ret;
+}
+
+/*
+ * Only used internally at session destruction, once its events are
+ * destroyed.
+ */
+static
+void _lttng_enabler_destroy(struct lttng_enabler *enabler)
+{
+	list_del(&enabler->node);
+	kfree(enabler->bytecode);
+	kfree(enabler);
+}
+
 /*
  * Only used internally at session destruction.
  */
@@ -543,6 +1052,7 @@ void _lttng_event_destroy(struct lttng_event *event)
 	}
 	list_del(&event->list);
 	lttng_destroy_context(event->ctx);
+	lttng_filter_destroy(event->filter);
 	kmem_cache_free(event_cache, event);
 }
 
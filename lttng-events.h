@@ -150,12 +150,43 @@ struct lttng_perf_counter_field {
 	struct perf_event **e;	/* per-cpu array */
 };
 
+/*
+ * Gather descriptor of a fixed-size context field. When all the fields of a
+ * context have one, the client fetches their values into a single blob
+ * written to the buffer at once, rather than calling each record callback.
+ * The values of the common current task fields are fetched inline by the
+ * client, the others through the gather callback.
+ */
+enum lttng_ctx_gather_type {
+	LTTNG_CTX_GATHER_NONE = 0,	/* Only recorded by the record callback */
+	LTTNG_CTX_GATHER_CALLBACK,
+	LTTNG_CTX_GATHER_PID,
+	LTTNG_CTX_GATHER_TID,
+	LTTNG_CTX_GATHER_VPID,
+	LTTNG_CTX_GATHER_VTID,
+	LTTNG_CTX_GATHER_NICE,
+	LTTNG_CTX_GATHER_PROCNAME,
+};
+
+/* Maximum size of the gathered context blob, on the tracing stack. */
+#define LTTNG_CTX_GATHER_MAX		128
+
+struct lttng_ctx_gather {
+	enum lttng_ctx_gather_type type;
+	unsigned short size;		/* in bytes */
+	unsigned short alignment;	/* in bytes */
+	/* Store the value at dst (unaligned), for LTTNG_CTX_GATHER_CALLBACK */
+	void (*get)(struct lttng_ctx_field *field,
+		    struct lib_ring_buffer_ctx *ctx, void *dst);
+};
+
 struct lttng_ctx_field {
 	struct lttng_event_field event_field;
 	size_t (*get_size)(size_t offset);
 	void (*record)(struct lttng_ctx_field *field,
 		       struct lib_ring_buffer_ctx *ctx,
 		       struct lttng_channel *chan);
+	struct lttng_ctx_gather gather;
 	union {
 		struct lttng_perf_counter_field *perf_counter;
 	} u;
@@ -166,6 +197,8 @@ struct lttng_ctx {
 	struct lttng_ctx_field *fields;
 	unsigned int nr_fields;
 	unsigned int allocated_fields;
+	/* Gathered blob size bound, 0 if not gathered. See lttng_context_update */
+	size_t gather_size;
 };
 
 struct lttng_event_desc {
@@ -184,6 +217,23 @@ struct lttng_probe_desc {
 };
 
 struct lttng_krp;				/* Kretprobe handling */
+struct lttng_filter;				/* Filter, see lttng-filter.h */
+struct lttng_enabler;
+
+/*
+ * Event header and context size plan, indexed by the reservation offset
+ * modulo LTTNG_HEADER_PLAN_ALIGN, which is a multiple of the alignment of
+ * every field of the header and of fixed-size contexts. size[0] is the plan
+ * of the compact/large header, size[1] the one of the extended header.
+ * Only used when valid is set.
+ */
+#define LTTNG_HEADER_PLAN_ALIGN		8
+
+struct lttng_header_plan {
+	unsigned char size[2][LTTNG_HEADER_PLAN_ALIGN];
+	unsigned char padding[LTTNG_HEADER_PLAN_ALIGN];
+	int valid;
+};
 
 /*
  * lttng_event structure is referred to by the tracing fast path. It must be
@@ -193,9 +243,16 @@ struct lttng_event {
 	unsigned int id;
 	struct lttng_channel *chan;
 	int enabled;
+	/*
+	 * Session active, channel and event enabled: the only state tested
+	 * by the probes. Updated under the sessions mutex.
+	 */
+	int armed;
 	const struct lttng_event_desc *desc;
-	void *filter;
+	struct lttng_enabler *enabler;		/* Creator, NULL if none */
+	struct lttng_filter *filter;		/* RCU sched, NULL if none */
 	struct lttng_ctx *ctx;
+	struct lttng_header_plan header_plan;
 	enum lttng_kernel_instrumentation instrumentation;
 	union {
 		struct {
@@ -220,7 +277,8 @@ struct lttng_channel_ops {
 				void *buf_addr,
 				size_t subbuf_size, size_t num_subbuf,
 				unsigned int switch_timer_interval,
-				unsigned int read_timer_interval);
+				unsigned int read_timer_interval,
+				size_t max_memory);
 	void (*channel_destroy)(struct channel *chan);
 	struct lib_ring_buffer *(*buffer_read_open)(struct channel *chan);
 	int (*buffer_has_read_closed_stream)(struct channel *chan);
@@ -228,6 +286,12 @@ struct lttng_channel_ops {
 	int (*event_reserve)(struct lib_ring_buffer_ctx *ctx,
 			     uint32_t event_id);
 	void (*event_commit)(struct lib_ring_buffer_ctx *ctx);
+	/*
+	 * Precompute the header size plan of an event, once the channel
+	 * header type and contexts are known. Optional: NULL for
+	 * transports that do not support it (e.g. metadata).
+	 */
+	void (*event_update_plan)(struct lttng_event *event);
 	void (*event_write)(struct lib_ring_buffer_ctx *ctx, const void *src,
 			    size_t len);
 	void (*event_write_from_user)(struct lib_ring_buffer_ctx *ctx,
@@ -253,6 +317,20 @@ struct lttng_transport {
 	struct lttng_channel_ops ops;
 };
 
+/*
+ * Creates the events of a channel whose name matches a glob, where '*'
+ * matches any sequence of characters. Matched against the probes registered
+ * when created, and against each probe registered afterwards.
+ */
+struct lttng_enabler {
+	char name[LTTNG_KERNEL_SYM_NAME_LEN];	/* Glob on the event names */
+	enum lttng_kernel_instrumentation instrumentation;
+	struct lttng_channel *chan;
+	int enabled;			/* Enable state of its events */
+	struct lttng_kernel_filter_bytecode *bytecode;	/* NULL if none */
+	struct list_head node;		/* Session enabler list */
+};
+
 struct lttng_channel {
 	unsigned int id;
 	struct channel *chan;		/* Channel buffers */
@@ -291,6 +369,7 @@ struct lttng_session {
 	struct file *file;		/* File associated to session */
 	struct list_head chan;		/* Channel list head */
 	struct list_head events;	/* Event list head */
+	struct list_head enablers;	/* Enabler list head */
 	struct list_head list;		/* Session list */
 	unsigned int free_chan_id;	/* Next chan ID to allocate */
 	uuid_le uuid;			/* Trace session unique ID */
@@ -318,6 +397,7 @@ struct lttng_channel *lttng_channel_create(struct lttng_session *session,
 				       size_t subbuf_size, size_t num_subbuf,
 				       unsigned int switch_timer_interval,
 				       unsigned int read_timer_interval,
+				       size_t max_memory,
 				       enum channel_type channel_type);
 struct lttng_channel *lttng_global_channel_create(struct lttng_session *session,
 				       int overwrite, void *buf_addr,
@@ -339,6 +419,19 @@ int lttng_channel_enable(struct lttng_channel *channel);
 int lttng_channel_disable(struct lttng_channel *channel);
 int lttng_event_enable(struct lttng_event *event);
 int lttng_event_disable(struct lttng_event *event);
+int lttng_event_attach_filter(struct lttng_event *event,
+		const struct lttng_kernel_filter_bytecode *bytecode);
+
+struct lttng_enabler *lttng_enabler_create(struct lttng_channel *chan,
+		struct lttng_kernel_event *event_param);
+int lttng_enabler_enable(struct lttng_enabler *enabler);
+int lttng_enabler_disable(struct lttng_enabler *enabler);
+int lttng_enabler_attach_filter(struct lttng_enabler *enabler,
+		const struct lttng_kernel_filter_bytecode *bytecode);
+void lttng_enablers_probe_register(struct lttng_probe_desc *desc);
+
+struct seq_file;
+int lttng_session_list_stats(struct seq_file *m);
 
 void lttng_transport_register(struct lttng_transport *transport);
 void lttng_transport_unregister(struct lttng_transport *transport);
@@ -351,6 +444,9 @@ void lttng_abi_compat_old_exit(void);
 
 int lttng_probe_register(struct lttng_probe_desc *desc);
 void lttng_probe_unregister(struct lttng_probe_desc *desc);
+void lttng_lock_probes(void);
+void lttng_unlock_probes(void);
+struct list_head *lttng_get_probe_list_head(void);
 const struct lttng_event_desc *lttng_event_get(const char *name);
 void lttng_event_put(const struct lttng_event_desc *desc);
 int lttng_probes_init(void);
@@ -360,10 +456,10 @@ int lttng_metadata_output_channel(struct lttng_channel *chan,
 		struct lttng_metadata_stream *stream);
 
 #if defined(CONFIG_HAVE_SYSCALL_TRACEPOINTS)
-int lttng_syscalls_register(struct lttng_channel *chan, void *filter);
+int lttng_syscalls_register(struct lttng_channel *chan);
 int lttng_syscalls_unregister(struct lttng_channel *chan);
 #else
-static inline int lttng_syscalls_register(struct lttng_channel *chan, void *filter)
+static inline int lttng_syscalls_register(struct lttng_channel *chan)
 {
 	return -ENOSYS;
 }
@@ -378,6 +474,7 @@ struct lttng_ctx_field *lttng_append_context(struct lttng_ctx **ctx);
 int lttng_find_context(struct lttng_ctx *ctx, const char *name);
 void lttng_remove_context_field(struct lttng_ctx **ctx,
 				struct lttng_ctx_field *field);
+void lttng_context_update(struct lttng_ctx *ctx);
 void lttng_destroy_context(struct lttng_ctx *ctx);
 int lttng_add_pid_to_ctx(struct lttng_ctx **ctx);
 int lttng_add_procname_to_ctx(struct lttng_ctx **ctx);
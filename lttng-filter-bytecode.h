@@ -0,0 +1,127 @@
+#ifndef _LTTNG_FILTER_BYTECODE_H
+#define _LTTNG_FILTER_BYTECODE_H
+
+/*
+ * lttng-filter-bytecode.h
+ *
+ * LTTng filter bytecode format.
+ *
+ * The bytecode is a sequence of instructions working on a value stack,
+ * followed by a relocation table. Each relocation entry names the field (or
+ * "$ctx." prefixed context) loaded by a FILTER_OP_LOAD_FIELD_REF instruction:
+ *
+ *   uint16_t insn_offset;	offset of the instruction in the bytecode
+ *   char name[];		\0-terminated field or context name
+ *
+ * The tracer resolves the names against the event description, and replaces
+ * the generic instructions with typed ones when linking. Multi-byte operands
+ * are in host byte order, and unaligned.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/types.h>
+
+/* Context names start with this prefix in the relocation table. */
+#define FILTER_CONTEXT_PREFIX		"$ctx."
+
+typedef uint8_t filter_opcode_t;
+
+enum filter_op {
+	FILTER_OP_UNKNOWN = 0,
+
+	FILTER_OP_RETURN = 1,
+
+	/* Binary comparators: pop 2 values, push 0 or 1 */
+	FILTER_OP_EQ = 2,
+	FILTER_OP_NE = 3,
+	FILTER_OP_GT = 4,
+	FILTER_OP_LT = 5,
+	FILTER_OP_GE = 6,
+	FILTER_OP_LE = 7,
+
+	/* Unary: logical not of the top of stack */
+	FILTER_OP_NOT = 8,
+
+	/*
+	 * Logical operators, with short-circuit: keep the top of stack and
+	 * jump to skip_offset if it decides the result, else pop it.
+	 */
+	FILTER_OP_AND = 9,
+	FILTER_OP_OR = 10,
+
+	/* Loads */
+	FILTER_OP_LOAD_FIELD_REF = 11,	/* Named by a relocation */
+	FILTER_OP_LOAD_STRING = 12,	/* '*' glob, '\' escape for EQ/NE */
+	FILTER_OP_LOAD_S64 = 13,
+
+	NR_FILTER_USER_OPS,
+
+	/*
+	 * Typed instructions, only produced by the tracer when linking. They
+	 * are rejected in the bytecode received.
+	 */
+	FILTER_OP_EQ_S64 = NR_FILTER_USER_OPS,
+	FILTER_OP_NE_S64,
+	FILTER_OP_GT_S64,
+	FILTER_OP_LT_S64,
+	FILTER_OP_GE_S64,
+	FILTER_OP_LE_S64,
+
+	FILTER_OP_EQ_STRING,
+	FILTER_OP_NE_STRING,
+	FILTER_OP_GT_STRING,
+	FILTER_OP_LT_STRING,
+	FILTER_OP_GE_STRING,
+	FILTER_OP_LE_STRING,
+
+	FILTER_OP_LOAD_FIELD_REF_S64,
+	FILTER_OP_LOAD_FIELD_REF_STRING,
+	FILTER_OP_LOAD_CONTEXT_REF_S64,
+	FILTER_OP_LOAD_CONTEXT_REF_STRING,
+
+	NR_FILTER_OPS,
+};
+
+struct field_ref {
+	/* Field index, or context id, once linked */
+	uint16_t offset;
+} __attribute__((packed));
+
+struct load_op {
+	filter_opcode_t op;
+	char data[0];	/* struct field_ref, \0-terminated string or int64_t */
+} __attribute__((packed));
+
+struct binary_op {
+	filter_opcode_t op;
+} __attribute__((packed));
+
+struct unary_op {
+	filter_opcode_t op;
+} __attribute__((packed));
+
+struct logical_op {
+	filter_opcode_t op;
+	uint16_t skip_offset;	/* Bytecode offset of the jump target */
+} __attribute__((packed));
+
+struct return_op {
+	filter_opcode_t op;
+} __attribute__((packed));
+
+#endif /* _LTTNG_FILTER_BYTECODE_H */
@@ -0,0 +1,325 @@
+/*
+ * lttng-filter-interpreter.c
+ *
+ * LTTng in-kernel event filter interpreter.
+ *
+ * Runs in probe context: it must not sleep nor take page faults. The linked
+ * code has been validated by lttng_filter_create(), so the interpreter does
+ * not check the stack depth nor the operand types.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/rcupdate.h>
+#include <linux/uaccess.h>
+#include <asm/unaligned.h>
+#include "lttng-filter.h"
+
+struct filter_reg {
+	int64_t v;
+	const char *str;
+	size_t len;			/* Text length bound */
+	unsigned int user:1,		/* Text in user space */
+		literal:1;		/* Pattern from the bytecode */
+};
+
+/*
+ * Character at pos in a text value, or \0 past its end. A user text ends at
+ * the first fault.
+ */
+static
+int filter_get_char(const struct filter_reg *reg, size_t pos)
+{
+	char c;
+
+	if (pos >= reg->len || !reg->str)
+		return '\0';
+	if (!reg->user)
+		return (unsigned char) reg->str[pos];
+	if (__copy_from_user_inatomic(&c,
+			(__force const char __user *) &reg->str[pos],
+			sizeof(c)))
+		return '\0';
+	return (unsigned char) c;
+}
+
+static
+int filter_strcmp(const struct filter_reg *a, const struct filter_reg *b)
+{
+	size_t pos;
+	int ca, cb;
+
+	for (pos = 0;; pos++) {
+		ca = filter_get_char(a, pos);
+		cb = filter_get_char(b, pos);
+		if (ca != cb)
+			return ca - cb;
+		if (!ca)
+			return 0;
+	}
+}
+
+/*
+ * Match text against a pattern, where '*' matches any sequence of characters
+ * and '\' escapes the next character. Backtracks to the last star only, which
+ * is enough since a later star can match anything an earlier one would.
+ */
+static
+int filter_glob_match(const char *pattern, const struct filter_reg *text)
+{
+	const char *p = pattern, *star_p = NULL;
+	size_t pos = 0, star_pos = 0;
+	int c, pc, pc_len;
+
+	for (;;) {
+		if (*p == '*') {
+			star_p = ++p;
+			star_pos = pos;
+			continue;
+		}
+		if (*p == '\\' && p[1]) {
+			pc = (unsigned char) p[1];
+			pc_len = 2;
+		} else {
+			pc = (unsigned char) *p;
+			pc_len = 1;
+		}
+		c = filter_get_char(text, pos);
+		if (pc && pc == c) {
+			p += pc_len;
+			pos++;
+			continue;
+		}
+		if (!pc && !c)
+			return 1;
+		if (!star_p || !c)
+			return 0;
+		p = star_p;
+		pos = ++star_pos;
+	}
+}
+
+static
+int filter_string_eq(const struct filter_reg *a, const struct filter_reg *b)
+{
+	if (a->literal && !b->literal)
+		return filter_glob_match(a->str, b);
+	if (b->literal && !a->literal)
+		return filter_glob_match(b->str, a);
+	return !filter_strcmp(a, b);
+}
+
+/*
+ * Compare two text values. Ordering comparisons are byte-wise, patterns are
+ * only used by equality.
+ */
+static
+int filter_string_compare(filter_opcode_t op, const struct filter_reg *a,
+			  const struct filter_reg *b)
+{
+	mm_segment_t old_fs = get_fs();
+	int user = a->user || b->user;
+	int ret;
+
+	if (user) {
+		set_fs(KERNEL_DS);
+		pagefault_disable();
+	}
+	switch (op) {
+	case FILTER_OP_EQ_STRING:
+		ret = filter_string_eq(a, b);
+		break;
+	case FILTER_OP_NE_STRING:
+		ret = !filter_string_eq(a, b);
+		break;
+	case FILTER_OP_GT_STRING:
+		ret = filter_strcmp(a, b) > 0;
+		break;
+	case FILTER_OP_LT_STRING:
+		ret = filter_strcmp(a, b) < 0;
+		break;
+	case FILTER_OP_GE_STRING:
+		ret = filter_strcmp(a, b) >= 0;
+		break;
+	case FILTER_OP_LE_STRING:
+	default:
+		ret = filter_strcmp(a, b) <= 0;
+		break;
+	}
+	if (user) {
+		pagefault_enable();
+		set_fs(old_fs);
+	}
+	return ret;
+}
+
+int64_t lttng_filter_context_s64(unsigned int ctx)
+{
+	pid_t ppid;
+
+	switch (ctx) {
+	case FILTER_CTX_PID:
+		return task_tgid_nr(current);
+	case FILTER_CTX_TID:
+		return task_pid_nr(current);
+	case FILTER_CTX_VPID:
+		/* nsproxy can be NULL when scheduled out of exit. */
+		if (!current->nsproxy)
+			return 0;
+		return task_tgid_vnr(current);
+	case FILTER_CTX_VTID:
+		if (!current->nsproxy)
+			return 0;
+		return task_pid_vnr(current);
+	case FILTER_CTX_PPID:
+		rcu_read_lock();
+		ppid = task_tgid_nr(current->real_parent);
+		rcu_read_unlock();
+		return ppid;
+	case FILTER_CTX_NICE:
+		return task_nice(current);
+	default:
+		return 0;
+	}
+}
+
+static inline
+unsigned int filter_ref(const char *pc)
+{
+	const struct field_ref *ref =
+		(const struct field_ref *) ((const struct load_op *) pc)->data;
+
+	return get_unaligned(&ref->offset);
+}
+
+/**
+ * lttng_filter_interpret - run a filter on the fields of an event
+ * @filter: linked filter
+ * @fields: values of the fields selected by the filter field mask
+ *
+ * Returns nonzero if the event is recorded.
+ */
+int lttng_filter_interpret(const struct lttng_filter *filter,
+		const struct lttng_filter_field_value *fields)
+{
+	struct filter_reg stack[FILTER_STACK_MAX];
+	const char *pc = filter->code;
+	const struct lttng_filter_field_value *field;
+	int sp = -1;
+
+	for (;;) {
+		switch (*(const filter_opcode_t *) pc) {
+		case FILTER_OP_RETURN:
+			return stack[sp].v != 0;
+
+		case FILTER_OP_EQ_S64:
+			stack[sp - 1].v = stack[sp - 1].v == stack[sp].v;
+			goto binary_op;
+		case FILTER_OP_NE_S64:
+			stack[sp - 1].v = stack[sp - 1].v != stack[sp].v;
+			goto binary_op;
+		case FILTER_OP_GT_S64:
+			stack[sp - 1].v = stack[sp - 1].v > stack[sp].v;
+			goto binary_op;
+		case FILTER_OP_LT_S64:
+			stack[sp - 1].v = stack[sp - 1].v < stack[sp].v;
+			goto binary_op;
+		case FILTER_OP_GE_S64:
+			stack[sp - 1].v = stack[sp - 1].v >= stack[sp].v;
+			goto binary_op;
+		case FILTER_OP_LE_S64:
+			stack[sp - 1].v = stack[sp - 1].v <= stack[sp].v;
+			goto binary_op;
+		case FILTER_OP_EQ_STRING ... FILTER_OP_LE_STRING:
+			stack[sp - 1].v = filter_string_compare(
+				*(const filter_opcode_t *) pc,
+				&stack[sp - 1], &stack[sp]);
+		binary_op:
+			sp--;
+			pc += sizeof(struct binary_op);
+			break;
+
+		case FILTER_OP_NOT:
+			stack[sp].v = !stack[sp].v;
+			pc += sizeof(struct unary_op);
+			break;
+
+		case FILTER_OP_AND:
+			if (!stack[sp].v)
+				goto logical_jump;
+			sp--;
+			pc += sizeof(struct logical_op);
+			break;
+		case FILTER_OP_OR:
+			if (stack[sp].v)
+				goto logical_jump;
+			sp--;
+			pc += sizeof(struct logical_op);
+			break;
+		logical_jump:
+			pc = filter->code + get_unaligned(
+				&((const struct logical_op *) pc)->skip_offset);
+			break;
+
+		case FILTER_OP_LOAD_FIELD_REF_S64:
+			stack[++sp].v = fields[filter_ref(pc)].u.v;
+			goto ref_op;
+		case FILTER_OP_LOAD_FIELD_REF_STRING:
+			field = &fields[filter_ref(pc)];
+			sp++;
+			stack[sp].str = field->u.s.p;
+			stack[sp].len = field->u.s.len;
+			stack[sp].user = field->user;
+			stack[sp].literal = 0;
+			goto ref_op;
+		case FILTER_OP_LOAD_CONTEXT_REF_S64:
+			stack[++sp].v =
+				lttng_filter_context_s64(filter_ref(pc));
+			goto ref_op;
+		case FILTER_OP_LOAD_CONTEXT_REF_STRING:
+			sp++;
+			stack[sp].str = current->comm;
+			stack[sp].len = sizeof(current->comm);
+			stack[sp].user = 0;
+			stack[sp].literal = 0;
+		ref_op:
+			pc += sizeof(struct load_op) + sizeof(struct field_ref);
+			break;
+
+		case FILTER_OP_LOAD_STRING:
+			sp++;
+			stack[sp].str = ((const struct load_op *) pc)->data;
+			stack[sp].len = SIZE_MAX;
+			stack[sp].user = 0;
+			stack[sp].literal = 1;
+			pc += sizeof(struct load_op) + strlen(stack[sp].str) + 1;
+			break;
+		case FILTER_OP_LOAD_S64:
+			stack[++sp].v = get_unaligned((const int64_t *)
+				((const struct load_op *) pc)->data);
+			pc += sizeof(struct load_op) + sizeof(int64_t);
+			break;
+
+		default:
+			/* Rejected by the validation. */
+			WARN_ON_ONCE(1);
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,382 @@
+/*
+ * lttng-filter-specialize.c
+ *
+ * LTTng in-kernel event filters: native functions for the common filters.
+ *
+ * Most filters compare a single field or context with constants. Rather than
+ * interpreting them, the filter is bound to a function testing the value
+ * directly, with the constants as parameters:
+ *
+ *   field == C, field != C, field > C, ...	integer field range
+ *   field >= A && field <= B			integer field range
+ *   x == A || x == B || ...			set membership of an integer field,
+ *						or of a context (pid, tid, ...)
+ *   $ctx.procname == "name", "prefix*"		process name match
+ *
+ * The other filters keep the interpreter.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <asm/unaligned.h>
+#include "lttng-filter.h"
+
+/*
+ * Comparison of a field or context with a constant, as compiled: two loads
+ * and a comparison.
+ */
+struct filter_term {
+	filter_opcode_t ref_op;		/* Typed load of the field or context */
+	unsigned int ref;		/* Field rank or context id */
+	filter_opcode_t cmp_op;		/* Comparison, reference on the left */
+	int64_t v;
+	const char *str;
+};
+
+static
+int filter_field_range(const struct lttng_filter *filter,
+		       const struct lttng_filter_field_value *fields)
+{
+	int64_t v = fields[0].u.v;
+
+	return (v >= filter->u.range.min && v <= filter->u.range.max)
+		^ filter->u.range.negate;
+}
+
+static inline
+int filter_set_match(const struct lttng_filter *filter, int64_t v)
+{
+	unsigned int i;
+
+	for (i = 0; i < filter->u.set.nr; i++)
+		if (v == filter->u.set.values[i])
+			return 1;
+	return 0;
+}
+
+static
+int filter_field_set(const struct lttng_filter *filter,
+		     const struct lttng_filter_field_value *fields)
+{
+	return filter_set_match(filter, fields[0].u.v);
+}
+
+static
+int filter_pid_set(const struct lttng_filter *filter,
+		   const struct lttng_filter_field_value *fields)
+{
+	return filter_set_match(filter, task_tgid_nr(current));
+}
+
+static
+int filter_tid_set(const struct lttng_filter *filter,
+		   const struct lttng_filter_field_value *fields)
+{
+	return filter_set_match(filter, task_pid_nr(current));
+}
+
+static
+int filter_context_set(const struct lttng_filter *filter,
+		       const struct lttng_filter_field_value *fields)
+{
+	return filter_set_match(filter,
+			lttng_filter_context_s64(filter->u.set.ctx));
+}
+
+static
+int filter_procname(const struct lttng_filter *filter,
+		    const struct lttng_filter_field_value *fields)
+{
+	return !memcmp(current->comm, filter->u.procname.name,
+		       filter->u.procname.len);
+}
+
+/* Comparison with swapped operands: C < x is x > C. */
+static
+filter_opcode_t filter_mirror_op(filter_opcode_t op)
+{
+	switch (op) {
+	case FILTER_OP_GT_S64:
+		return FILTER_OP_LT_S64;
+	case FILTER_OP_LT_S64:
+		return FILTER_OP_GT_S64;
+	case FILTER_OP_GE_S64:
+		return FILTER_OP_LE_S64;
+	case FILTER_OP_LE_S64:
+		return FILTER_OP_GE_S64;
+	case FILTER_OP_EQ_S64:
+	case FILTER_OP_NE_S64:
+	case FILTER_OP_EQ_STRING:
+	case FILTER_OP_NE_STRING:
+		return op;
+	default:
+		return FILTER_OP_UNKNOWN;
+	}
+}
+
+/*
+ * Parse the term at pc. Returns the next instruction, or NULL if the code
+ * at pc is not a term.
+ */
+static
+const char *filter_parse_term(const char *pc, struct filter_term *term)
+{
+	int i, ref = -1;
+
+	for (i = 0; i < 2; i++) {
+		const struct load_op *insn = (const struct load_op *) pc;
+
+		switch (insn->op) {
+		case FILTER_OP_LOAD_FIELD_REF_S64 ...
+				FILTER_OP_LOAD_CONTEXT_REF_STRING:
+			if (ref >= 0)
+				return NULL;
+			ref = i;
+			term->ref_op = insn->op;
+			term->ref = get_unaligned(
+				&((const struct field_ref *) insn->data)->offset);
+			pc += sizeof(struct load_op) + sizeof(struct field_ref);
+			break;
+		case FILTER_OP_LOAD_S64:
+			term->v = get_unaligned((const int64_t *) insn->data);
+			pc += sizeof(struct load_op) + sizeof(int64_t);
+			break;
+		case FILTER_OP_LOAD_STRING:
+			term->str = insn->data;
+			pc += sizeof(struct load_op) + strlen(insn->data) + 1;
+			break;
+		default:
+			return NULL;
+		}
+	}
+	if (ref < 0)
+		return NULL;
+	term->cmp_op = *(const filter_opcode_t *) pc;
+	if (ref == 1)
+		term->cmp_op = filter_mirror_op(term->cmp_op);
+	if (term->cmp_op < FILTER_OP_EQ_S64
+	    || term->cmp_op > FILTER_OP_LE_STRING)
+		return NULL;
+	return pc + sizeof(struct binary_op);
+}
+
+/*
+ * Parse a filter made of terms joined by a single kind of logical operator,
+ * each jumping to another one of its kind or to the final return. Such a
+ * filter is the conjunction, or the disjunction, of its terms. Returns the
+ * number of terms, or -1 for other filters.
+ */
+static
+int filter_parse(const struct lttng_filter *filter, struct filter_term *terms,
+		 filter_opcode_t *logical)
+{
+	const char *pc = filter->code;
+	const char *ret_pc = filter->code + filter->len
+		- sizeof(struct return_op);
+	const struct logical_op *insn;
+	const char *target;
+	int nr = 0;
+
+	*logical = FILTER_OP_UNKNOWN;
+	for (;;) {
+		if (nr == LTTNG_FILTER_SET_MAX)
+			return -1;
+		pc = filter_parse_term(pc, &terms[nr++]);
+		if (!pc)
+			return -1;
+		if (pc == ret_pc)
+			break;
+		insn = (const struct logical_op *) pc;
+		if (insn->op != FILTER_OP_AND && insn->op != FILTER_OP_OR)
+			return -1;
+		if (*logical != FILTER_OP_UNKNOWN && insn->op != *logical)
+			return -1;
+		*logical = insn->op;
+		target = filter->code + get_unaligned(&insn->skip_offset);
+		if (target != ret_pc && *target != insn->op)
+			return -1;
+		pc += sizeof(struct logical_op);
+	}
+	if (*ret_pc != FILTER_OP_RETURN)
+		return -1;
+	return nr;
+}
+
+/*
+ * Values satisfying an integer term, as an inclusive range. Returns 0 if the
+ * term is not a bound.
+ */
+static
+int filter_term_bounds(const struct filter_term *term,
+		       int64_t *min, int64_t *max)
+{
+	*min = LLONG_MIN;
+	*max = LLONG_MAX;
+	switch (term->cmp_op) {
+	case FILTER_OP_EQ_S64:
+		*min = *max = term->v;
+		break;
+	case FILTER_OP_GT_S64:
+		if (term->v == LLONG_MAX)
+			return 0;
+		*min = term->v + 1;
+		break;
+	case FILTER_OP_LT_S64:
+		if (term->v == LLONG_MIN)
+			return 0;
+		*max = term->v - 1;
+		break;
+	case FILTER_OP_GE_S64:
+		*min = term->v;
+		break;
+	case FILTER_OP_LE_S64:
+		*max = term->v;
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static
+void filter_specialize_range(struct lttng_filter *filter,
+			     const struct filter_term *terms, int nr)
+{
+	int64_t min, max, term_min, term_max;
+	int i;
+
+	if (nr == 1 && terms[0].cmp_op == FILTER_OP_NE_S64) {
+		filter->u.range.min = filter->u.range.max = terms[0].v;
+		filter->u.range.negate = 1;
+		filter->filter = filter_field_range;
+		return;
+	}
+	min = LLONG_MIN;
+	max = LLONG_MAX;
+	for (i = 0; i < nr; i++) {
+		if (terms[i].ref != terms[0].ref)
+			return;
+		if (!filter_term_bounds(&terms[i], &term_min, &term_max))
+			return;
+		min = max_t(int64_t, min, term_min);
+		max = min_t(int64_t, max, term_max);
+	}
+	filter->u.range.min = min;
+	filter->u.range.max = max;
+	filter->u.range.negate = 0;
+	filter->filter = filter_field_range;
+}
+
+static
+void filter_specialize_set(struct lttng_filter *filter,
+			   const struct filter_term *terms, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (terms[i].cmp_op != FILTER_OP_EQ_S64
+		    || terms[i].ref != terms[0].ref)
+			return;
+		filter->u.set.values[i] = terms[i].v;
+	}
+	filter->u.set.nr = nr;
+	if (terms[0].ref_op == FILTER_OP_LOAD_FIELD_REF_S64) {
+		filter->filter = filter_field_set;
+		return;
+	}
+	filter->u.set.ctx = terms[0].ref;
+	switch (terms[0].ref) {
+	case FILTER_CTX_PID:
+		filter->filter = filter_pid_set;
+		break;
+	case FILTER_CTX_TID:
+		filter->filter = filter_tid_set;
+		break;
+	default:
+		filter->filter = filter_context_set;
+		break;
+	}
+}
+
+/*
+ * Process names are matched by comparing their first bytes: the name with
+ * its final \0, or the prefix before a final star.
+ */
+static
+void filter_specialize_procname(struct lttng_filter *filter,
+				const struct filter_term *term)
+{
+	size_t len = strlen(term->str);
+
+	if (term->cmp_op != FILTER_OP_EQ_STRING || strchr(term->str, '\\'))
+		return;
+	if (len && term->str[len - 1] == '*')
+		len--;
+	else
+		len++;		/* Exact match, with the final \0 */
+	if (len >= TASK_COMM_LEN || memchr(term->str, '*', len))
+		return;
+	memcpy(filter->u.procname.name, term->str, len);
+	filter->u.procname.len = len;
+	filter->filter = filter_procname;
+}
+
+/**
+ * lttng_filter_specialize - bind a linked filter to a native function
+ * @filter: linked filter
+ *
+ * Keeps the interpreter if the filter is not one of the shapes handled.
+ */
+void lttng_filter_specialize(struct lttng_filter *filter)
+{
+	struct filter_term terms[LTTNG_FILTER_SET_MAX];
+	filter_opcode_t logical;
+	int i, nr;
+
+	nr = filter_parse(filter, terms, &logical);
+	if (nr < 0)
+		return;
+	for (i = 1; i < nr; i++)
+		if (terms[i].ref_op != terms[0].ref_op)
+			return;
+	switch (terms[0].ref_op) {
+	case FILTER_OP_LOAD_FIELD_REF_S64:
+		/*
+		 * The terms must reference a single field, which is then the
+		 * only one captured, at rank 0.
+		 */
+		if (nr == 1 || logical == FILTER_OP_AND)
+			filter_specialize_range(filter, terms, nr);
+		else
+			filter_specialize_set(filter, terms, nr);
+		break;
+	case FILTER_OP_LOAD_CONTEXT_REF_S64:
+		if (nr == 1 || logical == FILTER_OP_OR)
+			filter_specialize_set(filter, terms, nr);
+		break;
+	case FILTER_OP_LOAD_CONTEXT_REF_STRING:
+		if (nr == 1)
+			filter_specialize_procname(filter, &terms[0]);
+		break;
+	default:
+		break;
+	}
+}
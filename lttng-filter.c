@@ -0,0 +1,463 @@
+/*
+ * lttng-filter.c
+ *
+ * LTTng in-kernel event filters: bytecode validation and linking.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/err.h>
+#include <linux/bitops.h>
+#include <asm/unaligned.h>
+#include "lttng-filter.h"
+
+static const char *filter_context_names[NR_FILTER_CTX] = {
+	[FILTER_CTX_PID] = "pid",
+	[FILTER_CTX_TID] = "tid",
+	[FILTER_CTX_VPID] = "vpid",
+	[FILTER_CTX_VTID] = "vtid",
+	[FILTER_CTX_PPID] = "ppid",
+	[FILTER_CTX_NICE] = "nice",
+	[FILTER_CTX_PROCNAME] = "procname",
+};
+
+/*
+ * Validation state of each code offset. The stack state at a jump target is
+ * kept as its depth and a mask of the string values it holds.
+ */
+struct filter_insn_state {
+	unsigned char insn;	/* An instruction starts here */
+	unsigned char join;	/* Jump target, with stack state */
+	unsigned char depth;
+	unsigned char strings;
+};
+
+/*
+ * Length of the instruction at pc, or -EINVAL if it is unknown or does not
+ * fit in the code.
+ */
+static
+int filter_insn_len(const char *code, size_t pc, size_t len)
+{
+	size_t insn_len;
+
+	switch ((filter_opcode_t) code[pc]) {
+	case FILTER_OP_RETURN:
+		insn_len = sizeof(struct return_op);
+		break;
+	case FILTER_OP_EQ ... FILTER_OP_LE:
+	case FILTER_OP_EQ_S64 ... FILTER_OP_LE_STRING:
+		insn_len = sizeof(struct binary_op);
+		break;
+	case FILTER_OP_NOT:
+		insn_len = sizeof(struct unary_op);
+		break;
+	case FILTER_OP_AND:
+	case FILTER_OP_OR:
+		insn_len = sizeof(struct logical_op);
+		break;
+	case FILTER_OP_LOAD_FIELD_REF:
+	case FILTER_OP_LOAD_FIELD_REF_S64 ... FILTER_OP_LOAD_CONTEXT_REF_STRING:
+		insn_len = sizeof(struct load_op) + sizeof(struct field_ref);
+		break;
+	case FILTER_OP_LOAD_STRING:
+	{
+		size_t max = len - pc - sizeof(struct load_op);
+		size_t str_len;
+
+		str_len = strnlen(&code[pc + sizeof(struct load_op)], max);
+		if (str_len == max)
+			return -EINVAL;		/* Not \0-terminated */
+		insn_len = sizeof(struct load_op) + str_len + 1;
+		break;
+	}
+	case FILTER_OP_LOAD_S64:
+		insn_len = sizeof(struct load_op) + sizeof(int64_t);
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (insn_len > len - pc)
+		return -EINVAL;
+	return insn_len;
+}
+
+/*
+ * Check that the bytecode received is made of known instructions, and that
+ * jumps go forward, to an instruction. Forward jumps ensure the filter ends.
+ */
+static
+int filter_check_insns(const struct lttng_filter *filter,
+		       struct filter_insn_state *state)
+{
+	size_t pc, target;
+	int insn_len;
+
+	for (pc = 0; pc < filter->len; pc += insn_len) {
+		if ((filter_opcode_t) filter->code[pc] >= NR_FILTER_USER_OPS)
+			return -EINVAL;
+		insn_len = filter_insn_len(filter->code, pc, filter->len);
+		if (insn_len < 0)
+			return insn_len;
+		state[pc].insn = 1;
+	}
+	for (pc = 0; pc < filter->len; pc += insn_len) {
+		const struct logical_op *insn;
+
+		insn_len = filter_insn_len(filter->code, pc, filter->len);
+		switch ((filter_opcode_t) filter->code[pc]) {
+		case FILTER_OP_AND:
+		case FILTER_OP_OR:
+			insn = (const struct logical_op *) &filter->code[pc];
+			target = get_unaligned(&insn->skip_offset);
+			if (target <= pc || target >= filter->len
+			    || !state[target].insn)
+				return -EINVAL;
+			break;
+		default:
+			break;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Typed load instruction of an event field, or -EINVAL if the filter cannot
+ * load it. Only integers, and text as strings, arrays or sequences, are
+ * supported.
+ */
+static
+int filter_field_load_op(const struct lttng_type *type)
+{
+	const struct lttng_basic_type *elem_type;
+
+	switch (type->atype) {
+	case atype_integer:
+		return FILTER_OP_LOAD_FIELD_REF_S64;
+	case atype_string:
+		return FILTER_OP_LOAD_FIELD_REF_STRING;
+	case atype_array:
+		elem_type = &type->u.array.elem_type;
+		break;
+	case atype_sequence:
+		elem_type = &type->u.sequence.elem_type;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (elem_type->atype != atype_integer
+	    || elem_type->u.basic.integer.size != CHAR_BIT
+	    || elem_type->u.basic.integer.encoding == lttng_encode_none)
+		return -EINVAL;
+	return FILTER_OP_LOAD_FIELD_REF_STRING;
+}
+
+/*
+ * Resolve the field or context name of a load instruction, and make it a
+ * typed load.
+ */
+static
+int filter_link_ref(struct lttng_filter *filter,
+		    const struct lttng_event_desc *desc,
+		    const struct filter_insn_state *state,
+		    size_t insn_offset, const char *name)
+{
+	struct load_op *insn;
+	struct field_ref ref;
+	unsigned int i;
+	int op;
+
+	if (insn_offset >= filter->len || !state[insn_offset].insn)
+		return -EINVAL;
+	insn = (struct load_op *) &filter->code[insn_offset];
+	if (insn->op != FILTER_OP_LOAD_FIELD_REF)
+		return -EINVAL;		/* Not a reference, or relocated twice */
+	if (!strncmp(name, FILTER_CONTEXT_PREFIX,
+		     strlen(FILTER_CONTEXT_PREFIX))) {
+		name += strlen(FILTER_CONTEXT_PREFIX);
+		for (i = 0; i < NR_FILTER_CTX; i++)
+			if (!strcmp(name, filter_context_names[i]))
+				break;
+		if (i == NR_FILTER_CTX)
+			return -ENOENT;
+		if (i == FILTER_CTX_PROCNAME)
+			op = FILTER_OP_LOAD_CONTEXT_REF_STRING;
+		else
+			op = FILTER_OP_LOAD_CONTEXT_REF_S64;
+	} else {
+		for (i = 0; i < desc->nr_fields; i++)
+			if (!strcmp(name, desc->fields[i].name))
+				break;
+		if (i == desc->nr_fields)
+			return -ENOENT;
+		if (i >= 64)
+			return -EINVAL;		/* Beyond the field mask */
+		op = filter_field_load_op(&desc->fields[i].type);
+		if (op < 0)
+			return op;
+		filter->field_mask |= 1ULL << i;
+	}
+	insn->op = op;
+	ref.offset = i;
+	memcpy(insn->data, &ref, sizeof(ref));
+	return 0;
+}
+
+/*
+ * Make the field loads refer to the rank of the field in the field mask,
+ * which is its index among the values captured by the probe.
+ */
+static
+int filter_compact_fields(struct lttng_filter *filter,
+			  const struct filter_insn_state *state)
+{
+	struct load_op *insn;
+	struct field_ref ref;
+	uint64_t below;
+	size_t pc;
+
+	if (hweight64(filter->field_mask) > LTTNG_FILTER_FIELDS_MAX)
+		return -EINVAL;
+	for (pc = 0; pc < filter->len; pc++) {
+		if (!state[pc].insn)
+			continue;
+		insn = (struct load_op *) &filter->code[pc];
+		if (insn->op != FILTER_OP_LOAD_FIELD_REF_S64
+		    && insn->op != FILTER_OP_LOAD_FIELD_REF_STRING)
+			continue;
+		memcpy(&ref, insn->data, sizeof(ref));
+		below = filter->field_mask & ((1ULL << ref.offset) - 1);
+		ref.offset = hweight64(below);
+		memcpy(insn->data, &ref, sizeof(ref));
+	}
+	return 0;
+}
+
+/*
+ * Apply the relocation table found after the code in the bytecode.
+ */
+static
+int filter_link(struct lttng_filter *filter,
+		const struct lttng_event_desc *desc,
+		const struct filter_insn_state *state,
+		const struct lttng_kernel_filter_bytecode *bytecode)
+{
+	size_t offset, name_max, name_len;
+	const char *name;
+	uint16_t insn_offset;
+	int ret;
+
+	for (offset = bytecode->reloc_offset; offset < bytecode->len;
+	     offset += sizeof(uint16_t) + name_len + 1) {
+		if (bytecode->len - offset < sizeof(uint16_t) + 1)
+			return -EINVAL;
+		insn_offset = get_unaligned((const uint16_t *)
+					    &bytecode->data[offset]);
+		name = &bytecode->data[offset + sizeof(uint16_t)];
+		name_max = bytecode->len - offset - sizeof(uint16_t);
+		name_len = strnlen(name, name_max);
+		if (name_len == name_max)
+			return -EINVAL;		/* Not \0-terminated */
+		ret = filter_link_ref(filter, desc, state, insn_offset, name);
+		if (ret)
+			return ret;
+	}
+	return filter_compact_fields(filter, state);
+}
+
+/*
+ * Follow the value stack through the linked code: check its depth and the
+ * operand types, and make the comparisons typed. Every instruction must be
+ * reached, with the same stack state from all paths, and the code must
+ * return an integer.
+ */
+static
+int filter_check_types(struct lttng_filter *filter,
+		       struct filter_insn_state *state)
+{
+	unsigned int depth = 0, strings = 0, top_string;
+	int insn_len, reachable = 1;
+	size_t pc, target;
+
+	for (pc = 0; pc < filter->len; pc += insn_len) {
+		filter_opcode_t op = filter->code[pc];
+		struct filter_insn_state *s = &state[pc];
+
+		insn_len = filter_insn_len(filter->code, pc, filter->len);
+		if (s->join) {
+			if (!reachable) {
+				depth = s->depth;
+				strings = s->strings;
+				reachable = 1;
+			} else if (depth != s->depth || strings != s->strings) {
+				return -EINVAL;
+			}
+		}
+		if (!reachable)
+			return -EINVAL;		/* Dead code */
+		top_string = depth ? (strings >> (depth - 1)) & 1 : 0;
+
+		switch (op) {
+		case FILTER_OP_RETURN:
+			if (!depth || top_string)
+				return -EINVAL;
+			reachable = 0;
+			break;
+		case FILTER_OP_EQ ... FILTER_OP_LE:
+			if (depth < 2)
+				return -EINVAL;
+			if (((strings >> (depth - 2)) & 1) != top_string)
+				return -EINVAL;		/* Mixed types */
+			if (top_string)
+				op += FILTER_OP_EQ_STRING - FILTER_OP_EQ;
+			else
+				op += FILTER_OP_EQ_S64 - FILTER_OP_EQ;
+			filter->code[pc] = op;
+			strings &= ~(3U << (depth - 2));
+			depth--;
+			break;
+		case FILTER_OP_NOT:
+			if (!depth || top_string)
+				return -EINVAL;
+			break;
+		case FILTER_OP_AND:
+		case FILTER_OP_OR:
+		{
+			const struct logical_op *insn =
+				(const struct logical_op *) &filter->code[pc];
+
+			if (!depth || top_string)
+				return -EINVAL;
+			target = get_unaligned(&insn->skip_offset);
+			if (state[target].join) {
+				if (state[target].depth != depth
+				    || state[target].strings != strings)
+					return -EINVAL;
+			} else {
+				state[target].join = 1;
+				state[target].depth = depth;
+				state[target].strings = strings;
+			}
+			depth--;
+			break;
+		}
+		case FILTER_OP_LOAD_STRING:
+		case FILTER_OP_LOAD_FIELD_REF_STRING:
+		case FILTER_OP_LOAD_CONTEXT_REF_STRING:
+			if (depth == FILTER_STACK_MAX)
+				return -EINVAL;
+			strings |= 1U << depth;
+			depth++;
+			break;
+		case FILTER_OP_LOAD_S64:
+		case FILTER_OP_LOAD_FIELD_REF_S64:
+		case FILTER_OP_LOAD_CONTEXT_REF_S64:
+			if (depth == FILTER_STACK_MAX)
+				return -EINVAL;
+			depth++;
+			break;
+		default:
+			/* Load without relocation. */
+			return -EINVAL;
+		}
+	}
+	if (reachable)
+		return -EINVAL;		/* Missing return */
+	return 0;
+}
+
+/**
+ * lttng_filter_create - validate and link a filter for an event
+ * @desc: event description
+ * @bytecode: filter bytecode, see lttng-filter-bytecode.h
+ *
+ * Returns the filter, or an ERR_PTR() value if the bytecode is invalid or
+ * refers to fields the filter cannot load.
+ */
+struct lttng_filter *lttng_filter_create(const struct lttng_event_desc *desc,
+		const struct lttng_kernel_filter_bytecode *bytecode)
+{
+	struct lttng_filter *filter;
+	struct filter_insn_state *state;
+	size_t len = bytecode->reloc_offset;
+	int ret;
+
+	if (bytecode->len > LTTNG_KERNEL_FILTER_BYTECODE_MAX_LEN
+	    || bytecode->reloc_offset > bytecode->len || !len)
+		return ERR_PTR(-EINVAL);
+	filter = kzalloc(sizeof(*filter) + len, GFP_KERNEL);
+	if (!filter)
+		return ERR_PTR(-ENOMEM);
+	filter->filter = lttng_filter_interpret;
+	filter->len = len;
+	memcpy(filter->code, bytecode->data, len);
+	state = kcalloc(len, sizeof(*state), GFP_KERNEL);
+	if (!state) {
+		ret = -ENOMEM;
+		goto error;
+	}
+	ret = filter_check_insns(filter, state);
+	if (ret)
+		goto error_state;
+	ret = filter_link(filter, desc, state, bytecode);
+	if (ret)
+		goto error_state;
+	ret = filter_check_types(filter, state);
+	if (ret)
+		goto error_state;
+	kfree(state);
+	lttng_filter_specialize(filter);
+	return filter;
+
+error_state:
+	kfree(state);
+error:
+	kfree(filter);
+	return ERR_PTR(ret);
+}
+
+static
+int filter_reject(const struct lttng_filter *filter,
+		  const struct lttng_filter_field_value *fields)
+{
+	return 0;
+}
+
+/**
+ * lttng_filter_create_reject - create a filter rejecting every event
+ *
+ * Stands for a filter which cannot be linked against an event, e.g. because
+ * the event lacks a field it refers to. Returns NULL if out of memory.
+ */
+struct lttng_filter *lttng_filter_create_reject(void)
+{
+	struct lttng_filter *filter;
+
+	filter = kzalloc(sizeof(*filter), GFP_KERNEL);
+	if (!filter)
+		return NULL;
+	filter->filter = filter_reject;
+	return filter;
+}
+
+void lttng_filter_destroy(struct lttng_filter *filter)
+{
+	kfree(filter);
+}
@@ -0,0 +1,154 @@
+#ifndef _LTTNG_FILTER_H
+#define _LTTNG_FILTER_H
+
+/*
+ * lttng-filter.h
+ *
+ * LTTng in-kernel event filters.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/types.h>
+#include <linux/swab.h>
+#include <linux/sched.h>
+#include "lttng-events.h"
+#include "lttng-filter-bytecode.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX	(~(size_t) 0)
+#endif
+
+/* Maximum depth of the filter value stack. */
+#define FILTER_STACK_MAX		8
+
+/*
+ * Maximum number of event fields referenced by a filter. Only the fields of
+ * index below 64 can be referenced, see field_mask.
+ */
+#define LTTNG_FILTER_FIELDS_MAX		8
+
+/* Maximum number of values of a specialized set membership filter. */
+#define LTTNG_FILTER_SET_MAX		8
+
+/* Number of field values captured for an event with nr_fields fields. */
+#define LTTNG_FILTER_NR_FIELDS(nr_fields)				\
+	((nr_fields) < LTTNG_FILTER_FIELDS_MAX ?			\
+		(nr_fields) : LTTNG_FILTER_FIELDS_MAX)
+
+/*
+ * Value of an event field, captured by the probe for the filter. Text fields
+ * (strings, text arrays and sequences) are referenced in place: len bounds
+ * the text, which also ends at the first \0.
+ */
+struct lttng_filter_field_value {
+	union {
+		int64_t v;
+		struct {
+			const char *p;
+			size_t len;
+		} s;
+	} u;
+	unsigned int user:1;	/* Text in user space */
+};
+
+/* Filter context ids, referenced as "$ctx.<name>". */
+enum lttng_filter_ctx {
+	FILTER_CTX_PID,
+	FILTER_CTX_TID,
+	FILTER_CTX_VPID,
+	FILTER_CTX_VTID,
+	FILTER_CTX_PPID,
+	FILTER_CTX_NICE,
+	FILTER_CTX_PROCNAME,
+	NR_FILTER_CTX,
+};
+
+/*
+ * Linked filter of an event, referenced by the probe under RCU sched.
+ */
+struct lttng_filter {
+	/* Returns nonzero if the event is recorded. */
+	int (*filter)(const struct lttng_filter *filter,
+		      const struct lttng_filter_field_value *fields);
+	/*
+	 * Fields referenced, by index in the event description. The probe
+	 * captures their values only, in order: the linked code refers to
+	 * them by rank in the mask.
+	 */
+	uint64_t field_mask;
+	/* Parameters of the specialized filters, see lttng-filter-specialize.c */
+	union {
+		struct {
+			int64_t min, max;	/* Inclusive */
+			int negate;
+		} range;
+		struct {
+			unsigned int ctx;	/* Context id, for context sets */
+			unsigned int nr;
+			int64_t values[LTTNG_FILTER_SET_MAX];
+		} set;
+		struct {
+			size_t len;		/* Compared length */
+			char name[TASK_COMM_LEN];
+		} procname;
+	} u;
+	size_t len;		/* Length of the linked code */
+	char code[0];
+};
+
+/*
+ * Integer value of a field for the filter. Pointers and integers up to the
+ * size of a long go through long, so both convert without warning.
+ */
+#define lttng_filter_int(_v)						\
+	__builtin_choose_expr(sizeof(_v) <= sizeof(long),		\
+		(lttng_is_signed_type(__typeof__(_v))			\
+			? (int64_t) (long) (_v)				\
+			: (int64_t) (unsigned long) (_v)),		\
+		(int64_t) (_v))
+
+/* Host value of an integer field captured in the other byte order. */
+static inline
+int64_t lttng_filter_swab_int(int64_t v, size_t size, int is_signed)
+{
+	switch (size) {
+	case 2:
+		return is_signed ? (int64_t) (s16) swab16(v)
+			: (int64_t) swab16(v);
+	case 4:
+		return is_signed ? (int64_t) (s32) swab32(v)
+			: (int64_t) swab32(v);
+	case 8:
+		return (int64_t) swab64(v);
+	default:
+		return v;
+	}
+}
+
+struct lttng_filter *lttng_filter_create(const struct lttng_event_desc *desc,
+		const struct lttng_kernel_filter_bytecode *bytecode);
+struct lttng_filter *lttng_filter_create_reject(void);
+void lttng_filter_destroy(struct lttng_filter *filter);
+
+void lttng_filter_specialize(struct lttng_filter *filter);
+
+int lttng_filter_interpret(const struct lttng_filter *filter,
+		const struct lttng_filter_field_value *fields);
+int64_t lttng_filter_context_s64(unsigned int ctx);
+
+#endif /* _LTTNG_FILTER_H */
@@ -64,6 +64,12 @@ int lttng_probe_register(struct lttng_probe_desc *desc)
 	list_add(&desc->head, &probe_list);
 end:
 	mutex_unlock(&probe_mutex);
+	/*
+	 * Create the events of the enablers matching the new probe. Done
+	 * without the probe mutex held, which nests in the sessions mutex.
+	 */
+	if (!ret)
+		lttng_enablers_probe_register(desc);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(lttng_probe_register);
@@ -76,6 +82,25 @@ void lttng_probe_unregister(struct lttng_probe_desc *desc)
 }
 EXPORT_SYMBOL_GPL(lttng_probe_unregister);
 
+/*
+ * The registered probes can be iterated on with the probe mutex held, which
+ * nests in the sessions mutex.
+ */
+void lttng_lock_probes(void)
+{
+	mutex_lock(&probe_mutex);
+}
+
+void lttng_unlock_probes(void)
+{
+	mutex_unlock(&probe_mutex);
+}
+
+struct list_head *lttng_get_probe_list_head(void)
+{
+	return &probe_list;
+}
+
 const struct lttng_event_desc *lttng_event_get(const char *name)
 {
 	const struct lttng_event_desc *event;
@@ -0,0 +1,108 @@
+/*
+ * lttng-ring-buffer-client-persistent-overwrite.c
+ *
+ * LTTng lib ring buffer client (overwrite mode, buffers in persistent memory).
+ *
+ * The buffers of the channel are placed in a physical memory region reserved
+ * at boot (e.g. memmap=nn$ss, or a reserved-memory node), given by the
+ * mem_start and mem_size module parameters. The region survives a kexec or
+ * warm reboot: a channel of the same geometry created by the next kernel
+ * recovers the flight recorder content, which consumers read as usual until
+ * end of stream. The region is cleared when the recovered channel is
+ * destroyed. It holds a single channel at a time.
+ *
+ * Copyright (C) 2010-2012 Mathieu Desnoyers <mathieu.desnoyers@efficios.com>
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mm.h>
+#include <linux/io.h>
+#include <asm/atomic.h>
+#include "wrapper/ringbuffer/frontend.h"
+#include "lttng-tracer.h"
+
+static unsigned long mem_start;
+module_param(mem_start, ulong, 0444);
+MODULE_PARM_DESC(mem_start, "Physical address of the reserved memory");
+
+static unsigned long mem_size;
+module_param(mem_size, ulong, 0444);
+MODULE_PARM_DESC(mem_size, "Size of the reserved memory, in bytes");
+
+static void *static_mem;
+static atomic_t static_mem_busy = ATOMIC_INIT(0);
+
+static
+int lttng_client_static_mem_init(void)
+{
+	if (!mem_size || !PAGE_ALIGNED(mem_start)) {
+		printk(KERN_WARNING "LTTng: persistent buffers need the "
+		       "page aligned mem_start and mem_size parameters\n");
+		return -EINVAL;
+	}
+	static_mem = (void __force *) ioremap_cache(mem_start, mem_size);
+	if (!static_mem)
+		return -ENOMEM;
+	return 0;
+}
+
+static
+void lttng_client_static_mem_exit(void)
+{
+	iounmap((void __iomem __force *) static_mem);
+}
+
+static
+void *lttng_client_static_mem_get(const struct lib_ring_buffer_config *config,
+				  size_t subbuf_size, size_t num_subbuf)
+{
+	if (channel_static_size(config, subbuf_size, num_subbuf) > mem_size) {
+		printk(KERN_WARNING "LTTng: channel does not fit in the "
+		       "persistent memory\n");
+		return NULL;
+	}
+	if (atomic_cmpxchg(&static_mem_busy, 0, 1))
+		return NULL;	/* Used by another channel */
+	return static_mem;
+}
+
+/*
+ * Only the content of a channel which was not destroyed, i.e. left by a crash
+ * or kexec, is recovered: a channel destroyed normally clears the memory,
+ * whether it traced or handed recovered content to the consumer. A channel
+ * which failed to be created leaves the memory as is.
+ */
+static
+void lttng_client_static_mem_put(int clear)
+{
+	if (clear)
+		channel_static_clear(static_mem);
+	atomic_set(&static_mem_busy, 0);
+}
+
+#define LTTNG_CLIENT_STATIC_MEM
+#define RING_BUFFER_MODE_TEMPLATE		RING_BUFFER_OVERWRITE
+#define RING_BUFFER_MODE_TEMPLATE_STRING	"overwrite-persistent"
+#define RING_BUFFER_OUTPUT_TEMPLATE		RING_BUFFER_SPLICE
+#define RING_BUFFER_BACKEND_TEMPLATE		RING_BUFFER_STATIC
+#include "lttng-ring-buffer-client.h"
+
+MODULE_LICENSE("GPL and additional rights");
+MODULE_AUTHOR("agent");
+MODULE_DESCRIPTION("LTTng Ring Buffer Client Persistent Overwrite Mode");
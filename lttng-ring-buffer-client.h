@@ -22,6 +22,7 @@
 
 #include <linux/module.h>
 #include <linux/types.h>
+#include <linux/sched.h>
 #include "lib/bitfield.h"
 #include "wrapper/vmalloc.h"	/* for wrapper_vmalloc_sync_all() */
 #include "wrapper/trace-clock.h"
@@ -32,6 +33,10 @@
 #define LTTNG_COMPACT_EVENT_BITS	5
 #define LTTNG_COMPACT_TSC_BITS		27
 
+#ifndef RING_BUFFER_BACKEND_TEMPLATE
+#define RING_BUFFER_BACKEND_TEMPLATE	RING_BUFFER_PAGE
+#endif
+
 /*
  * Keep the natural field alignment for _each field_ within this structure if
  * you ever add/remove a field from this header. Packed attribute is not used
@@ -91,19 +96,6 @@ size_t ctx_get_size(size_t offset, struct lttng_ctx *ctx)
 	return offset - orig_offset;
 }
 
-static inline
-void ctx_record(struct lib_ring_buffer_ctx *bufctx,
-		struct lttng_channel *chan,
-		struct lttng_ctx *ctx)
-{
-	int i;
-
-	if (likely(!ctx))
-		return;
-	for (i = 0; i < ctx->nr_fields; i++)
-		ctx->fields[i].record(&ctx->fields[i], bufctx, chan);
-}
-
 /*
  * record_header_size - Calculate the header size and padding necessary.
  * @config: ring buffer instance configuration
@@ -128,6 +120,14 @@ unsigned char record_header_size(const struct lib_ring_buffer_config *config,
 	size_t orig_offset = offset;
 	size_t padding;
 
+	if (likely(event->header_plan.valid)) {
+		unsigned int idx = offset & (LTTNG_HEADER_PLAN_ALIGN - 1);
+		int ext = !!(ctx->rflags & (RING_BUFFER_RFLAG_FULL_TSC | LTTNG_RFLAG_EXTENDED));
+
+		*pre_header_padding = event->header_plan.padding[idx];
+		return event->header_plan.size[ext][idx];
+	}
+
 	switch (lttng_chan->header_type) {
 	case 1:	/* compact */
 		padding = lib_ring_buffer_align(offset, lttng_alignof(uint32_t));
@@ -172,6 +172,102 @@ unsigned char record_header_size(const struct lib_ring_buffer_config *config,
 
 #include "wrapper/ringbuffer/api.h"
 
+static const struct lib_ring_buffer_config client_config;
+
+/*
+ * Fetch the values of all the context fields into a blob laid out as the
+ * fields would be in the buffer, with zeroed alignment padding, and write
+ * it at once.
+ */
+static
+void ctx_gather_record(struct lib_ring_buffer_ctx *bufctx,
+		       struct lttng_ctx *ctx)
+{
+	char blob[LTTNG_CTX_GATHER_MAX];
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < ctx->nr_fields; i++) {
+		struct lttng_ctx_field *field = &ctx->fields[i];
+		size_t padding;
+		char *dst;
+
+		padding = lib_ring_buffer_align(bufctx->buf_offset + len,
+						field->gather.alignment);
+		memset(&blob[len], 0, padding);
+		len += padding;
+		dst = &blob[len];
+		switch (field->gather.type) {
+		case LTTNG_CTX_GATHER_PID:
+		{
+			pid_t pid = task_tgid_nr(current);
+
+			memcpy(dst, &pid, sizeof(pid));
+			break;
+		}
+		case LTTNG_CTX_GATHER_TID:
+		{
+			pid_t tid = task_pid_nr(current);
+
+			memcpy(dst, &tid, sizeof(tid));
+			break;
+		}
+		case LTTNG_CTX_GATHER_VPID:
+		{
+			pid_t vpid;
+
+			/* nsproxy can be NULL when scheduled out of exit. */
+			vpid = current->nsproxy ? task_tgid_vnr(current) : 0;
+			memcpy(dst, &vpid, sizeof(vpid));
+			break;
+		}
+		case LTTNG_CTX_GATHER_VTID:
+		{
+			pid_t vtid;
+
+			vtid = current->nsproxy ? task_pid_vnr(current) : 0;
+			memcpy(dst, &vtid, sizeof(vtid));
+			break;
+		}
+		case LTTNG_CTX_GATHER_NICE:
+		{
+			int nice = task_nice(current);
+
+			memcpy(dst, &nice, sizeof(nice));
+			break;
+		}
+		case LTTNG_CTX_GATHER_PROCNAME:
+			memcpy(dst, current->comm, sizeof(current->comm));
+			break;
+		case LTTNG_CTX_GATHER_CALLBACK:
+			field->gather.get(field, bufctx, dst);
+			break;
+		default:
+			WARN_ON_ONCE(1);
+			memset(dst, 0, field->gather.size);
+		}
+		len += field->gather.size;
+	}
+	lib_ring_buffer_write(&client_config, bufctx, blob, len);
+}
+
+static inline
+void ctx_record(struct lib_ring_buffer_ctx *bufctx,
+		struct lttng_channel *chan,
+		struct lttng_ctx *ctx)
+{
+	int i;
+
+	if (likely(!ctx))
+		return;
+	if (likely(ctx->gather_size)) {
+		ctx_gather_record(bufctx, ctx);
+		return;
+	}
+	for (i = 0; i < ctx->nr_fields; i++)
+		ctx->fields[i].record(&ctx->fields[i], bufctx, chan);
+}
+
 static
 void lttng_write_event_header_slow(const struct lib_ring_buffer_config *config,
 				 struct lib_ring_buffer_ctx *ctx,
@@ -304,8 +400,6 @@ void lttng_write_event_header_slow(const struct lib_ring_buffer_config *config,
 	lib_ring_buffer_align_ctx(ctx, ctx->largest_align);
 }
 
-static const struct lib_ring_buffer_config client_config;
-
 static u64 client_ring_buffer_clock_read(struct channel *chan)
 {
 	return lib_ring_buffer_clock_read(chan);
@@ -403,11 +497,16 @@ static const struct lib_ring_buffer_config client_config = {
 	.alloc = RING_BUFFER_ALLOC_PER_CPU,
 	.sync = RING_BUFFER_SYNC_PER_CPU,
 	.mode = RING_BUFFER_MODE_TEMPLATE,
-	.backend = RING_BUFFER_PAGE,
+	.backend = RING_BUFFER_BACKEND_TEMPLATE,
 	.output = RING_BUFFER_OUTPUT_TEMPLATE,
 	.oops = RING_BUFFER_OOPS_CONSISTENCY,
 	.ipi = RING_BUFFER_IPI_BARRIER,
+#ifdef CONFIG_IRQ_WORK
+	/* Readers are woken up on delivery: read_timer_interval is unused. */
+	.wakeup = RING_BUFFER_WAKEUP_BY_WORK,
+#else
 	.wakeup = RING_BUFFER_WAKEUP_BY_TIMER,
+#endif
 };
 
 static
@@ -415,17 +514,38 @@ struct channel *_channel_create(const char *name,
 				struct lttng_channel *lttng_chan, void *buf_addr,
 				size_t subbuf_size, size_t num_subbuf,
 				unsigned int switch_timer_interval,
-				unsigned int read_timer_interval)
+				unsigned int read_timer_interval,
+				size_t max_memory)
 {
+#ifdef LTTNG_CLIENT_STATIC_MEM
+	struct channel *chan;
+
+	buf_addr = lttng_client_static_mem_get(&client_config, subbuf_size,
+					       num_subbuf);
+	if (!buf_addr)
+		return NULL;
+	chan = channel_create(&client_config, name, lttng_chan, buf_addr,
+			      subbuf_size, num_subbuf, switch_timer_interval,
+			      read_timer_interval, max_memory);
+	if (!chan)
+		lttng_client_static_mem_put(0);
+	return chan;
+#else
 	return channel_create(&client_config, name, lttng_chan, buf_addr,
 			      subbuf_size, num_subbuf, switch_timer_interval,
-			      read_timer_interval);
+			      read_timer_interval, max_memory);
+#endif
 }
 
 static
 void lttng_channel_destroy(struct channel *chan)
 {
+#ifdef LTTNG_CLIENT_STATIC_MEM
+	channel_destroy(chan);
+	lttng_client_static_mem_put(1);
+#else
 	channel_destroy(chan);
+#endif
 }
 
 static
@@ -462,6 +582,71 @@ void lttng_buffer_read_close(struct lib_ring_buffer *buf)
 	lib_ring_buffer_release_read(buf);
 }
 
+/*
+ * Context fields of fixed size and alignment take the same space at any
+ * offset congruent modulo LTTNG_HEADER_PLAN_ALIGN.
+ */
+static
+int ctx_is_fixed_size(struct lttng_ctx *ctx)
+{
+	int i;
+
+	if (!ctx)
+		return 1;
+	for (i = 0; i < ctx->nr_fields; i++) {
+		const struct lttng_type *type = &ctx->fields[i].event_field.type;
+		unsigned int alignment;
+
+		switch (type->atype) {
+		case atype_integer:
+			alignment = type->u.basic.integer.alignment;
+			break;
+		case atype_array:
+			if (type->u.array.elem_type.atype != atype_integer)
+				return 0;
+			alignment = type->u.array.elem_type.u.basic.integer.alignment;
+			break;
+		default:
+			return 0;
+		}
+		if (alignment > LTTNG_HEADER_PLAN_ALIGN * CHAR_BIT)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ * Called with the sessions mutex held, before the event can be traced with
+ * its current header type and contexts. Events with variable-size contexts
+ * keep computing their header size on each reservation.
+ */
+static
+void lttng_event_update_plan(struct lttng_event *event)
+{
+	struct lttng_channel *lttng_chan = event->chan;
+	struct lttng_header_plan *plan = &event->header_plan;
+	struct lib_ring_buffer_ctx ctx;
+	size_t padding, size;
+	unsigned int idx;
+	int ext;
+
+	plan->valid = 0;
+	if (!ctx_is_fixed_size(event->ctx)
+	    || !ctx_is_fixed_size(lttng_chan->ctx))
+		return;
+	lib_ring_buffer_ctx_init(&ctx, lttng_chan->chan, event, 0, 1, 0);
+	for (ext = 0; ext < 2; ext++) {
+		ctx.rflags = ext ? LTTNG_RFLAG_EXTENDED : 0;
+		for (idx = 0; idx < LTTNG_HEADER_PLAN_ALIGN; idx++) {
+			size = record_header_size(&client_config,
+					lttng_chan->chan, idx, &padding, &ctx);
+			plan->size[ext][idx] = size;
+			plan->padding[idx] = padding;
+		}
+	}
+	plan->valid = 1;
+}
+
 static
 int lttng_event_reserve(struct lib_ring_buffer_ctx *ctx,
 		      uint32_t event_id)
@@ -563,6 +748,7 @@ static struct lttng_transport lttng_relay_transport = {
 		.buffer_read_close = lttng_buffer_read_close,
 		.event_reserve = lttng_event_reserve,
 		.event_commit = lttng_event_commit,
+		.event_update_plan = lttng_event_update_plan,
 		.event_write = lttng_event_write,
 		.event_write_from_user = lttng_event_write_from_user,
 		.event_memset = lttng_event_memset,
@@ -576,6 +762,13 @@ static struct lttng_transport lttng_relay_transport = {
 
 static int __init lttng_ring_buffer_client_init(void)
 {
+#ifdef LTTNG_CLIENT_STATIC_MEM
+	int ret;
+
+	ret = lttng_client_static_mem_init();
+	if (ret)
+		return ret;
+#endif
 	/*
 	 * This vmalloc sync all also takes care of the lib ring buffer
 	 * vmalloc'd module pages when it is built as a module into LTTng.
@@ -590,6 +783,9 @@ module_init(lttng_ring_buffer_client_init);
 static void __exit lttng_ring_buffer_client_exit(void)
 {
 	lttng_transport_unregister(&lttng_relay_transport);
+#ifdef LTTNG_CLIENT_STATIC_MEM
+	lttng_client_static_mem_exit();
+#endif
 }
 
 module_exit(lttng_ring_buffer_client_exit);
@@ -296,7 +296,7 @@ void syscall_entry_probe(void *__data, struct pt_regs *regs, long id)
 /* noinline to diminish caller stack size */
 static
 int fill_table(const struct trace_syscall_entry *table, size_t table_len,
-	struct lttng_event **chan_table, struct lttng_channel *chan, void *filter)
+	struct lttng_event **chan_table, struct lttng_channel *chan)
 {
 	const struct lttng_event_desc *desc;
 	unsigned int i;
@@ -320,7 +320,7 @@ int fill_table(const struct trace_syscall_entry *table, size_t table_len,
 		strncpy(ev.name, desc->name, LTTNG_KERNEL_SYM_NAME_LEN);
 		ev.name[LTTNG_KERNEL_SYM_NAME_LEN - 1] = '\0';
 		ev.instrumentation = LTTNG_KERNEL_NOOP;
-		chan_table[i] = lttng_event_create(chan, &ev, filter,
+		chan_table[i] = lttng_event_create(chan, &ev, NULL,
 						desc);
 		if (!chan_table[i]) {
 			/*
@@ -335,7 +335,7 @@ int fill_table(const struct trace_syscall_entry *table, size_t table_len,
 	return 0;
 }
 
-int lttng_syscalls_register(struct lttng_channel *chan, void *filter)
+int lttng_syscalls_register(struct lttng_channel *chan)
 {
 	struct lttng_kernel_event ev;
 	int ret;
@@ -367,7 +367,7 @@ int lttng_syscalls_register(struct lttng_channel *chan, void *filter)
 		strncpy(ev.name, desc->name, LTTNG_KERNEL_SYM_NAME_LEN);
 		ev.name[LTTNG_KERNEL_SYM_NAME_LEN - 1] = '\0';
 		ev.instrumentation = LTTNG_KERNEL_NOOP;
-		chan->sc_unknown = lttng_event_create(chan, &ev, filter,
+		chan->sc_unknown = lttng_event_create(chan, &ev, NULL,
 						    desc);
 		if (!chan->sc_unknown) {
 			return -EINVAL;
@@ -382,7 +382,7 @@ int lttng_syscalls_register(struct lttng_channel *chan, void *filter)
 		strncpy(ev.name, desc->name, LTTNG_KERNEL_SYM_NAME_LEN);
 		ev.name[LTTNG_KERNEL_SYM_NAME_LEN - 1] = '\0';
 		ev.instrumentation = LTTNG_KERNEL_NOOP;
-		chan->sc_compat_unknown = lttng_event_create(chan, &ev, filter,
+		chan->sc_compat_unknown = lttng_event_create(chan, &ev, NULL,
 							   desc);
 		if (!chan->sc_compat_unknown) {
 			return -EINVAL;
@@ -397,7 +397,7 @@ int lttng_syscalls_register(struct lttng_channel *chan, void *filter)
 		strncpy(ev.name, desc->name, LTTNG_KERNEL_SYM_NAME_LEN);
 		ev.name[LTTNG_KERNEL_SYM_NAME_LEN - 1] = '\0';
 		ev.instrumentation = LTTNG_KERNEL_NOOP;
-		chan->sc_exit = lttng_event_create(chan, &ev, filter,
+		chan->sc_exit = lttng_event_create(chan, &ev, NULL,
 						 desc);
 		if (!chan->sc_exit) {
 			return -EINVAL;
@@ -405,12 +405,12 @@ int lttng_syscalls_register(struct lttng_channel *chan, void *filter)
 	}
 
 	ret = fill_table(sc_table, ARRAY_SIZE(sc_table),
-			chan->sc_table, chan, filter);
+			chan->sc_table, chan);
 	if (ret)
 		return ret;
 #ifdef CONFIG_COMPAT
 	ret = fill_table(compat_sc_table, ARRAY_SIZE(compat_sc_table),
-			chan->compat_sc_table, chan, filter);
+			chan->compat_sc_table, chan);
 	if (ret)
 		return ret;
 #endif
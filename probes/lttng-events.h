@@ -26,6 +26,7 @@
 #include "../wrapper/vmalloc.h"	/* for wrapper_vmalloc_sync_all() */
 #include "../wrapper/ringbuffer/frontend_types.h"
 #include "../lttng-events.h"
+#include "../lttng-filter.h"
 #include "../lttng-tracer-core.h"
 
 /*
@@ -557,6 +558,212 @@ struct __event_typemap__##_name {					      \
 #include TRACE_INCLUDE(TRACE_INCLUDE_FILE)
 
 
+/*
+ * Stage 8.9 of the trace events.
+ *
+ * Create static inline function that captures the values of the fields
+ * referenced by the filter, in the order of the field descriptions. Each bit
+ * of the mask selects a field. The function returns once the last referenced
+ * field is captured: it neither sizes nor scans the other fields.
+ *
+ * As in the probe, the field declarations control the execution order,
+ * jumping to the assignment block which captures the field.
+ */
+
+#include "lttng-events-reset.h"	/* Reset all macros within TRACE_EVENT */
+
+#undef __filter_next_field
+#define __filter_next_field()						\
+	__mask >>= 1;							\
+	if (!__mask)							\
+		return;
+
+#undef __field_full
+#define __field_full(_type, _item, _order, _base)			\
+	if (__mask & 1) {						\
+		goto __assign_##_item;					\
+__end_field_##_item:							\
+		if (_order != __BYTE_ORDER)				\
+			__field->u.v = lttng_filter_swab_int(__field->u.v, \
+				sizeof(_type), lttng_is_signed_type(_type)); \
+		__field++;						\
+	}								\
+	__filter_next_field()
+
+#undef __array_enc_ext
+#define __array_enc_ext(_type, _item, _length, _order, _base, _encoding)\
+	if (__mask & 1) {						\
+		__field->u.s.len = (_length);				\
+		goto __assign_##_item;					\
+__end_field_##_item:							\
+		__field++;						\
+	}								\
+	__filter_next_field()
+
+#undef __dynamic_array_enc_ext
+#define __dynamic_array_enc_ext(_type, _item, _length, _order, _base, _encoding)\
+	if (__mask & 1) {						\
+		__field->u.s.len = (_length);				\
+		goto __assign_##_item##_1;				\
+__end_field_##_item##_1:						\
+		goto __assign_##_item##_2;				\
+__end_field_##_item##_2:						\
+		__field++;						\
+	}								\
+	__filter_next_field()
+
+/* Only the first part is contiguous: the filter sees it alone. */
+#undef __dynamic_array_enc_ext_2
+#define __dynamic_array_enc_ext_2(_type, _item, _length1, _length2, _order, _base, _encoding)\
+	if (__mask & 1) {						\
+		__field->u.s.len = (_length1);				\
+		goto __assign_##_item##_1;				\
+__end_field_##_item##_1:						\
+		goto __assign_##_item##_2;				\
+__end_field_##_item##_2:						\
+		goto __assign_##_item##_3;				\
+__end_field_##_item##_3:						\
+		__field++;						\
+	}								\
+	__filter_next_field()
+
+#undef __string
+#define __string(_item, _src)						\
+	if (__mask & 1) {						\
+		__field->u.s.len = SIZE_MAX;				\
+		goto __assign_##_item;					\
+__end_field_##_item:							\
+		__field++;						\
+	}								\
+	__filter_next_field()
+
+#undef __string_from_user
+#define __string_from_user(_item, _src)					\
+	__string(_item, _src)
+
+#undef tp_assign
+#define tp_assign(dest, src)						\
+__assign_##dest:							\
+	{								\
+		__typeof__(__typemap.dest) __tmp = (src);		\
+		__field->u.v = lttng_filter_int(__tmp);			\
+	}								\
+	goto __end_field_##dest;
+
+#undef tp_memcpy_gen
+#define tp_memcpy_gen(_user, dest, src, len)				\
+__assign_##dest:							\
+	if (0)								\
+		(void) __typemap.dest;					\
+	__field->u.s.p = (const char *) (src);				\
+	__field->user = _user;						\
+	goto __end_field_##dest;
+
+#undef tp_memcpy
+#define tp_memcpy(dest, src, len)					\
+	tp_memcpy_gen(0, dest, src, len)
+
+#undef tp_memcpy_from_user
+#define tp_memcpy_from_user(dest, src, len)				\
+	tp_memcpy_gen(1, dest, src, len)
+
+#undef tp_memcpy_dyn_gen
+#define tp_memcpy_dyn_gen(_user, dest, src)				\
+__assign_##dest##_1:							\
+	goto __end_field_##dest##_1;					\
+__assign_##dest##_2:							\
+	if (0)								\
+		(void) __typemap.dest;					\
+	__field->u.s.p = (const char *) (src);				\
+	__field->user = _user;						\
+	goto __end_field_##dest##_2;
+
+#undef tp_memcpy_dyn_gen_2
+#define tp_memcpy_dyn_gen_2(_user, dest, src1, src2)			\
+__assign_##dest##_1:							\
+	goto __end_field_##dest##_1;					\
+__assign_##dest##_2:							\
+	if (0)								\
+		(void) __typemap.dest;					\
+	__field->u.s.p = (const char *) (src1);				\
+	__field->user = _user;						\
+	goto __end_field_##dest##_2;					\
+__assign_##dest##_3:							\
+	goto __end_field_##dest##_3;
+
+#undef tp_memcpy_dyn
+#define tp_memcpy_dyn(dest, src)					\
+	tp_memcpy_dyn_gen(0, dest, src)
+
+#undef tp_memcpy_dyn_2
+#define tp_memcpy_dyn_2(dest, src1, src2)				\
+	tp_memcpy_dyn_gen_2(0, dest, src1, src2)
+
+#undef tp_memcpy_dyn_from_user
+#define tp_memcpy_dyn_from_user(dest, src)				\
+	tp_memcpy_dyn_gen(1, dest, src)
+
+#undef tp_copy_string_from_user
+#define tp_copy_string_from_user(dest, src)				\
+	tp_memcpy_gen(1, dest, src, 0)
+
+#undef tp_strcpy
+#define tp_strcpy(dest, src)						\
+	tp_memcpy_gen(0, dest, src, 0)
+
+#undef __get_str
+#define __get_str(field)		field
+
+#undef __get_dynamic_array
+#define __get_dynamic_array(field)	field
+
+#undef TP_PROTO
+#define TP_PROTO(args...) args
+
+#undef TP_STRUCT__entry
+#define TP_STRUCT__entry(args...) args
+
+#undef TP_fast_assign
+#define TP_fast_assign(args...) args
+
+#undef DECLARE_EVENT_CLASS
+#define DECLARE_EVENT_CLASS(_name, _proto, _args, _tstruct, _assign, _print)  \
+static inline								      \
+void __event_prepare_filter_stack__##_name(				      \
+		struct lttng_filter_field_value *__field, uint64_t __mask,    \
+		_proto)							      \
+{									      \
+	struct __event_typemap__##_name __typemap;			      \
+									      \
+	if (0)								      \
+		(void) __typemap;	/* don't warn if unused */	      \
+	if (!__mask)							      \
+		return;							      \
+	/* Control code (field ordering) */				      \
+	_tstruct							      \
+	return;								      \
+	/* Capture code, steered by control code */			      \
+	_assign								      \
+}
+
+#undef DECLARE_EVENT_CLASS_NOARGS
+#define DECLARE_EVENT_CLASS_NOARGS(_name, _tstruct, _assign, _print)	      \
+static inline								      \
+void __event_prepare_filter_stack__##_name(				      \
+		struct lttng_filter_field_value *__field, uint64_t __mask)    \
+{									      \
+	if (!__mask)							      \
+		return;							      \
+	/* Control code (field ordering) */				      \
+	_tstruct							      \
+	return;								      \
+	/* Capture code, steered by control code */			      \
+	_assign								      \
+}
+
+#include TRACE_INCLUDE(TRACE_INCLUDE_FILE)
+
+
 /*
  * Stage 9 of the trace events.
  *
@@ -566,6 +773,9 @@ struct __event_typemap__##_name {					      \
  * We use both the field and assignment macros to write the fields in the order
  * defined in the field declaration. The field declarations control the
  * execution order, jumping to the appropriate assignment block.
+ *
+ * The filter, if any, runs before the event size calculation, so a rejected
+ * event costs neither the string length scans nor the reservation.
  */
 
 #include "lttng-events-reset.h"	/* Reset all macros within TRACE_EVENT */
@@ -760,6 +970,7 @@ static void __event_probe__##_name(void *__data, _proto)		      \
 	size_t __dynamic_len_idx = 0;					      \
 	size_t __dynamic_len[2 * ARRAY_SIZE(__event_fields___##_name)];	      \
 	struct __event_typemap__##_name __typemap;			      \
+	struct lttng_filter *__filter;					      \
 	int __ret;							      \
 									      \
 	if (0) {							      \
@@ -768,12 +979,19 @@ static void __event_probe__##_name(void *__data, _proto)		      \
 	}								      \
 	if (!_TP_SESSION_CHECK(session, __chan->session))		      \
 		return;							      \
-	if (unlikely(!ACCESS_ONCE(__chan->session->active)))		      \
-		return;							      \
-	if (unlikely(!ACCESS_ONCE(__chan->enabled)))			      \
-		return;							      \
-	if (unlikely(!ACCESS_ONCE(__event->enabled)))			      \
+	if (unlikely(!ACCESS_ONCE(__event->armed)))			      \
 		return;							      \
+	__filter = rcu_dereference_sched(__event->filter);		      \
+	if (unlikely(__filter)) {					      \
+		struct lttng_filter_field_value				      \
+			__filter_stack[LTTNG_FILTER_NR_FIELDS(		      \
+				ARRAY_SIZE(__event_fields___##_name))];	      \
+									      \
+		__event_prepare_filter_stack__##_name(__filter_stack,	      \
+				__filter->field_mask, _args);		      \
+		if (likely(!__filter->filter(__filter, __filter_stack)))      \
+			return;						      \
+	}								      \
 	__event_len = __event_get_size__##_name(__dynamic_len, _args);	      \
 	__event_align = __event_get_align__##_name(_args);		      \
 	lib_ring_buffer_ctx_init(&__ctx, __chan->chan, __event, __event_len,  \
@@ -797,18 +1015,26 @@ static void __event_probe__##_name(void *__data)			      \
 	struct lttng_channel *__chan = __event->chan;			      \
 	struct lib_ring_buffer_ctx __ctx;				      \
 	size_t __event_len, __event_align;				      \
+	struct lttng_filter *__filter;					      \
 	int __ret;							      \
 									      \
 	if (!_TP_SESSION_CHECK(session, __chan->session))		      \
 		return;							      \
-	if (unlikely(!ACCESS_ONCE(__chan->session->active)))		      \
-		return;							      \
-	if (unlikely(!ACCESS_ONCE(__chan->enabled)))			      \
-		return;							      \
-	if (unlikely(!ACCESS_ONCE(__event->enabled)))			      \
+	if (unlikely(!ACCESS_ONCE(__event->armed)))			      \
 		return;							      \
 	__event_len = 0;						      \
 	__event_align = 1;						      \
+	__filter = rcu_dereference_sched(__event->filter);		      \
+	if (unlikely(__filter)) {					      \
+		struct lttng_filter_field_value				      \
+			__filter_stack[LTTNG_FILTER_NR_FIELDS(		      \
+				ARRAY_SIZE(__event_fields___##_name))];	      \
+									      \
+		__event_prepare_filter_stack__##_name(__filter_stack,	      \
+				__filter->field_mask);			      \
+		if (likely(!__filter->filter(__filter, __filter_stack)))      \
+			return;						      \
+	}								      \
 	lib_ring_buffer_ctx_init(&__ctx, __chan->chan, __event, __event_len,  \
 				 __event_align, -1);			      \
 	__ret = __chan->ops->event_reserve(&__ctx, __event->id);	      \
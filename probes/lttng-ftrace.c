@@ -51,11 +51,7 @@ void lttng_ftrace_handler(unsigned long ip, unsigned long parent_ip, void **data
 	} payload;
 	int ret;
 
-	if (unlikely(!ACCESS_ONCE(chan->session->active)))
-		return;
-	if (unlikely(!ACCESS_ONCE(chan->enabled)))
-		return;
-	if (unlikely(!ACCESS_ONCE(event->enabled)))
+	if (unlikely(!ACCESS_ONCE(event->armed)))
 		return;
 
 	lib_ring_buffer_ctx_init(&ctx, chan->chan, event,
@@ -38,11 +38,7 @@ int lttng_kprobes_handler_pre(struct kprobe *p, struct pt_regs *regs)
 	int ret;
 	unsigned long data = (unsigned long) p->addr;
 
-	if (unlikely(!ACCESS_ONCE(chan->session->active)))
-		return 0;
-	if (unlikely(!ACCESS_ONCE(chan->enabled)))
-		return 0;
-	if (unlikely(!ACCESS_ONCE(event->enabled)))
+	if (unlikely(!ACCESS_ONCE(event->armed)))
 		return 0;
 
 	lib_ring_buffer_ctx_init(&ctx, chan->chan, event, sizeof(data),
@@ -58,11 +58,7 @@ int _lttng_kretprobes_handler(struct kretprobe_instance *krpi,
 		unsigned long parent_ip;
 	} payload;
 
-	if (unlikely(!ACCESS_ONCE(chan->session->active)))
-		return 0;
-	if (unlikely(!ACCESS_ONCE(chan->enabled)))
-		return 0;
-	if (unlikely(!ACCESS_ONCE(event->enabled)))
+	if (unlikely(!ACCESS_ONCE(event->armed)))
 		return 0;
 
 	payload.ip = (unsigned long) krpi->rp->kp.addr;
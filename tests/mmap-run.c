@@ -0,0 +1,223 @@
+/*
+ * tests/mmap-run.c
+ *
+ * Reads a run of several sub-buffers of an mmap output stream through a
+ * faulting mapping, and checks it against the same run read with read().
+ *
+ * Traces all system calls into a small discard mode channel from the CPU
+ * the test is pinned on, until its buffer is full, then gets a run with
+ * RING_BUFFER_GET_NEXT_SUBBUFS and touches every page of each sub-buffer of
+ * the run through a mapping of RING_BUFFER_GET_MMAP_LEN bytes, which faults
+ * them in one at a time. Needs root and the lttng modules loaded.
+ *
+ * Exits with 0 on success, 1 on failure, and 77 if the test cannot run.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "../lttng-abi.h"
+
+/*
+ * From lib/ringbuffer/vfs.h, which is not usable from user space.
+ */
+#define RING_BUFFER_MAX_SUBBUFS			32
+
+struct lib_ring_buffer_subbuf_desc {
+	uint64_t mmap_offset;
+	uint64_t data_size;
+	uint64_t padded_size;
+} __attribute__((packed));
+
+struct lib_ring_buffer_subbufs {
+	uint32_t max_subbufs;
+	uint32_t nr_subbufs;
+	struct lib_ring_buffer_subbuf_desc subbufs[RING_BUFFER_MAX_SUBBUFS];
+} __attribute__((packed));
+
+#define RING_BUFFER_PUT_NEXT_SUBBUF		_IO(0xF6, 0x06)
+#define RING_BUFFER_GET_MMAP_LEN		_IOR(0xF6, 0x0A, unsigned long)
+#define RING_BUFFER_FLUSH			_IO(0xF6, 0x0C)
+#define RING_BUFFER_GET_NEXT_SUBBUFS		\
+	_IOWR(0xF6, 0x0E, struct lib_ring_buffer_subbufs)
+
+#define CTF_MAGIC_NUMBER		0xC1FC1FC1
+
+#define TEST_SUBBUF_SIZE		4096
+#define TEST_NUM_SUBBUF			8
+/* Enough system calls to fill the buffer, whatever the record size. */
+#define TEST_NR_SYSCALLS		(TEST_SUBBUF_SIZE * TEST_NUM_SUBBUF)
+
+#define TEST_SKIP			77
+
+static int fail(const char *what)
+{
+	fprintf(stderr, "mmap-run: %s: %s\n", what, strerror(errno));
+	return 1;
+}
+
+/*
+ * Pin on CPU 0: its buffer is the first stream of the channel.
+ */
+static int pin_cpu0(void)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(0, &set);
+	return sched_setaffinity(0, sizeof(set), &set);
+}
+
+static int check_run(int stream_fd, const char *map,
+		     const struct lib_ring_buffer_subbufs *run)
+{
+	char *copy;
+	size_t len = 0, pos = 0;
+	ssize_t ret;
+	uint32_t i, magic;
+	int err = 0;
+
+	for (i = 0; i < run->nr_subbufs; i++)
+		len += run->subbufs[i].padded_size;
+	copy = malloc(len);
+	if (!copy)
+		return fail("malloc");
+	while (pos < len) {
+		ret = read(stream_fd, copy + pos, len - pos);
+		if (ret < 0) {
+			err = fail("read");
+			goto end;
+		}
+		if (!ret) {
+			fprintf(stderr, "mmap-run: short read\n");
+			err = 1;
+			goto end;
+		}
+		pos += ret;
+	}
+	pos = 0;
+	for (i = 0; i < run->nr_subbufs; i++) {
+		const struct lib_ring_buffer_subbuf_desc *desc =
+			&run->subbufs[i];
+
+		memcpy(&magic, map + desc->mmap_offset, sizeof(magic));
+		/* Touches each page of the sub-buffer, faulting it in. */
+		if (magic != CTF_MAGIC_NUMBER
+		    || memcmp(map + desc->mmap_offset, copy + pos,
+			      desc->data_size)) {
+			fprintf(stderr, "mmap-run: sub-buffer %u of %u differs\n",
+				i, run->nr_subbufs);
+			err = 1;
+			goto end;
+		}
+		pos += desc->padded_size;
+	}
+end:
+	free(copy);
+	return err;
+}
+
+int main(void)
+{
+	struct lttng_kernel_channel chan_param;
+	struct lttng_kernel_event event_param;
+	struct lib_ring_buffer_subbufs run;
+	int lttng_fd, session_fd, chan_fd, stream_fd;
+	unsigned long mmap_len, i;
+	char *map;
+	int ret;
+
+	if (pin_cpu0())
+		return fail("sched_setaffinity");
+	lttng_fd = open("/proc/lttng", O_RDWR);
+	if (lttng_fd < 0) {
+		fprintf(stderr, "mmap-run: lttng modules not loaded, skipped\n");
+		return TEST_SKIP;
+	}
+	session_fd = ioctl(lttng_fd, LTTNG_KERNEL_SESSION);
+	if (session_fd < 0)
+		return fail("LTTNG_KERNEL_SESSION");
+
+	memset(&chan_param, 0, sizeof(chan_param));
+	chan_param.subbuf_size = TEST_SUBBUF_SIZE;
+	chan_param.num_subbuf = TEST_NUM_SUBBUF;
+	chan_param.output = LTTNG_KERNEL_MMAP;
+	chan_param.overwrite = 0;
+	chan_fd = ioctl(session_fd, LTTNG_KERNEL_CHANNEL, &chan_param);
+	if (chan_fd < 0)
+		return fail("LTTNG_KERNEL_CHANNEL");
+	stream_fd = ioctl(chan_fd, LTTNG_KERNEL_STREAM);
+	if (stream_fd < 0)
+		return fail("LTTNG_KERNEL_STREAM");
+
+	memset(&event_param, 0, sizeof(event_param));
+	event_param.instrumentation = LTTNG_KERNEL_SYSCALL;
+	if (ioctl(chan_fd, LTTNG_KERNEL_EVENT, &event_param) < 0) {
+		fprintf(stderr, "mmap-run: no system call tracing, skipped\n");
+		return TEST_SKIP;
+	}
+
+	if (ioctl(stream_fd, RING_BUFFER_GET_MMAP_LEN, &mmap_len) < 0)
+		return fail("RING_BUFFER_GET_MMAP_LEN");
+	map = mmap(NULL, mmap_len, PROT_READ, MAP_PRIVATE, stream_fd, 0);
+	if (map == MAP_FAILED)
+		return fail("mmap");
+
+	if (ioctl(session_fd, LTTNG_KERNEL_SESSION_START) < 0)
+		return fail("LTTNG_KERNEL_SESSION_START");
+	for (i = 0; i < TEST_NR_SYSCALLS; i++)
+		syscall(SYS_getpid);
+	if (ioctl(session_fd, LTTNG_KERNEL_SESSION_STOP) < 0)
+		return fail("LTTNG_KERNEL_SESSION_STOP");
+	if (ioctl(stream_fd, RING_BUFFER_FLUSH) < 0)
+		return fail("RING_BUFFER_FLUSH");
+
+	memset(&run, 0, sizeof(run));
+	run.max_subbufs = TEST_NUM_SUBBUF;
+	if (ioctl(stream_fd, RING_BUFFER_GET_NEXT_SUBBUFS, &run) < 0)
+		return fail("RING_BUFFER_GET_NEXT_SUBBUFS");
+	if (run.nr_subbufs < 2) {
+		fprintf(stderr, "mmap-run: got a run of %u sub-buffer(s)\n",
+			run.nr_subbufs);
+		return 1;
+	}
+	ret = check_run(stream_fd, map, &run);
+	if (ioctl(stream_fd, RING_BUFFER_PUT_NEXT_SUBBUF) < 0)
+		return fail("RING_BUFFER_PUT_NEXT_SUBBUF");
+	if (!ret)
+		printf("mmap-run: read a run of %u sub-buffers\n",
+		       run.nr_subbufs);
+
+	munmap(map, mmap_len);
+	close(stream_fd);
+	close(chan_fd);
+	close(session_fd);
+	close(lttng_fd);
+	return ret;
+}
@@ -0,0 +1,64 @@
+#ifndef _LTTNG_WRAPPER_IOV_ITER_H
+#define _LTTNG_WRAPPER_IOV_ITER_H
+
+/*
+ * wrapper/iov_iter.h
+ *
+ * wrapper around the writes of pages to a file through a bio_vec iterator.
+ * Only available from Linux 4.1, which exports vfs_iter_write(): older
+ * kernels can only write kernel memory to a file through its virtual
+ * addresses, which O_DIRECT writes cannot pin.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; only
+ * version 2.1 of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <linux/version.h>
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,1,0))
+
+#include <linux/fs.h>
+#include <linux/uio.h>
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,9,0))
+#include <linux/bvec.h>
+#else
+#include <linux/blk_types.h>
+#endif
+
+#define LTTNG_HAVE_WRITE_BVEC
+
+static inline
+ssize_t wrapper_vfs_write_bvec(struct file *file, struct bio_vec *bvec,
+			       unsigned long nr_segs, size_t count,
+			       loff_t *pos)
+{
+	struct iov_iter iter;
+
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,20,0))
+	iov_iter_bvec(&iter, WRITE, bvec, nr_segs, count);
+#else
+	iov_iter_bvec(&iter, ITER_BVEC | WRITE, bvec, nr_segs, count);
+#endif
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4,13,0))
+	return vfs_iter_write(file, &iter, pos, 0);
+#else
+	return vfs_iter_write(file, &iter, pos);
+#endif
+}
+
+#endif
+
+#endif /* _LTTNG_WRAPPER_IOV_ITER_H */
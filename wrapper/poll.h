@@ -25,7 +25,9 @@
 
 /*
  * Note: poll_wait_set_exclusive() is defined as no-op. Thundering herd
- * effect can be noticed with large number of consumer threads.
+ * effect can be noticed with large number of consumer threads. Consumer
+ * threads sharing streams can wait with the RING_BUFFER_WAIT_EXCLUSIVE
+ * ioctl instead, which wakes a single thread per delivery.
  */
 
 #define poll_wait_set_exclusive(poll_table)